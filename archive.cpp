@@ -0,0 +1,295 @@
+#include "archive.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Gräns vid läsning; ArchiveWriter skriver aldrig större block än
+// COMPRESSED_BLOCK_ROWS, men CompressedSeries kan ha valt en annan storlek
+const size_t MAX_BLOCK_ROWS = size_t(1) << 20;
+
+// Blockhuvudena skrivs och läses som råa minnesbilder
+static_assert(is_trivially_copyable<CompressedBlockHeader>::value,
+              "CompressedBlockHeader must be trivially copyable");
+static_assert(sizeof(CompressedBlockHeader) == 80, "CompressedBlockHeader must not contain padding");
+
+bool readHeader(FILE* file, string& error) {
+    ArchiveFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+        error = "not an archive file";
+        return false;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        error = "archive was written on a platform with different byte order";
+        return false;
+    }
+    if (header.version != ARCHIVE_VERSION) {
+        error = "unsupported archive version " + to_string(header.version);
+        return false;
+    }
+    return true;
+}
+
+// Ett huvud som inte kan ha skrivits av ArchiveWriter betyder skadad data
+bool plausibleBlock(const CompressedBlockHeader& block) {
+    return block.count > 0 && block.count <= MAX_BLOCK_ROWS &&
+           block.byteCount <= maxCompressedBytes(block.count);
+}
+
+// Offset där det sista hela blocket slutar; bara blockhuvudena läses
+uint64_t completeBlocksEnd(FILE* file, uint64_t fileSize) {
+    uint64_t end = sizeof(ArchiveFileHeader);
+    CompressedBlockHeader block;
+    while (fseek(file, static_cast<long>(end), SEEK_SET) == 0 && fread(&block, sizeof(block), 1, file) == 1 &&
+           plausibleBlock(block)) {
+        uint64_t blockEnd = end + sizeof(block) + block.byteCount;
+        if (blockEnd > fileSize) break;
+        end = blockEnd;
+    }
+    return end;
+}
+
+bool writeFileHeader(FILE* file) {
+    ArchiveFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version = ARCHIVE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+// Gemensam läsning av blocken. sink returnerar false för ett block som
+// inte kan avkodas; det och resten av filen räknas då som skadat.
+bool scanBlocks(const string& filename,
+                const function<bool(const CompressedBlockHeader& header, const unsigned char* payload)>& sink,
+                string& error, uint64_t& skippedBytes) {
+    skippedBytes = 0;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "could not open file";
+        return false;
+    }
+    if (!readHeader(file, error)) {
+        fclose(file);
+        return false;
+    }
+
+    vector<unsigned char> payload;
+    uint64_t position = sizeof(ArchiveFileHeader);
+    CompressedBlockHeader block;
+    while (true) {
+        size_t headerBytes = fread(&block, 1, sizeof(block), file);
+        if (headerBytes == 0) break;
+        bool ok = headerBytes == sizeof(block) && plausibleBlock(block);
+        if (ok) {
+            payload.resize(block.byteCount);
+            ok = fread(payload.data(), 1, block.byteCount, file) == block.byteCount && sink(block, payload.data());
+        }
+        if (!ok) {
+            // Resten av filen hoppas över; storleken rapporteras
+            fseek(file, 0, SEEK_END);
+            long size = ftell(file);
+            skippedBytes = size > 0 && static_cast<uint64_t>(size) > position ? size - position : 0;
+            break;
+        }
+        IOT_COUNT(BytesRead, sizeof(block) + block.byteCount);
+        position += sizeof(block) + block.byteCount;
+    }
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+ArchiveWriter::ArchiveWriter() : file(nullptr), failed(false), rowsWritten(0), bytesWritten(0) {
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    close();
+}
+
+bool ArchiveWriter::open(const string& filename, string& error) {
+    close();
+    failed = false;
+    rowsWritten = 0;
+    bytesWritten = 0;
+
+    // En befintlig fil kontrolleras och ett avbrutet sista block från en
+    // tidigare krasch klipps bort, annars skulle nya block bli oläsbara
+    FILE* existing = fopen(filename.c_str(), "rb");
+    uint64_t validEnd = 0;
+    uint64_t fileSize = 0;
+    if (existing != nullptr) {
+        fseek(existing, 0, SEEK_END);
+        long size = ftell(existing);
+        fileSize = size > 0 ? static_cast<uint64_t>(size) : 0;
+        if (fileSize > 0) {
+            rewind(existing);
+            if (!readHeader(existing, error)) {
+                fclose(existing);
+                return false;
+            }
+            validEnd = completeBlocksEnd(existing, fileSize);
+        }
+        fclose(existing);
+    }
+#ifndef _WIN32
+    if (validEnd < fileSize && truncate(filename.c_str(), static_cast<off_t>(validEnd)) != 0) {
+        error = "could not remove the incomplete last block";
+        return false;
+    }
+#endif
+
+    file = fopen(filename.c_str(), "ab");
+    if (file == nullptr) {
+        error = "could not open file for writing";
+        return false;
+    }
+    if (validEnd == 0) {
+        if (!writeFileHeader(file)) {
+            fclose(file);
+            file = nullptr;
+            error = "could not write archive header";
+            return false;
+        }
+        bytesWritten += sizeof(ArchiveFileHeader);
+    }
+    return true;
+}
+
+bool ArchiveWriter::create(const string& filename, string& error) {
+    close();
+    failed = false;
+    rowsWritten = 0;
+    bytesWritten = 0;
+    temporaryName = filename + ".tmp";
+    targetName = filename;
+    file = fopen(temporaryName.c_str(), "wb");
+    if (file == nullptr) {
+        temporaryName.clear();
+        error = "could not open file for writing";
+        return false;
+    }
+    if (!writeFileHeader(file)) {
+        failed = true;
+        close();
+        error = "could not write archive header";
+        return false;
+    }
+    bytesWritten += sizeof(ArchiveFileHeader);
+    return true;
+}
+
+void ArchiveWriter::reserve(size_t maxRows) {
+    size_t bytes = maxCompressedBytes(min(maxRows, COMPRESSED_BLOCK_ROWS));
+    if (encoded.size() < bytes) encoded.resize(bytes);
+}
+
+bool ArchiveWriter::writeBlock(const double* values, const int64_t* timestamps, size_t count) {
+    if (file == nullptr || failed) return false;
+    while (count > 0) {
+        size_t rows = min(count, COMPRESSED_BLOCK_ROWS);
+        reserve(rows);
+        CompressedBlockHeader header;
+        encodeCompressedBlock(values, timestamps, rows, header, encoded.data());
+        if (!writeEncodedBlock(header, encoded.data())) return false;
+        values += rows;
+        timestamps += rows;
+        count -= rows;
+    }
+    return true;
+}
+
+bool ArchiveWriter::writeEncodedBlock(const CompressedBlockHeader& header, const unsigned char* payload) {
+    if (file == nullptr || failed) return false;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(payload, 1, header.byteCount, file) != header.byteCount) {
+        failed = true;
+        return false;
+    }
+    rowsWritten += header.count;
+    bytesWritten += sizeof(header) + header.byteCount;
+    IOT_COUNT(BytesWritten, sizeof(header) + header.byteCount);
+    return true;
+}
+
+bool ArchiveWriter::flush() {
+    if (file == nullptr) return false;
+    failed = failed || fflush(file) != 0;
+    return !failed;
+}
+
+bool ArchiveWriter::close() {
+    if (file == nullptr) return !failed;
+    if (!temporaryName.empty()) {
+        // Som för snapshots synkas allt innan målet ersätts
+        failed = failed || fflush(file) != 0;
+#ifndef _WIN32
+        failed = failed || fsync(fileno(file)) != 0;
+#endif
+    }
+    failed = (fclose(file) != 0) || failed;
+    file = nullptr;
+    if (!temporaryName.empty()) {
+#ifdef _WIN32
+        if (!failed) remove(targetName.c_str());
+#endif
+        if (failed || rename(temporaryName.c_str(), targetName.c_str()) != 0) {
+            remove(temporaryName.c_str());
+            failed = true;
+        }
+        temporaryName.clear();
+    }
+    return !failed;
+}
+
+bool isArchiveFile(const string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(ARCHIVE_MAGIC)];
+    bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                 memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
+
+bool readArchiveBlocks(const string& filename,
+                       const function<void(const CompressedBlockHeader& header,
+                                           const unsigned char* payload)>& sink,
+                       string& error, uint64_t& skippedBytes) {
+    return scanBlocks(filename,
+        [&](const CompressedBlockHeader& header, const unsigned char* payload) {
+            sink(header, payload);
+            return true;
+        },
+        error, skippedBytes);
+}
+
+bool readArchive(const string& filename,
+                 const function<void(const double* values, const int64_t* timestamps, size_t count)>& sink,
+                 string& error, uint64_t& skippedBytes) {
+    vector<double> values;
+    vector<int64_t> timestamps;
+    return scanBlocks(filename,
+        [&](const CompressedBlockHeader& header, const unsigned char* payload) {
+            values.resize(header.count);
+            timestamps.resize(header.count);
+            if (!decodeCompressedBlock(header, payload, values.data(), timestamps.data())) return false;
+            sink(values.data(), timestamps.data(), header.count);
+            return true;
+        },
+        error, skippedBytes);
+}
@@ -0,0 +1,96 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "compressed_block.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Komprimerad arkivfil för mätvärden, t.ex. de som trängs ut ur en
+// RetentionBuffer eller sparas med DataManager::saveToFile("x.arc").
+// Filen växer bara i slutet och består av fristående block:
+//
+//   ArchiveFileHeader                 (16 byte, se nedan)
+//   block: CompressedBlockHeader      (aggregat och nyttolastens storlek)
+//          nyttolast                  (Gorilla-kodade rader, se compressed_block.h)
+//
+// Blockens headers kan läsas utan att nyttolasten avkodas, så statistik
+// för hela filen eller för block helt inom ett tidsintervall kostar en
+// läsning per block. Ett block som avbrutits mitt i skrivningen, t.ex. vid
+// en krasch, hoppas över vid läsning; alla hela block före det läses som vanligt.
+
+struct ArchiveFileHeader {
+    char magic[8];              // "IOTARCH\0"
+    std::uint32_t version;      // ARCHIVE_VERSION
+    std::uint32_t byteOrder;    // 0x01020304 skrivet i plattformens ordning
+};
+
+const char ARCHIVE_MAGIC[8] = { 'I', 'O', 'T', 'A', 'R', 'C', 'H', '\0' };
+// Version 1 hade en enklare bytekodning utan blockaggregat och läses inte längre
+const std::uint32_t ARCHIVE_VERSION = 2;
+const char* const ARCHIVE_EXTENSION = ".arc";
+
+// Skriver block till slutet av en arkivfil
+class ArchiveWriter {
+private:
+    std::FILE* file;
+    std::vector<unsigned char> encoded;   // Återanvänds mellan blocken
+    std::string temporaryName;            // Satt av create(), döps om vid close()
+    std::string targetName;
+    bool failed;
+    std::uint64_t rowsWritten;
+    std::uint64_t bytesWritten;
+
+public:
+    ArchiveWriter();
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // Öppna för tillägg. En ny eller tom fil får en header, en befintlig
+    // fil måste vara ett arkiv i samma format.
+    bool open(const std::string& filename, std::string& error);
+    // Skapa en ny fil. Den skrivs som en temporär fil som ersätter
+    // filename först när close() lyckas.
+    bool create(const std::string& filename, std::string& error);
+    bool isOpen() const { return file != nullptr; }
+
+    // Reservera kodningsbufferten för block om högst maxRows rader, så att
+    // writeBlock inte behöver allokera
+    void reserve(size_t maxRows);
+
+    // Koda och skriv raderna i block om högst COMPRESSED_BLOCK_ROWS rader;
+    // false om skrivningen misslyckades
+    bool writeBlock(const double* values, const std::int64_t* timestamps, size_t count);
+    // Skriv ett redan kodat block
+    bool writeEncodedBlock(const CompressedBlockHeader& header, const unsigned char* payload);
+    // Töm stdio-bufferten till filen
+    bool flush();
+    bool close();
+
+    std::uint64_t getRowsWritten() const { return rowsWritten; }
+    std::uint64_t getBytesWritten() const { return bytesWritten; }
+};
+
+// Sant om filen börjar med arkivheadern
+bool isArchiveFile(const std::string& filename);
+
+// Läs alla hela block i filordning och lämna dem till sink, ett block per
+// anrop. false (och error) om filen inte kunde öppnas eller inte är ett
+// arkiv; skippedBytes blir storleken på ett avbrutet eller skadat slut.
+bool readArchive(const std::string& filename,
+                 const std::function<void(const double* values, const std::int64_t* timestamps,
+                                          size_t count)>& sink,
+                 std::string& error, std::uint64_t& skippedBytes);
+
+// Som readArchive men utan avkodning: varje blocks header och nyttolast
+// lämnas som de ligger i filen. Pekarna gäller endast under anropet.
+bool readArchiveBlocks(const std::string& filename,
+                       const std::function<void(const CompressedBlockHeader& header,
+                                                const unsigned char* payload)>& sink,
+                       std::string& error, std::uint64_t& skippedBytes);
+
+#endif // ARCHIVE_H
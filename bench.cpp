@@ -0,0 +1,1415 @@
+// Prestandamätningar för IoT Measurement Analyzer
+// Byggs med "make bench" (release-flaggor) och körs med
+//   ./iot_bench [--filter TEXT] [--sizes 1K,1M,...] [--distributions ...] [--json FILE]
+// för de registrerade benchmarkarna (se bench_harness.h), eller
+//   ./iot_bench <svit> [storlek]
+// för jämförelserna före/efter nedan.
+#include "bench_harness.h"
+#include "compressed_series.h"
+#include "data_manager.h"
+#include "ingest_hub.h"
+#include "retention_buffer.h"
+#include "sensor_simulator.h"
+#include "sensor_store.h"
+#include "sliding_window.h"
+#include "stats_kernel.h"
+#include "thread_pool.h"
+#include "time_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Enkel tidtagning i sekunder
+class Stopwatch {
+private:
+    chrono::steady_clock::time_point start;
+public:
+    Stopwatch() : start(chrono::steady_clock::now()) {}
+    double elapsed() const {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+// Generera en CSV-fil med en mätning per sekund
+void generateCsv(const string& filename, size_t rows) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) return;
+    fputs("timestamp,value\n", file);
+
+    tm base = {};
+    base.tm_year = 2024 - 1900;
+    base.tm_mon = 0;
+    base.tm_mday = 15;
+    base.tm_isdst = -1;
+    time_t t = mktime(&base);
+    unsigned seed = 12345;
+    char line[64];
+    for (size_t i = 0; i < rows; ++i, ++t) {
+        seed = seed * 1103515245u + 12345u;
+        double value = 20.0 + (seed >> 16) % 1000 / 100.0;
+        tm local;
+        localtime_r(&t, &local);
+        size_t n = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &local);
+        n += snprintf(line + n, sizeof(line) - n, ",%.2f\n", value);
+        fwrite(line, 1, n, file);
+    }
+    fclose(file);
+}
+
+// Den tidigare inläsningen (getline + stringstream + get_time + stod)
+size_t legacyLoad(const string& filename, vector<Measurement>& measurements) {
+    ifstream file(filename);
+    string line;
+    getline(file, line);
+    size_t loadedCount = 0;
+    while (getline(file, line)) {
+        if (line.empty()) continue;
+        stringstream ss(line);
+        string timestampStr, valueStr;
+        if (getline(ss, timestampStr, ',') && getline(ss, valueStr)) {
+            try {
+                tm tm = {};
+                stringstream tsStream(timestampStr);
+                tsStream >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
+                time_t time = mktime(&tm);
+                Measurement m;
+                m.value = stod(valueStr);
+                m.timestamp = chrono::system_clock::from_time_t(time);
+                measurements.push_back(m);
+                loadedCount++;
+            } catch (const exception&) {
+            }
+        }
+    }
+    return loadedCount;
+}
+
+void benchLoad(size_t rows) {
+    const string filename = "bench_load.csv";
+    cout << "Generating " << rows << " rows..." << endl;
+    generateCsv(filename, rows);
+
+    {
+        vector<Measurement> measurements;
+        Stopwatch sw;
+        size_t loaded = legacyLoad(filename, measurements);
+        double seconds = sw.elapsed();
+        cout << "legacy loader:    " << loaded << " rows in " << fixed << setprecision(3)
+             << seconds << " s (" << setprecision(0) << loaded / seconds << " rows/s)" << endl;
+    }
+    {
+        DataManager dm;
+        Stopwatch sw;
+        dm.loadFromFile(filename);
+        double seconds = sw.elapsed();
+        size_t loaded = dm.getMeasurementCount();
+        cout << "streaming loader: " << loaded << " rows in " << fixed << setprecision(3)
+             << seconds << " s (" << setprecision(0) << loaded / seconds << " rows/s)" << endl;
+    }
+    // Parallell inläsning: filen delas i byteintervall, en tråd per intervall
+    unsigned cores = max(thread::hardware_concurrency(), 1u);
+    for (unsigned threads = 2; ; threads = min(threads * 2, cores)) {
+        DataManager dm;
+        dm.setThreadCount(threads);
+        Stopwatch sw;
+        dm.loadFromFile(filename);
+        double seconds = sw.elapsed();
+        size_t loaded = dm.getMeasurementCount();
+        cout << "parallel loader (" << threads << " threads): " << loaded << " rows in " << fixed
+             << setprecision(3) << seconds << " s (" << setprecision(0) << loaded / seconds << " rows/s)" << endl;
+        if (threads >= cores) break;
+    }
+
+    remove(filename.c_str());
+}
+
+void report(const string& name, double seconds, size_t items) {
+    cout << left << setw(28) << name << right << fixed << setprecision(4) << setw(10) << seconds
+         << " s  (" << setprecision(1) << setw(8) << items / seconds / 1e6 << " M items/s)" << endl;
+}
+
+// Jämför de värdebaserade analyserna på vector<Measurement> (före)
+// med kolumnlagringen i DataManager (efter)
+void benchColumns(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    MeasurementView view = dm.getAllMeasurements();
+    vector<Measurement> rows(view.begin(), view.end());
+    volatile double sink = 0;
+
+    cout << "--- before: vector<Measurement> ---" << endl;
+    {
+        Stopwatch sw;
+        double sum = 0, minValue = rows[0].value, maxValue = rows[0].value;
+        for (const auto& m : rows) {
+            sum += m.value;
+            if (m.value < minValue) minValue = m.value;
+            if (m.value > maxValue) maxValue = m.value;
+        }
+        double mean = sum / rows.size();
+        double variance = 0;
+        for (const auto& m : rows) variance += pow(m.value - mean, 2);
+        sink = sink + variance + minValue + maxValue;
+        report("calculateStatistics", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        vector<int> indices;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (abs(rows[i].value - 25.0) < 0.5) indices.push_back(i);
+        }
+        sink = sink + indices.size();
+        report("findValue", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        vector<double> averages;
+        for (size_t i = 4; i < rows.size(); ++i) {
+            double sum = 0;
+            for (size_t j = 0; j < 5; ++j) sum += rows[i - j].value;
+            averages.push_back(sum / 5);
+        }
+        sink = sink + averages.back();
+        report("calculateMovingAverage(5)", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        map<int, int> histogram;
+        for (const auto& m : rows) histogram[static_cast<int>(round(m.value))]++;
+        sink = sink + histogram.size();
+        report("generateHistogram", sw.elapsed(), count);
+    }
+
+    cout << "--- after: columnar DataManager ---" << endl;
+    {
+        Stopwatch sw;
+        RunningStats summary = summarizeValues(dm.measurementsView().valueData(), count);
+        sink = sink + summary.variance();
+        report("calculateStatistics (scan)", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        sink = sink + dm.findValue(25.0, 0.5).size();
+        report("findValue", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        sink = sink + dm.calculateMovingAverage(5).back();
+        report("calculateMovingAverage(5)", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        sink = sink + dm.generateHistogram().binCount();
+        report("generateHistogram", sw.elapsed(), count);
+    }
+}
+
+// Tidigare tre pass (summa/min/max, varians med pow, separat medelvärde)
+// jämfört med den sammanslagna kärnan
+void benchStatistics(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    ValueSpan values = dm.getAllValues();
+    volatile double sink = 0;
+
+    {
+        Stopwatch sw;
+        double sum = 0, minValue = values[0], maxValue = values[0];
+        for (double value : values) {
+            sum += value;
+            if (value < minValue) minValue = value;
+            if (value > maxValue) maxValue = value;
+        }
+        double mean = sum / values.size();
+        double variance = 0;
+        for (double value : values) variance += pow(value - mean, 2);
+        double meanAgain = 0;
+        for (double value : values) meanAgain += value;
+        sink = sink + variance + minValue + maxValue + meanAgain;
+        report("three-pass statistics", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        RunningStats summary = summarizeValues(values.data(), values.size());
+        sink = sink + summary.variance();
+        report(string("fused kernel (") + statsKernelName() + ")", sw.elapsed(), count);
+    }
+    {
+        // Löpande aggregat: addMeasurement betalar O(1), frågan är gratis
+        DataManager incremental;
+        Stopwatch sw;
+        for (double value : values) incremental.addMeasurement(value);
+        report("addMeasurement (incremental)", sw.elapsed(), count);
+
+        Stopwatch query;
+        const size_t queries = 1000000;
+        for (size_t i = 0; i < queries; ++i) {
+            sink = sink + incremental.calculateStatistics().variance;
+        }
+        report("calculateStatistics (O(1))", query.elapsed(), queries);
+    }
+}
+
+// O(n·w) jämfört med glidande fönster i O(n) för växande fönster
+void benchMovingWindow(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    ValueSpan values = dm.getAllValues();
+    vector<double> out(count);
+    volatile double sink = 0;
+
+    const size_t windows[] = { 5, 50, 500 };
+    for (size_t window : windows) {
+        {
+            Stopwatch sw;
+            size_t written = 0;
+            for (size_t i = window - 1; i < values.size(); ++i) {
+                double sum = 0;
+                for (size_t j = 0; j < window; ++j) sum += values[i - j];
+                out[written++] = sum / window;
+            }
+            sink = sink + out[0];
+            report("recompute mean w=" + to_string(window), sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            dm.calculateMovingWindow(window, WindowAggregate::Mean, out.data());
+            sink = sink + out[0];
+            report("sliding mean w=" + to_string(window), sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            dm.calculateMovingWindow(window, WindowAggregate::Max, out.data());
+            sink = sink + out[0];
+            report("sliding max w=" + to_string(window), sw.elapsed(), count);
+        }
+    }
+
+    // Ett NaN får bara påverka de fönster som innehåller det; jämför med
+    // en beräkning från grunden för varje fönster
+    const size_t window = 50;
+    vector<double> series(values.begin(), values.begin() + min<size_t>(values.size(), 100000));
+    if (series.size() < 2 * window) return;
+    size_t nanRow = series.size() / 3;
+    series[nanRow] = numeric_limits<double>::quiet_NaN();
+    SlidingWindowEngine engine;
+    vector<double> mean(series.size()), stddev(series.size()), maximum(series.size());
+    size_t outputs = engine.rolling(series.data(), series.size(), window, WindowAggregate::Mean, mean.data());
+    engine.rolling(series.data(), series.size(), window, WindowAggregate::StandardDeviation, stddev.data());
+    engine.rolling(series.data(), series.size(), window, WindowAggregate::Max, maximum.data());
+    auto same = [](double a, double b) {
+        return (isnan(a) && isnan(b)) || fabs(a - b) <= 1e-9 * max(1.0, fabs(b));
+    };
+    size_t differences = 0, nanWindows = 0;
+    for (size_t k = 0; k < outputs; ++k) {
+        double sum = 0, m2 = 0, maxValue = numeric_limits<double>::quiet_NaN();
+        for (size_t j = k; j < k + window; ++j) {
+            sum += series[j];
+            if (isnan(maxValue) || series[j] > maxValue) maxValue = series[j];
+        }
+        double windowMean = sum / window;
+        for (size_t j = k; j < k + window; ++j) m2 += (series[j] - windowMean) * (series[j] - windowMean);
+        differences += !same(mean[k], windowMean) + !same(stddev[k], sqrt(m2 / window)) +
+                       !same(maximum[k], maxValue);
+        nanWindows += isnan(mean[k]);
+    }
+    cout << "    NaN in " << nanWindows << " of " << outputs << " windows (w=" << window << "): "
+         << (differences == 0 && nanWindows == window ? "match" : "DIFFER") << endl;
+}
+
+// CSV jämfört med binär snapshot för sparning och start
+void benchSnapshot(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    volatile double sink = 0;
+
+    {
+        Stopwatch sw;
+        dm.saveToFile("bench_snapshot.csv");
+        report("saveToFile (csv)", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        dm.saveToFile("bench_snapshot.snap");
+        report("saveToFile (snapshot)", sw.elapsed(), count);
+    }
+    {
+        DataManager loaded;
+        Stopwatch sw;
+        loaded.loadFromFile("bench_snapshot.csv");
+        sink = sink + loaded.calculateStatistics().mean;
+        report("loadFromFile (csv)", sw.elapsed(), count);
+    }
+    {
+        DataManager loaded;
+        Stopwatch sw;
+        loaded.loadFromFile("bench_snapshot.snap");
+        sink = sink + loaded.calculateStatistics().mean;
+        report("loadFromFile (snapshot)", sw.elapsed(), count);
+
+        Stopwatch scan;
+        sink = sink + loaded.calculateMovingAverage(5).size();
+        report("moving average on mapping", scan.elapsed(), count);
+    }
+    remove("bench_snapshot.csv");
+    remove("bench_snapshot.snap");
+}
+
+// Tröskelanalys: tre linjära pass jämfört med två binärsökningar
+void benchThreshold(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    volatile double sink = 0;
+    const size_t queries = 100;
+
+    {
+        Stopwatch sw;
+        for (size_t q = 0; q < queries; ++q) {
+            double threshold = 20.0 + q * 0.1;
+            sink = sink + dm.findAboveThreshold(threshold).size() + dm.findBelowThreshold(threshold).size()
+                 + dm.calculateStatistics().count;
+        }
+        report("find above/below (selections)", sw.elapsed(), count * queries);
+    }
+    {
+        Stopwatch sw;
+        for (size_t q = 0; q < queries; ++q) {
+            double threshold = 20.0 + q * 0.1;
+            sink = sink + dm.countAboveThreshold(threshold) + dm.countBelowThreshold(threshold);
+        }
+        report("count, linear scan", sw.elapsed(), count * queries);
+    }
+    dm.setValueIndexEnabled(true);
+    {
+        Stopwatch sw;
+        sink = sink + dm.indicesInRange(25.0, 26.0).size();
+        report("build value index", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        for (size_t q = 0; q < queries; ++q) {
+            double threshold = 20.0 + q * 0.1;
+            sink = sink + dm.countAboveThreshold(threshold) + dm.countBelowThreshold(threshold);
+        }
+        report("count, value index", sw.elapsed(), count * queries);
+    }
+}
+
+// Skalning från 1 till N trådar för de parallella svepen
+void benchScaling(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    vector<double> out(count);
+    volatile double sink = 0;
+
+    // 1, 2, 4, ... upp till antalet kärnor
+    unsigned maxThreads = max(1u, thread::hardware_concurrency());
+    vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (unsigned threads : threadCounts) {
+        dm.setThreadCount(threads);
+        cout << "--- " << threads << " thread(s) ---" << endl;
+        {
+            Stopwatch sw;
+            sink = sink + dm.scanStatistics().variance;
+            report("scanStatistics", sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            sink = sink + dm.countAboveThreshold(25.0);
+            report("countAboveThreshold", sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            sink = sink + dm.findValue(25.0, 0.01).size();
+            report("findValue", sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            sink = sink + dm.generateHistogram().binCount();
+            report("generateHistogram", sw.elapsed(), count);
+        }
+        {
+            Stopwatch sw;
+            dm.calculateMovingWindow(50, WindowAggregate::Mean, out.data());
+            sink = sink + out[0];
+            report("moving mean w=50", sw.elapsed(), count);
+        }
+    }
+}
+
+// Histogram: trädbaserad map mot platt räknarvektor
+void benchHistogram(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    const double* data = dm.measurementsView().valueData();
+    volatile double sink = 0;
+
+    {
+        Stopwatch sw;
+        map<int, int> histogram;
+        for (size_t i = 0; i < count; ++i) histogram[static_cast<int>(round(data[i]))]++;
+        sink = sink + histogram.size();
+        report("std::map<int,int> (before)", sw.elapsed(), count);
+    }
+    dm.setThreadCount(1);
+    {
+        Stopwatch sw;
+        sink = sink + dm.generateHistogram(1.0).total();
+        report("Histogram w=1, 1 thread", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        sink = sink + dm.generateHistogram(0.01).total();
+        report("Histogram w=0.01, 1 thread", sw.elapsed(), count);
+    }
+    dm.setThreadCount(0);
+    {
+        Stopwatch sw;
+        sink = sink + dm.generateHistogram(1.0).total();
+        report("Histogram w=1, all threads", sw.elapsed(), count);
+    }
+    {
+        DataManager live;
+        live.enableLiveHistogram(-50.0, 0.5, 300);
+        chrono::system_clock::time_point now = chrono::system_clock::now();
+        Stopwatch sw;
+        for (size_t i = 0; i < count; ++i) live.addMeasurement(data[i], now);
+        sink = sink + live.getLiveHistogram().total();
+        report("append + live histogram", sw.elapsed(), count);
+    }
+}
+
+// Exakta kvantiler (nth_element på en kopia) mot KLL-skissen
+void benchQuantile(size_t count) {
+    DataManager dm;
+    dm.simulateSensorData(static_cast<int>(count));
+    const double* data = dm.measurementsView().valueData();
+    const vector<double> qs = { 0.5, 0.95, 0.99 };
+    volatile double sink = 0;
+
+    vector<double> exact;
+    {
+        Stopwatch sw;
+        exact = dm.exactQuantiles(qs);
+        report("exact (nth_element)", sw.elapsed(), count);
+    }
+    KllSketch sketch;
+    {
+        Stopwatch sw;
+        sketch.updateRange(data, count);
+        report("KLL update (k=200)", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        sink = sink + sketch.quantiles(qs)[0];
+        cout << "KLL query (3 quantiles)         " << fixed << setprecision(1)
+             << sw.elapsed() * 1e6 << " us" << endl;
+    }
+
+    // Rangfel: andelen värden <= uppskattningen jämfört med önskad kvantil
+    vector<double> estimated = dm.getQuantileSketch().quantiles(qs);
+    vector<double> sorted(data, data + count);
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < qs.size(); ++i) {
+        double rank = static_cast<double>(upper_bound(sorted.begin(), sorted.end(), estimated[i]) - sorted.begin()) / count;
+        cout << "    q=" << fixed << setprecision(2) << qs[i] << "  exact " << setprecision(4) << exact[i]
+             << "  sketch " << estimated[i] << "  rank error " << setprecision(3)
+             << fabs(rank - qs[i]) * 100 << " %" << endl;
+    }
+    cout.unsetf(ios::fixed);
+    cout << "    sketch keeps " << sketch.retainedCount() << " of " << count << " values" << endl;
+}
+
+// Samtidig insamling från 1..16 producenter. Kontrollerar att varje värde
+// kommer fram exakt en gång; returnerar false vid avvikelse.
+bool benchIngest(size_t total) {
+    bool ok = true;
+    for (unsigned producerCount : { 1u, 2u, 4u, 8u, 16u }) {
+        size_t perProducer = total / producerCount;
+        DataManager dm;
+        IngestHub hub(dm);
+        vector<IngestProducer*> handles;
+        for (unsigned p = 0; p < producerCount; ++p) handles.push_back(&hub.registerProducer());
+
+        // En läsare hämtar statistik under hela körningen
+        atomic<bool> producing(true);
+        size_t snapshotsRead = 0;
+        thread reader([&] {
+            while (producing.load()) {
+                if (hub.snapshotStatistics().count > 0) ++snapshotsRead;
+                this_thread::yield();
+            }
+        });
+
+        Stopwatch sw;
+        hub.start();
+        vector<thread> producers;
+        for (unsigned p = 0; p < producerCount; ++p) {
+            producers.emplace_back([&, p] {
+                chrono::system_clock::time_point now = chrono::system_clock::now();
+                for (size_t i = 0; i < perProducer; ++i) {
+                    handles[p]->add(static_cast<double>(i % 100), now);
+                }
+            });
+        }
+        for (thread& producer : producers) producer.join();
+        hub.stop();
+        double seconds = sw.elapsed();
+        producing = false;
+        reader.join();
+
+        // Heltalsvärden ger en exakt summa att jämföra med
+        size_t expectedCount = perProducer * producerCount;
+        double expectedSum = 0;
+        for (size_t i = 0; i < perProducer; ++i) expectedSum += static_cast<double>(i % 100);
+        expectedSum *= producerCount;
+
+        DataManager::Statistics stats = hub.snapshotStatistics();
+        bool match = dm.getMeasurementCount() == expectedCount &&
+            stats.count == expectedCount &&
+            dm.getRunningStats().sum == expectedSum;
+        ok = ok && match;
+
+        ostringstream name;
+        name << producerCount << " producer(s)";
+        report(name.str(), seconds, expectedCount);
+        cout << "    " << snapshotsRead << " snapshot reads, "
+             << (match ? "count and sum verified" : "MISMATCH") << endl;
+    }
+    return ok;
+}
+
+// Tidigare formatering (localtime + put_time i en ostringstream) och
+// tolkning (get_time + mktime per rad) mot TimeCodec
+void benchTimeCodec(size_t count) {
+    // En mätning var 10:e sekund, över en sommartidsövergång
+    vector<int64_t> timestamps(count);
+    int64_t start = 1711846800LL - static_cast<int64_t>(count) * 5;  // Kring 2024-03-31 01:00 UTC
+    for (size_t i = 0; i < count; ++i) {
+        timestamps[i] = (start + static_cast<int64_t>(i) * 10) * 1000000000LL;
+    }
+    size_t sink = 0;
+
+    vector<string> texts(count);
+    double legacyFormat;
+    {
+        Stopwatch sw;
+        for (size_t i = 0; i < count; ++i) {
+            time_t t = static_cast<time_t>(timestamps[i] / 1000000000LL);
+            ostringstream oss;
+            oss << put_time(localtime(&t), "%Y-%m-%d %H:%M:%S");
+            texts[i] = oss.str();
+        }
+        legacyFormat = sw.elapsed();
+        report("localtime + put_time", legacyFormat, count);
+    }
+    for (TimeMode mode : { TimeMode::Local, TimeMode::Utc, TimeMode::Epoch }) {
+        TimeCodec codec(mode);
+        char buffer[TIME_TEXT_CAPACITY];
+        Stopwatch sw;
+        for (size_t i = 0; i < count; ++i) {
+            sink += codec.format(buffer, timestamps[i]) - buffer;
+        }
+        double seconds = sw.elapsed();
+        report(string("TimeCodec format (") + timeModeName(mode) + ")", seconds, count);
+        if (mode == TimeMode::Local) {
+            cout << "    speedup " << fixed << setprecision(1) << legacyFormat / seconds << "x" << endl;
+        }
+    }
+
+    double legacyParse;
+    {
+        Stopwatch sw;
+        for (size_t i = 0; i < count; ++i) {
+            tm parsed = {};
+            istringstream stream(texts[i]);
+            stream >> get_time(&parsed, "%Y-%m-%d %H:%M:%S");
+            parsed.tm_isdst = -1;
+            sink += static_cast<size_t>(mktime(&parsed));
+        }
+        legacyParse = sw.elapsed();
+        report("get_time + mktime", legacyParse, count);
+    }
+    {
+        TimeCodec codec(TimeMode::Local);
+        size_t mismatches = 0;
+        Stopwatch sw;
+        for (size_t i = 0; i < count; ++i) {
+            int64_t ns;
+            if (!codec.parse(texts[i].data(), texts[i].data() + texts[i].size(), ns)) ++mismatches;
+            sink += static_cast<size_t>(ns);
+        }
+        double seconds = sw.elapsed();
+        report("TimeCodec parse (local)", seconds, count);
+        cout << "    speedup " << fixed << setprecision(1) << legacyParse / seconds << "x" << endl;
+
+        // Tolkning följd av formatering ska ge tillbaka samma text
+        for (size_t i = 0; i < count; ++i) {
+            int64_t ns = 0;
+            codec.parse(texts[i].data(), texts[i].data() + texts[i].size(), ns);
+            char buffer[TIME_TEXT_CAPACITY];
+            if (string(buffer, codec.format(buffer, ns)) != texts[i]) ++mismatches;
+        }
+        cout << "    " << mismatches << " round-trip mismatches" << endl;
+    }
+    cout << "    (checksum " << sink % 1000 << ")" << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// Statistik för slumpade tidsintervall: svep över alla rader jämfört med
+// rollups plus binärsökning för de ofullständiga minuterna i kanterna
+void benchRollup(size_t count) {
+    // En mätning per sekund från 2024-01-01 00:00:00 UTC
+    vector<double> values(count);
+    vector<int64_t> timestamps(count);
+    mt19937_64 generator(7);
+    normal_distribution<double> normal(25.0, 3.0);
+    int64_t start = 1704067200LL * 1000000000LL;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = normal(generator);
+        timestamps[i] = start + static_cast<int64_t>(i) * 1000000000LL;
+    }
+
+    DataManager dm;
+    {
+        Stopwatch sw;
+        dm.appendBatch(values.data(), timestamps.data(), count);
+        report("appendBatch (incl. rollups)", sw.elapsed(), count);
+    }
+    const Rollups& rollups = dm.getRollups();
+    cout << "    " << rollups.buckets(RollupTier::Minute).size() << " minute, "
+         << rollups.buckets(RollupTier::Hour).size() << " hour, "
+         << rollups.buckets(RollupTier::Day).size() << " day buckets" << endl;
+
+    const size_t queries = 200;
+    vector<pair<int64_t, int64_t>> ranges(queries);
+    int64_t span = static_cast<int64_t>(count) * 1000000000LL;
+    for (auto& range : ranges) {
+        int64_t a = start + static_cast<int64_t>(generator() % static_cast<uint64_t>(span));
+        int64_t b = start + static_cast<int64_t>(generator() % static_cast<uint64_t>(span));
+        range = make_pair(min(a, b), max(a, b) + 1);
+    }
+
+    double sumScan = 0, sumRollup = 0;
+    double scanSeconds;
+    {
+        Stopwatch sw;
+        for (const auto& range : ranges) {
+            RunningStats stats;
+            for (size_t i = 0; i < count; ++i) {
+                if (timestamps[i] >= range.first && timestamps[i] < range.second) stats.addAt(values[i], i);
+            }
+            sumScan += stats.sum;
+        }
+        scanSeconds = sw.elapsed();
+        report("full scan per range", scanSeconds, queries);
+    }
+    {
+        Stopwatch sw;
+        for (const auto& range : ranges) {
+            sumRollup += dm.calculateRangeStatistics(fromEpochNanoseconds(range.first),
+                                                     fromEpochNanoseconds(range.second)).sum;
+        }
+        double seconds = sw.elapsed();
+        report("calculateRangeStatistics", seconds, queries);
+        cout << "    speedup " << fixed << setprecision(0) << scanSeconds / seconds << "x, sums "
+             << (fabs(sumScan - sumRollup) <= 1e-9 * fabs(sumScan) ? "match" : "DIFFER") << endl;
+        cout.unsetf(ios::fixed);
+    }
+    {
+        Stopwatch sw;
+        size_t points = 0;
+        for (size_t i = 0; i < 10; ++i) points += dm.downsample(1000, DownsampleMethod::Lttb).size();
+        report("downsample LTTB to 1000 points", sw.elapsed() / 10, count);
+        doNotOptimize(points);
+    }
+    {
+        Stopwatch sw;
+        size_t points = 0;
+        for (size_t i = 0; i < 10; ++i) points += dm.downsample(1000, DownsampleMethod::MinMax).size();
+        report("downsample min/max to 1000 points", sw.elapsed() / 10, count);
+        doNotOptimize(points);
+    }
+}
+
+// Frågor per sensor: en blandad ström med sensorkolumn som måste läsas i
+// sin helhet för varje sensor, jämfört med SensorStore som bara läser den
+// efterfrågade sensorns partition
+void benchSensors(size_t count) {
+    const uint32_t sensorCount = 1000;
+    vector<uint32_t> sensorIds(count);
+    vector<double> values(count);
+    vector<int64_t> timestamps(count);
+    mt19937_64 generator(11);
+    normal_distribution<double> normal(25.0, 3.0);
+    int64_t start = 1704067200LL * 1000000000LL;
+    for (size_t i = 0; i < count; ++i) {
+        sensorIds[i] = 1 + static_cast<uint32_t>(generator() % sensorCount);
+        values[i] = normal(generator);
+        timestamps[i] = start + static_cast<int64_t>(i) * 1000000LL;
+    }
+
+    SensorStore store;
+    for (uint32_t s = 1; s <= sensorCount; ++s) store.sensorId("sensor-" + to_string(s));
+    {
+        Stopwatch sw;
+        store.appendBatch(sensorIds.data(), values.data(), timestamps.data(), count);
+        report("appendBatch into partitions", sw.elapsed(), count);
+    }
+
+    const size_t queries = 100;
+    const double threshold = 30.0;
+    size_t countScan = 0, countStore = 0;
+    double scanSeconds;
+    {
+        Stopwatch sw;
+        for (size_t q = 0; q < queries; ++q) {
+            uint32_t sensor = 1 + static_cast<uint32_t>(q * 7 % sensorCount);
+            RunningStats stats;
+            for (size_t i = 0; i < count; ++i) {
+                if (sensorIds[i] == sensor) {
+                    stats.add(values[i]);
+                    countScan += values[i] > threshold;
+                }
+            }
+            doNotOptimize(stats.sum);
+        }
+        scanSeconds = sw.elapsed();
+        report("stats + threshold, scan of mixed stream", scanSeconds, queries);
+    }
+    {
+        Stopwatch sw;
+        for (size_t q = 0; q < queries; ++q) {
+            uint32_t sensor = 1 + static_cast<uint32_t>(q * 7 % sensorCount);
+            doNotOptimize(store.calculateStatistics(sensor).sum);
+            countStore += store.countAboveThreshold(sensor, threshold);
+        }
+        double seconds = sw.elapsed();
+        report("stats + threshold, SensorStore partition", seconds, queries);
+        cout << "    speedup " << fixed << setprecision(0) << scanSeconds / seconds << "x, counts "
+             << (countScan == countStore ? "match" : "DIFFER") << endl;
+        cout.unsetf(ios::fixed);
+    }
+    {
+        Stopwatch sw;
+        vector<SensorStore::SensorSummary> summaries = store.summarizeBySensor({ threshold });
+        report("summarizeBySensor (all sensors, one pass)", sw.elapsed(), count);
+        doNotOptimize(summaries.size());
+    }
+}
+
+// Fönster över de senaste mätvärdena i en lång ström: en deque som räknar
+// om statistiken vid varje statusrapport, jämfört med RetentionBuffer som
+// har aktuell statistik efter varje värde. Med arkiv skrivs allt utträngt
+// till fil.
+void benchRetention(size_t count) {
+    const size_t window = 100000;
+    const size_t reportEvery = 1000;
+    const char* archiveFile = "iot_bench_tmp.arc";
+    vector<double> values(count);
+    vector<int64_t> timestamps(count);
+    mt19937_64 generator(13);
+    normal_distribution<double> noise(0.0, 0.05);
+    int64_t start = 1704067200LL * 1000000000LL;
+    double level = 25.0;
+    for (size_t i = 0; i < count; ++i) {
+        level += noise(generator);
+        values[i] = round(level * 100) / 100;
+        timestamps[i] = start + static_cast<int64_t>(i) * 1000000000LL;
+    }
+
+    double dequeMean = 0;
+    {
+        Stopwatch sw;
+        deque<double> recent;
+        for (size_t i = 0; i < count; ++i) {
+            if (recent.size() == window) recent.pop_front();
+            recent.push_back(values[i]);
+            if ((i + 1) % reportEvery == 0 || i + 1 == count) {
+                RunningStats stats;
+                for (double value : recent) stats.add(value);
+                dequeMean = stats.mean;
+            }
+        }
+        report("deque, rescan every 1000", sw.elapsed(), count);
+    }
+    {
+        Stopwatch sw;
+        RetentionBuffer buffer(window);
+        double mean = 0;
+        for (size_t i = 0; i < count; ++i) {
+            buffer.addMeasurement(values[i], timestamps[i]);
+            mean = buffer.calculateStatistics().mean;
+        }
+        report("RetentionBuffer, stats per value", sw.elapsed(), count);
+        cout << "    means " << (fabs(mean - dequeMean) < 1e-9 * fabs(dequeMean) ? "match" : "DIFFER") << endl;
+    }
+    {
+        remove(archiveFile);
+        Stopwatch sw;
+        {
+            RetentionBuffer buffer(window);
+            buffer.setArchive(archiveFile);
+            buffer.appendBatch(values.data(), timestamps.data(), count);
+        }
+        report("RetentionBuffer + archive", sw.elapsed(), count);
+        FILE* file = fopen(archiveFile, "rb");
+        long size = 0;
+        if (file != nullptr) {
+            fseek(file, 0, SEEK_END);
+            size = ftell(file);
+            fclose(file);
+        }
+        size_t archived = count > window ? count - window : 0;
+        if (archived > 0) {
+            cout << "    archive " << fixed << setprecision(2) << static_cast<double>(size) / archived
+                 << " bytes/row (raw 16)" << endl;
+            cout.unsetf(ios::fixed);
+        }
+        remove(archiveFile);
+    }
+}
+
+// Komprimerade block: storlek per rad och avkodningshastighet för en
+// jämnt samplad, långsamt varierande serie (som från en verklig sensor)
+// och för DataManagers simulerade brus, samt frågor som kan svaras ur
+// blockens headers jämfört med en skanning av de okomprimerade kolumnerna
+void benchCompression(size_t count) {
+    vector<double> values(count);
+    vector<int64_t> timestamps(count);
+    mt19937_64 generator(17);
+    normal_distribution<double> noise(0.0, 0.02);
+    int64_t start = 1704067200LL * 1000000000LL;
+    double level = 21.0;
+    for (size_t i = 0; i < count; ++i) {
+        level += noise(generator) + 0.5 * sin(i * 2 * M_PI / 86400) / 86400;
+        values[i] = round(level * 100) / 100;   // Sensorns upplösning
+        timestamps[i] = start + static_cast<int64_t>(i) * 1000000000LL;
+    }
+    DataManager simulated;
+    simulated.simulateSensorData(static_cast<int>(min<size_t>(count, 10000000)));
+    MeasurementView simulatedView = simulated.measurementsView();
+
+    struct Series { const char* name; const double* values; const int64_t* timestamps; size_t count; };
+    Series series[] = {
+        { "random walk, 1 s, 0.01", values.data(), timestamps.data(), count },
+        { "simulateSensorData", simulatedView.valueData(), simulatedView.timestampData(), simulatedView.size() },
+    };
+    CompressedSeries walk;
+    for (const Series& s : series) {
+        cout << s.name << ":" << endl;
+        CompressedSeries compressed;
+        {
+            Stopwatch sw;
+            compressed.appendBatch(s.values, s.timestamps, s.count);
+            compressed.seal();
+            report("  encode", sw.elapsed(), s.count);
+        }
+        compressed.shrinkToFit();
+        cout << "    " << fixed << setprecision(2) << static_cast<double>(compressed.memoryUsage()) / s.count
+             << " bytes/row (columns 16, CSV about 25), ratio "
+             << 16.0 * s.count / compressed.memoryUsage() << "x" << endl;
+        cout.unsetf(ios::fixed);
+        {
+            vector<double> outValues(COMPRESSED_BLOCK_ROWS);
+            vector<int64_t> outTimestamps(COMPRESSED_BLOCK_ROWS);
+            double checksum = 0;
+            Stopwatch sw;
+            for (size_t b = 0; b < compressed.blockCount(); ++b) {
+                compressed.decodeBlock(b, outValues.data(), outTimestamps.data());
+                checksum += outValues[0];
+            }
+            report("  decode", sw.elapsed(), s.count);
+            doNotOptimize(checksum);
+        }
+        if (s.values == values.data()) walk.appendBatch(s.values, s.timestamps, s.count);
+    }
+    walk.seal();
+
+    const int repeats = 20;
+    double threshold = level;
+    {
+        Stopwatch sw;
+        size_t above = 0;
+        for (int r = 0; r < repeats; ++r) {
+            above += count_if(values.begin(), values.end(), [threshold](double v) { return v > threshold; });
+        }
+        report("threshold, column scan", sw.elapsed() / repeats, count);
+        doNotOptimize(above);
+    }
+    {
+        Stopwatch sw;
+        size_t above = 0;
+        for (int r = 0; r < repeats; ++r) above += walk.countAboveThreshold(threshold);
+        report("threshold, block headers", sw.elapsed() / repeats, count);
+        doNotOptimize(above);
+    }
+    {
+        Stopwatch sw;
+        double sum = 0;
+        for (int r = 0; r < repeats; ++r) sum += summarizeValues(values.data(), count).sum;
+        report("statistics, column scan", sw.elapsed() / repeats, count);
+        doNotOptimize(sum);
+    }
+    {
+        Stopwatch sw;
+        double sum = 0;
+        for (int r = 0; r < repeats; ++r) sum += walk.summary().sum;
+        report("statistics, block headers", sw.elapsed() / repeats, count);
+        doNotOptimize(sum);
+    }
+    {
+        // Ett dygn mitt i serien; bara de två kantblocken avkodas
+        int64_t from = timestamps[count / 2];
+        int64_t to = from + 86400LL * 1000000000LL;
+        Stopwatch sw;
+        double sum = 0;
+        for (int r = 0; r < repeats; ++r) sum += walk.summarizeTimeRange(from, to).sum;
+        report("one-day range, block headers", sw.elapsed() / repeats, min<size_t>(count / 2, 86400));
+        doNotOptimize(sum);
+    }
+}
+
+// Simulering: ett värde i taget via addMeasurement (före) mot batchar och
+// den blockvisa generatorn, i minnet och strömmad till fil
+void benchSimulation(size_t count) {
+    {
+        DataManager dm;
+        Stopwatch sw;
+        random_device rd;
+        mt19937 generator(rd());
+        uniform_real_distribution<double> dist(20.0, 30.0);
+        for (size_t i = 0; i < count; ++i) dm.addMeasurement(dist(generator));
+        report("addMeasurement per value", sw.elapsed(), count);
+    }
+    {
+        DataManager dm;
+        Stopwatch sw;
+        dm.simulateSensorData(static_cast<int>(count));
+        report("simulateSensorData", sw.elapsed(), count);
+    }
+
+    SimulationProfile profile;
+    unsigned cores = max(thread::hardware_concurrency(), 1u);
+    for (unsigned threads = 1; ; threads = min(threads * 2, cores)) {
+        DataManager dm;
+        dm.setThreadCount(threads);
+        dm.setParallelCutoff(0);
+        Stopwatch sw;
+        dm.simulate(profile, count);
+        report("simulate, " + to_string(threads) + " thread(s)", sw.elapsed(), dm.getMeasurementCount());
+        if (threads >= cores) break;
+    }
+
+    // Strömmat till fil; bara en grupp block hålls i minnet
+    ThreadPool pool(0);
+    SensorSimulator simulator(profile, count);
+    const char* files[] = { "iot_bench_tmp.arc", "iot_bench_tmp.csv" };
+    for (const char* file : files) {
+        Stopwatch sw;
+        simulator.saveToFile(file, TimeMode::Utc, pool.size() > 1 ? &pool : nullptr);
+        double seconds = sw.elapsed();
+        FILE* written = fopen(file, "rb");
+        long size = 0;
+        if (written != nullptr) {
+            fseek(written, 0, SEEK_END);
+            size = ftell(written);
+            fclose(written);
+        }
+        string name = file;
+        report("stream to " + name.substr(name.find('.')), seconds, count);
+        cout << "    " << fixed << setprecision(2) << static_cast<double>(size) / count << " bytes/row" << endl;
+        remove(file);
+    }
+}
+
+// Registrerade benchmarkar för DataManagers publika API. Varje körning
+// får en förgenererad datamängd; kopiering och filförberedelser ligger
+// utanför tidtagningen.
+
+const char* const BENCH_CSV_FILE = "iot_bench_tmp.csv";
+const char* const BENCH_SNAPSHOT_FILE = "iot_bench_tmp.snap";
+
+uint64_t fileSize(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr) return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+void addMeasurement(BenchState& state) {
+    const double* values = state.dataset().measurementsView().valueData();
+    chrono::system_clock::time_point now = chrono::system_clock::now();
+    while (state.keepRunning()) {
+        DataManager dm;
+        for (size_t i = 0; i < state.size(); ++i) {
+            dm.addMeasurement(values[i], now);
+        }
+        doNotOptimize(dm.getMeasurementCount());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(addMeasurement);
+
+// Ett fönster på en tiondel av datamängden, så att nio tiondelar trängs ut
+void retentionBufferAdd(BenchState& state) {
+    MeasurementView view = state.dataset().measurementsView();
+    RetentionBuffer buffer(max<size_t>(state.size() / 10, 1));
+    while (state.keepRunning()) {
+        buffer.appendBatch(view.valueData(), view.timestampData(), view.size());
+        doNotOptimize(buffer.calculateStatistics().mean);
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(retentionBufferAdd);
+
+void compressedSeriesDecode(BenchState& state) {
+    MeasurementView view = state.dataset().measurementsView();
+    CompressedSeries compressed;
+    compressed.appendBatch(view.valueData(), view.timestampData(), view.size());
+    compressed.seal();
+    while (state.keepRunning()) {
+        size_t rows = 0;
+        compressed.forEachBatch([&rows](const double*, const int64_t*, size_t count) { rows += count; });
+        doNotOptimize(rows);
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(compressedSeriesDecode);
+
+// O(1) tack vare de löpande aggregaten
+void calculateStatistics(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.calculateStatistics().variance);
+    }
+    state.setItemsProcessed(state.iterations());
+}
+IOT_BENCHMARK(calculateStatistics);
+
+void scanStatistics(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.scanStatistics().variance);
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(scanStatistics);
+
+void calculateMovingAverage(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.calculateMovingAverage(5).size());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(calculateMovingAverage);
+
+void movingWindowMax1000(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    vector<double> out(dm.movingWindowOutputCount(1000));
+    while (state.keepRunning()) {
+        doNotOptimize(dm.calculateMovingWindow(1000, WindowAggregate::Max, out.data()));
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(movingWindowMax1000);
+
+void generateHistogram(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.generateHistogram().total());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(generateHistogram);
+
+void findAboveThreshold(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.findAboveThreshold(29.0).size());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(findAboveThreshold);
+
+void findBelowThreshold(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.findBelowThreshold(21.0).size());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(findBelowThreshold);
+
+void countAboveThresholdLinear(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.countAboveThreshold(29.0));
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(countAboveThresholdLinear);
+
+// Frågetid med ett redan byggt värdeindex
+void countAboveThresholdIndexed(BenchState& state) {
+    DataManager dm(state.dataset());
+    dm.setValueIndexEnabled(true);
+    dm.countAboveThreshold(29.0);
+    while (state.keepRunning()) {
+        doNotOptimize(dm.countAboveThreshold(29.0));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+IOT_BENCHMARK(countAboveThresholdIndexed);
+
+void sortMeasurementsAscending(BenchState& state) {
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        DataManager dm(state.dataset());
+        state.resumeTiming();
+        dm.sortMeasurementsAscending();
+        doNotOptimize(dm.getMeasurementCount());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK_MAX_SIZE(sortMeasurementsAscending, 10000000);
+
+void sortMeasurementsDescending(BenchState& state) {
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        DataManager dm(state.dataset());
+        state.resumeTiming();
+        dm.sortMeasurementsDescending();
+        doNotOptimize(dm.getMeasurementCount());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK_MAX_SIZE(sortMeasurementsDescending, 10000000);
+
+void saveToFileCsv(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.saveToFile(BENCH_CSV_FILE));
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+    state.setBytesProcessed(state.iterations() * fileSize(BENCH_CSV_FILE));
+    remove(BENCH_CSV_FILE);
+}
+IOT_BENCHMARK_MAX_SIZE(saveToFileCsv, 10000000);
+
+void loadFromFileCsv(BenchState& state) {
+    state.dataset().saveToFile(BENCH_CSV_FILE);
+    while (state.keepRunning()) {
+        DataManager dm;
+        doNotOptimize(dm.loadFromFile(BENCH_CSV_FILE));
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+    state.setBytesProcessed(state.iterations() * fileSize(BENCH_CSV_FILE));
+    remove(BENCH_CSV_FILE);
+}
+IOT_BENCHMARK_MAX_SIZE(loadFromFileCsv, 10000000);
+
+void saveToFileSnapshot(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.saveToFile(BENCH_SNAPSHOT_FILE));
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+    state.setBytesProcessed(state.iterations() * fileSize(BENCH_SNAPSHOT_FILE));
+    remove(BENCH_SNAPSHOT_FILE);
+}
+IOT_BENCHMARK_MAX_SIZE(saveToFileSnapshot, 10000000);
+
+// Laddning plus ett fullt svep, så att de mappade sidorna faktiskt läses
+void loadFromFileSnapshot(BenchState& state) {
+    state.dataset().saveToFile(BENCH_SNAPSHOT_FILE);
+    while (state.keepRunning()) {
+        DataManager dm;
+        dm.loadFromFile(BENCH_SNAPSHOT_FILE);
+        doNotOptimize(dm.scanStatistics().sum);
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+    state.setBytesProcessed(state.iterations() * fileSize(BENCH_SNAPSHOT_FILE));
+    remove(BENCH_SNAPSHOT_FILE);
+}
+IOT_BENCHMARK_MAX_SIZE(loadFromFileSnapshot, 10000000);
+
+// Mittersta halvan av datamängden (en mätning per sekund) ur rollups
+void calculateRangeStatistics(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    MeasurementView view = dm.measurementsView();
+    if (view.empty()) return;
+    chrono::system_clock::time_point first = view[0].timestamp;
+    chrono::system_clock::time_point last = view[view.size() - 1].timestamp;
+    chrono::system_clock::time_point from = first + (last - first) / 4;
+    chrono::system_clock::time_point to = last - (last - first) / 4;
+    while (state.keepRunning()) {
+        doNotOptimize(dm.calculateRangeStatistics(from, to).sum);
+    }
+    state.setItemsProcessed(state.iterations() * state.size() / 2);
+}
+IOT_BENCHMARK(calculateRangeStatistics);
+
+// Två binärsökningar i tidsindexet, oberoende av storleken
+void countInTimeRange(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    MeasurementView view = dm.measurementsView();
+    if (view.empty()) return;
+    chrono::system_clock::time_point first = view[0].timestamp;
+    chrono::system_clock::time_point last = view[view.size() - 1].timestamp;
+    chrono::system_clock::time_point from = first + (last - first) / 4;
+    chrono::system_clock::time_point to = last - (last - first) / 4;
+    while (state.keepRunning()) {
+        doNotOptimize(dm.countInTimeRange(from, to));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+IOT_BENCHMARK(countInTimeRange);
+
+void calculateMovingWindowInTimeRange(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    MeasurementView view = dm.measurementsView();
+    if (view.empty()) return;
+    chrono::system_clock::time_point first = view[0].timestamp;
+    chrono::system_clock::time_point last = view[view.size() - 1].timestamp;
+    chrono::system_clock::time_point from = first + (last - first) / 4;
+    chrono::system_clock::time_point to = last - (last - first) / 4;
+    vector<double> out(dm.countInTimeRange(from, to));
+    while (state.keepRunning()) {
+        doNotOptimize(dm.calculateMovingWindow(chrono::minutes(1), WindowAggregate::Mean, from, to, out.data()));
+    }
+    state.setItemsProcessed(state.iterations() * out.size());
+}
+IOT_BENCHMARK(calculateMovingWindowInTimeRange);
+
+void downsampleLttb(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.downsample(1000, DownsampleMethod::Lttb).size());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(downsampleLttb);
+
+void downsampleMinMax(BenchState& state) {
+    const DataManager& dm = state.dataset();
+    while (state.keepRunning()) {
+        doNotOptimize(dm.downsample(1000, DownsampleMethod::MinMax).size());
+    }
+    state.setItemsProcessed(state.iterations() * state.size());
+}
+IOT_BENCHMARK(downsampleMinMax);
+
+// Jämförelsesviterna från tidigare optimeringar
+const char* const COMPARISON_SUITES[] = {
+    "load", "columns", "stats", "window", "snapshot", "threshold", "scaling",
+    "histogram", "quantile", "ingest", "time", "rollup", "sensors", "retention", "compression", "simulation", "all"
+};
+
+bool isComparisonSuite(const string& name) {
+    for (const char* suite : COMPARISON_SUITES) {
+        if (name == suite) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Utan svitnamn körs de registrerade benchmarkarna
+    if (argc < 2 || !isComparisonSuite(argv[1])) {
+        return runRegisteredBenchmarks(argc, argv);
+    }
+    string suite = argv[1];
+    size_t size = argc > 2 ? stoul(argv[2]) : 0;
+
+    if (suite == "load" || suite == "all") {
+        cout << "=== CSV LOAD THROUGHPUT ===" << endl;
+        benchLoad(size > 0 ? size : 10000000);
+    }
+    if (suite == "columns" || suite == "all") {
+        cout << "=== ROW vs COLUMN STORAGE ===" << endl;
+        benchColumns(size > 0 ? size : 50000000);
+    }
+    if (suite == "stats" || suite == "all") {
+        cout << "=== STATISTICS KERNEL ===" << endl;
+        benchStatistics(size > 0 ? size : 50000000);
+    }
+    if (suite == "window" || suite == "all") {
+        cout << "=== MOVING WINDOW ===" << endl;
+        benchMovingWindow(size > 0 ? size : 10000000);
+    }
+    if (suite == "snapshot" || suite == "all") {
+        cout << "=== SNAPSHOT vs CSV ===" << endl;
+        benchSnapshot(size > 0 ? size : 10000000);
+    }
+    if (suite == "threshold" || suite == "all") {
+        cout << "=== THRESHOLD QUERIES ===" << endl;
+        benchThreshold(size > 0 ? size : 10000000);
+    }
+    if (suite == "scaling" || suite == "all") {
+        cout << "=== PARALLEL SCALING ===" << endl;
+        benchScaling(size > 0 ? size : 100000000);
+    }
+    if (suite == "histogram" || suite == "all") {
+        cout << "=== HISTOGRAM ===" << endl;
+        benchHistogram(size > 0 ? size : 50000000);
+    }
+    if (suite == "quantile" || suite == "all") {
+        cout << "=== QUANTILES ===" << endl;
+        benchQuantile(size > 0 ? size : 20000000);
+    }
+    if (suite == "time" || suite == "all") {
+        cout << "=== TIMESTAMP FORMATTING AND PARSING ===" << endl;
+        benchTimeCodec(size > 0 ? size : 5000000);
+    }
+    if (suite == "rollup" || suite == "all") {
+        cout << "=== TIME RANGE STATISTICS AND DOWNSAMPLING ===" << endl;
+        benchRollup(size > 0 ? size : 10000000);
+    }
+    if (suite == "sensors" || suite == "all") {
+        cout << "=== PER-SENSOR PARTITIONS ===" << endl;
+        benchSensors(size > 0 ? size : 10000000);
+    }
+    if (suite == "retention" || suite == "all") {
+        cout << "=== RETENTION WINDOW ===" << endl;
+        benchRetention(size > 0 ? size : 10000000);
+    }
+    if (suite == "compression" || suite == "all") {
+        cout << "=== COMPRESSED BLOCKS ===" << endl;
+        benchCompression(size > 0 ? size : 10000000);
+    }
+    if (suite == "simulation" || suite == "all") {
+        cout << "=== SENSOR SIMULATION ===" << endl;
+        benchSimulation(size > 0 ? size : 10000000);
+    }
+    if (suite == "ingest" || suite == "all") {
+        cout << "=== CONCURRENT INGESTION ===" << endl;
+        if (!benchIngest(size > 0 ? size : 16000000)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+#include "bench_harness.h"
+#include "data_manager.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+struct Registration {
+    string name;
+    BenchFunction function;
+    size_t maxSize;
+};
+
+vector<Registration>& registry() {
+    static vector<Registration> benchmarks;
+    return benchmarks;
+}
+
+struct Result {
+    string name;
+    size_t size;
+    Distribution distribution;
+    uint64_t iterations;
+    double seconds;
+    uint64_t items;
+    uint64_t bytes;
+};
+
+const Distribution ALL_DISTRIBUTIONS[] = {
+    Distribution::Uniform, Distribution::Normal, Distribution::Sorted, Distribution::Spiky
+};
+
+// Generera en datamängd med en mätning per sekund; samma frö ger samma data
+unique_ptr<DataManager> generateDataset(size_t count, Distribution distribution) {
+    unique_ptr<DataManager> dm(new DataManager());
+    mt19937_64 generator(42);
+    uniform_real_distribution<double> uniform(20.0, 30.0);
+    normal_distribution<double> normal(25.0, 3.0);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const size_t batchSize = 1 << 16;
+    vector<double> values(batchSize);
+    vector<int64_t> timestamps(batchSize);
+    int64_t start = 1704067200LL * 1000000000LL;  // 2024-01-01 00:00:00 UTC
+    for (size_t done = 0; done < count; ) {
+        size_t n = min(batchSize, count - done);
+        for (size_t i = 0; i < n; ++i) {
+            size_t index = done + i;
+            double value;
+            switch (distribution) {
+                case Distribution::Uniform: value = uniform(generator); break;
+                case Distribution::Normal: value = normal(generator); break;
+                case Distribution::Sorted: value = 20.0 + 10.0 * index / max<size_t>(1, count); break;
+                default:
+                    value = normal(generator);
+                    if (unit(generator) < 0.01) value += unit(generator) < 0.5 ? -40.0 : 60.0;
+                    break;
+            }
+            values[i] = value;
+            timestamps[i] = start + static_cast<int64_t>(index) * 1000000000LL;
+        }
+        dm->appendBatch(values.data(), timestamps.data(), n);
+        done += n;
+    }
+    return dm;
+}
+
+bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double number = strtod(text.c_str(), &end);
+    string suffix(end);
+    if (end == text.c_str() || number <= 0) return false;
+    if (suffix == "K" || suffix == "k") number *= 1e3;
+    else if (suffix == "M" || suffix == "m") number *= 1e6;
+    else if (suffix == "G" || suffix == "g") number *= 1e9;
+    else if (!suffix.empty()) return false;
+    size = static_cast<size_t>(number);
+    return true;
+}
+
+vector<string> splitList(const string& text) {
+    vector<string> parts;
+    stringstream stream(text);
+    string part;
+    while (getline(stream, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+string formatSize(size_t size) {
+    if (size >= 1000000 && size % 1000000 == 0) return to_string(size / 1000000) + "M";
+    if (size >= 1000 && size % 1000 == 0) return to_string(size / 1000) + "K";
+    return to_string(size);
+}
+
+string jsonEscape(const string& text) {
+    string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+void writeJson(ostream& out, const vector<Result>& results, double minTime) {
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n"
+#ifdef NDEBUG
+        << "    \"build_type\": \"release\",\n"
+#else
+        << "    \"build_type\": \"debug\",\n"
+#endif
+        << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+        << "    \"min_time\": " << minTime << "\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        double perIteration = r.seconds / r.iterations;
+        out << (i > 0 ? "," : "") << "\n    {"
+            << "\"name\": \"" << r.name << "/" << r.size << "/" << distributionName(r.distribution) << "\", "
+            << "\"family\": \"" << r.name << "\", "
+            << "\"size\": " << r.size << ", "
+            << "\"distribution\": \"" << distributionName(r.distribution) << "\", "
+            << "\"iterations\": " << r.iterations << ", "
+            << "\"real_time_ns\": " << setprecision(6) << perIteration * 1e9 << ", "
+            << "\"items_per_second\": " << (r.items > 0 ? r.items / r.seconds : 0) << ", "
+            << "\"bytes_per_second\": " << (r.bytes > 0 ? r.bytes / r.seconds : 0) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+const char* distributionName(Distribution distribution) {
+    switch (distribution) {
+        case Distribution::Uniform: return "uniform";
+        case Distribution::Normal: return "normal";
+        case Distribution::Sorted: return "sorted";
+        default: return "spiky";
+    }
+}
+
+BenchState::BenchState(size_t size, Distribution distribution, const DataManager* data, uint64_t iterations)
+    : datasetSize(size), datasetDistribution(distribution), data(data), targetIterations(iterations),
+      completedIterations(0), items(0), bytes(0), started(false), paused(false),
+      pausedTotal(0), elapsedTotal(0) {
+}
+
+bool BenchState::keepRunning() {
+    if (!started) {
+        started = true;
+        startTime = chrono::steady_clock::now();
+        return targetIterations > 0;
+    }
+    if (++completedIterations < targetIterations) {
+        return true;
+    }
+    if (paused) resumeTiming();
+    elapsedTotal = chrono::steady_clock::now() - startTime - pausedTotal;
+    return false;
+}
+
+void BenchState::pauseTiming() {
+    if (paused) return;
+    paused = true;
+    pauseTime = chrono::steady_clock::now();
+}
+
+void BenchState::resumeTiming() {
+    if (!paused) return;
+    paused = false;
+    pausedTotal += chrono::steady_clock::now() - pauseTime;
+}
+
+double BenchState::seconds() const {
+    return chrono::duration<double>(elapsedTotal).count();
+}
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunction function, size_t maxSize) {
+    registry().push_back(Registration{ name, function, maxSize });
+}
+
+int runRegisteredBenchmarks(int argc, char* argv[]) {
+    string filter;
+    string jsonFile;
+    double minTime = 0.2;
+    vector<size_t> sizes = { 1000, 100000, 1000000 };
+    vector<Distribution> distributions = { Distribution::Uniform };
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--list") {
+            for (const Registration& r : registry()) cout << r.name << endl;
+            return 0;
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "--json" && hasValue) {
+            jsonFile = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            minTime = atof(argv[++i]);
+        } else if (arg == "--sizes" && hasValue) {
+            string list = argv[++i];
+            sizes.clear();
+            if (list == "full") list = "1K,10K,100K,1M,10M,100M";
+            for (const string& part : splitList(list)) {
+                size_t size;
+                if (!parseSize(part, size)) {
+                    cerr << "Invalid size: " << part << endl;
+                    return 2;
+                }
+                sizes.push_back(size);
+            }
+        } else if (arg == "--distributions" && hasValue) {
+            distributions.clear();
+            for (const string& part : splitList(argv[++i])) {
+                bool found = false;
+                for (Distribution d : ALL_DISTRIBUTIONS) {
+                    if (part == "all" || part == distributionName(d)) {
+                        distributions.push_back(d);
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    cerr << "Unknown distribution: " << part << endl;
+                    return 2;
+                }
+            }
+        } else {
+            cerr << "Unknown argument: " << arg << endl;
+            return 2;
+        }
+    }
+
+    // Tabellen går till stderr när JSON skrivs till stdout
+    bool jsonToStdout = jsonFile == "-";
+    ostream& table = jsonToStdout ? cerr : cout;
+    table << left << setw(48) << "Benchmark" << right << setw(12) << "Iterations"
+          << setw(16) << "Time/iter" << setw(16) << "Items/s" << endl;
+    table << string(92, '-') << endl;
+
+    vector<Result> results;
+    for (size_t size : sizes) {
+        for (Distribution distribution : distributions) {
+            unique_ptr<DataManager> dataset;
+            for (const Registration& r : registry()) {
+                if (r.name.find(filter) == string::npos || size > r.maxSize) continue;
+                if (!dataset) dataset = generateDataset(size, distribution);
+
+                // Öka antalet iterationer tills körningen är tillräckligt lång
+                uint64_t iterations = 1;
+                unique_ptr<BenchState> state;
+                while (true) {
+                    state.reset(new BenchState(size, distribution, dataset.get(), iterations));
+                    r.function(*state);
+                    if (!state->skipped().empty() || state->seconds() >= minTime || iterations >= 1000000000) break;
+                    double estimate = state->seconds() > 0 ? minTime * 1.4 / state->seconds() * iterations
+                                                           : iterations * 10.0;
+                    iterations = static_cast<uint64_t>(min(max(estimate, iterations * 2.0), iterations * 100.0));
+                }
+
+                string label = r.name + "/" + formatSize(size) + "/" + distributionName(distribution);
+                if (!state->skipped().empty()) {
+                    table << left << setw(48) << label << " skipped: " << state->skipped() << endl;
+                    continue;
+                }
+                Result result = { r.name, size, distribution, state->iterations(), state->seconds(),
+                                  state->itemsProcessed(), state->bytesProcessed() };
+                results.push_back(result);
+
+                double perIteration = result.seconds / result.iterations;
+                ostringstream time;
+                if (perIteration >= 1) time << fixed << setprecision(3) << perIteration << " s";
+                else if (perIteration >= 1e-3) time << fixed << setprecision(3) << perIteration * 1e3 << " ms";
+                else if (perIteration >= 1e-6) time << fixed << setprecision(3) << perIteration * 1e6 << " us";
+                else time << fixed << setprecision(1) << perIteration * 1e9 << " ns";
+                ostringstream rate;
+                if (result.items > 0) rate << fixed << setprecision(1) << result.items / result.seconds / 1e6 << " M";
+                table << left << setw(48) << label << right << setw(12) << result.iterations
+                      << setw(16) << time.str() << setw(16) << rate.str() << endl;
+            }
+        }
+    }
+
+    if (jsonToStdout) {
+        writeJson(cout, results, minTime);
+    } else if (!jsonFile.empty()) {
+        ofstream out(jsonFile);
+        if (!out) {
+            cerr << "Could not write " << jsonFile << endl;
+            return 1;
+        }
+        writeJson(out, results, minTime);
+        table << "Results written to " << jsonFile << endl;
+    }
+    return 0;
+}
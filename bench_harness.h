@@ -0,0 +1,112 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal benchmarkram i stil med Google Benchmark, utan externa beroenden.
+//
+// En benchmark är en funktion som registreras med IOT_BENCHMARK och körs
+// för varje kombination av datamängdsstorlek och värdefördelning:
+//
+//   void benchSomething(BenchState& state) {
+//       DataManager dm = state.dataset();   // förberett, ingår inte i tiden
+//       while (state.keepRunning()) {
+//           doNotOptimize(dm.scanStatistics());
+//       }
+//       state.setItemsProcessed(state.iterations() * state.size());
+//   }
+//   IOT_BENCHMARK(benchSomething);
+//
+// Antalet iterationer ökas tills en körning tar minst minTime sekunder.
+// Resultaten skrivs som tabell och kan sparas som JSON för att följa
+// prestanda mellan releaser.
+
+class DataManager;
+
+// Värdefördelningar för genererade datamängder
+enum class Distribution {
+    Uniform,     // Likformigt 20-30 som simulateSensorData
+    Normal,      // Normalfördelat kring 25 med standardavvikelse 3
+    Sorted,      // Stigande värden (redan sorterat, t.ex. en drift)
+    Spiky        // Normalfördelat med 1 % extrema toppar
+};
+
+const char* distributionName(Distribution distribution);
+
+class BenchState {
+private:
+    size_t datasetSize;
+    Distribution datasetDistribution;
+    const DataManager* data;
+    std::uint64_t targetIterations;
+    std::uint64_t completedIterations;
+    std::uint64_t items;
+    std::uint64_t bytes;
+    bool started;
+    bool paused;
+    std::string skipReason;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point pauseTime;
+    std::chrono::steady_clock::duration pausedTotal;
+    std::chrono::steady_clock::duration elapsedTotal;
+
+public:
+    BenchState(size_t size, Distribution distribution, const DataManager* data, std::uint64_t iterations);
+
+    // Sant så länge fler iterationer ska köras; första anropet startar klockan
+    bool keepRunning();
+
+    // Undanta förberedelser inne i loopen från tidtagningen
+    void pauseTiming();
+    void resumeTiming();
+
+    size_t size() const { return datasetSize; }
+    Distribution distribution() const { return datasetDistribution; }
+    // Förgenererad datamängd med size() mätvärden (en kopia tas vid behov)
+    const DataManager& dataset() const { return *data; }
+
+    std::uint64_t iterations() const { return completedIterations; }
+    void setItemsProcessed(std::uint64_t count) { items = count; }
+    void setBytesProcessed(std::uint64_t count) { bytes = count; }
+    // Hoppa över kombinationen, t.ex. när storleken är orimlig för benchmarken
+    void skip(const std::string& reason) { skipReason = reason; }
+
+    std::uint64_t itemsProcessed() const { return items; }
+    std::uint64_t bytesProcessed() const { return bytes; }
+    const std::string& skipped() const { return skipReason; }
+    double seconds() const;
+};
+
+typedef void (*BenchFunction)(BenchState&);
+
+// Registrering sker vid programstart via IOT_BENCHMARK
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFunction function, size_t maxSize);
+};
+
+#define IOT_BENCHMARK(function) \
+    static BenchRegistrar function##_registrar(#function, function, SIZE_MAX)
+// Som IOT_BENCHMARK men körs bara upp till maxSize värden (t.ex. långsamma sorteringar)
+#define IOT_BENCHMARK_MAX_SIZE(function, maxSize) \
+    static BenchRegistrar function##_registrar(#function, function, maxSize)
+
+// Hindra kompilatorn från att optimera bort ett resultat
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Kör de registrerade benchmarkarna enligt kommandoradsflaggorna:
+//   --filter TEXT          bara benchmarkar vars namn innehåller TEXT
+//   --sizes 1K,1M,...      datamängdsstorlekar (suffix K/M), "full" = 1K..100M
+//   --distributions a,b    uniform, normal, sorted, spiky eller all
+//   --min-time S           minsta körtid per mätning (standard 0.2 s)
+//   --json FILE            spara resultaten som JSON ("-" = stdout)
+//   --list                 lista registrerade benchmarkar
+int runRegisteredBenchmarks(int argc, char* argv[]);
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,1199 @@
+#include "cli.h"
+#include "archive.h"
+#include "csv_reader.h"
+#include "csv_writer.h"
+#include "data_manager.h"
+#include "metrics.h"
+#include "retention_buffer.h"
+#include "sensor_simulator.h"
+#include "sensor_store.h"
+#include "snapshot.h"
+#include "stream_analyzer.h"
+#include "thread_pool.h"
+#include "time_codec.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+enum class OutputFormat { Csv, Json, Text };
+
+// Flaggor som inte tar något värde
+const char* const BOOLEAN_FLAGS[] = { "--rows", "--help" };
+
+// Tolkade argument: kommando, positionsargument och --flagga värde
+struct Arguments {
+    string command;
+    vector<string> positional;
+    multimap<string, string> options;
+
+    bool has(const string& key) const { return options.count(key) > 0; }
+
+    string get(const string& key, const string& fallback) const {
+        auto it = options.find(key);
+        return it != options.end() ? it->second : fallback;
+    }
+
+    vector<string> all(const string& key) const {
+        vector<string> result;
+        auto range = options.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) result.push_back(it->second);
+        return result;
+    }
+};
+
+void printUsage() {
+    cerr << "Usage: iot_analyzer [COMMAND [ARGS]]\n"
+            "Without a command the interactive menu is started.\n"
+            "\n"
+            "Commands:\n"
+            "  convert INPUT [OUTPUT]                 Convert between CSV, .snap and .arc (OUTPUT defaults to stdout)\n"
+            "  stats INPUT [--from T] [--to T]        Count, sum, mean, min, max, variance, percentiles\n"
+            "  threshold INPUT --above X | --below X | --range LOW:HIGH [--rows]\n"
+            "                                         Count matching values, or print matching rows as CSV\n"
+            "  moving-average INPUT --window N | --minutes M [--aggregate mean|min|max|variance|stddev]\n"
+            "                                         Moving window series as CSV\n"
+            "  histogram INPUT [--width W | --bins LOW:WIDTH:BINS]\n"
+            "  rollup INPUT [--tier minute|hour|day] [--from T] [--to T]\n"
+            "                                         Per-minute/hour/day count, mean, min, max, stddev\n"
+            "  range-stats INPUT --from T --to T      Statistics for from <= timestamp < to, via the rollups\n"
+            "  downsample INPUT --points N [--method minmax|lttb]\n"
+            "                                         Representative rows for plotting, as CSV\n"
+            "  sensors INPUT [--threshold X]... [--sensor NAME]...\n"
+            "                                         Per-sensor count, mean, min, max, stddev and counts\n"
+            "                                         above each threshold, for \"timestamp,sensor,value\" CSV\n"
+            "  monitor INPUT --keep N [--minutes M] [--every K] [--archive FILE]\n"
+            "                                         Follow INPUT line by line keeping only the last N\n"
+            "                                         readings (and at most M minutes); prints a CSV status\n"
+            "                                         row every K readings. Evicted readings are appended\n"
+            "                                         to FILE (.arc), which convert and stats can read\n"
+            "  simulate COUNT [OUTPUT] [--seed N] [--start T] [--interval SECONDS]\n"
+            "           [--baseline V] [--drift PER_DAY] [--diurnal AMPLITUDE] [--noise STDDEV]\n"
+            "           [--spikes RATE] [--spike-size V] [--dropouts RATE] [--dropout-length ROWS]\n"
+            "           [--resolution R]\n"
+            "                                         Generate simulated readings (OUTPUT defaults to stdout;\n"
+            "                                         .arc and CSV are streamed). The same seed gives the\n"
+            "                                         same series for any --threads\n"
+            "  analyze INPUT [--threshold X]... [--window N] [--moving-average-out FILE]\n"
+            "                [--histogram LOW:WIDTH:BINS]\n"
+            "                                         Single bounded-memory pass, input is never loaded\n"
+            "\n"
+            "Options:\n"
+            "  --format csv|json   Output format for summaries (analyze also accepts text)\n"
+            "  --threads N         Worker threads, 0 = all cores (default)\n"
+            "  --time local|utc|epoch\n"
+            "                      Timestamp format in CSV input and output (default local);\n"
+            "                      epoch seconds are always accepted on input\n"
+            "  -o FILE             Output file for series (default stdout)\n"
+            "  --from T, --to T    Time bounds as \"YYYY-MM-DD HH:MM[:SS]\" (per --time) or epoch seconds;\n"
+            "                      stats, threshold, moving-average and histogram then only use\n"
+            "                      measurements with from <= timestamp < to, in time order\n"
+            "  --sensor NAME       Only rows from this sensor (repeatable); INPUT has a sensor column\n"
+            "  --metrics FILE      Export timing and throughput metrics after the command\n"
+            "                      (.json for JSON, otherwise Prometheus text; - = stderr)\n"
+            "\n"
+            "Use - as INPUT to read CSV from stdin.\n";
+}
+
+bool isBooleanFlag(const string& arg) {
+    for (const char* flag : BOOLEAN_FLAGS) {
+        if (arg == flag) return true;
+    }
+    return false;
+}
+
+bool parseArguments(int argc, char* argv[], Arguments& args, string& error) {
+    args.command = argv[1];
+    // Äldre stavning från analysläget
+    if (args.command == "--analyze") args.command = "analyze";
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-o") arg = "--output";
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            if (isBooleanFlag(arg)) {
+                args.options.emplace(arg, "");
+            } else if (i + 1 < argc) {
+                args.options.emplace(arg, argv[++i]);
+            } else {
+                error = "missing value for " + arg;
+                return false;
+            }
+        } else {
+            args.positional.push_back(arg);
+        }
+    }
+    return true;
+}
+
+// Tal med kortaste exakta representation; NaN och oändligheter blir null i JSON
+string formatNumber(double value, OutputFormat format) {
+    if (!std::isfinite(value)) {
+        if (format == OutputFormat::Json) return "null";
+        return std::isnan(value) ? "nan" : (value > 0 ? "inf" : "-inf");
+    }
+    char buffer[64];
+    // Heltal (t.ex. antal) skrivs utan exponent; kortaste form ger annars "2e+05"
+    if (value == std::trunc(value) && std::fabs(value) < 9007199254740992.0) {
+        to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), static_cast<int64_t>(value));
+        return string(buffer, result.ptr);
+    }
+    to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), value);
+    return string(buffer, result.ptr);
+}
+
+bool parseNumber(const string& text, double& value) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    value = strtod(begin, &end);
+    return end != begin && *end == '\0';
+}
+
+bool parseCount(const string& text, size_t& value) {
+    double number;
+    if (!parseNumber(text, number) || number < 0 || number != floor(number)) return false;
+    value = static_cast<size_t>(number);
+    return true;
+}
+
+string jsonString(const string& text) {
+    string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+// En tabell där kolumner med text citeras i JSON
+struct Table {
+    vector<string> columns;
+    vector<bool> textColumns;
+    vector<vector<string>> rows;
+
+    void addColumn(const string& name, bool text = false) {
+        columns.push_back(name);
+        textColumns.push_back(text);
+    }
+};
+
+// CSV: header och rader. JSON: ett objekt om singleObject, annars en array av objekt.
+void writeTable(const Table& table, OutputFormat format, bool singleObject) {
+    if (format == OutputFormat::Json) {
+        string out = singleObject ? "" : "[";
+        for (size_t r = 0; r < table.rows.size(); ++r) {
+            if (r > 0) out += ",";
+            if (!singleObject) out += "\n  ";
+            out += "{";
+            for (size_t c = 0; c < table.columns.size(); ++c) {
+                if (c > 0) out += ", ";
+                const string& cell = table.rows[r][c];
+                out += jsonString(table.columns[c]) + ": " + (table.textColumns[c] ? jsonString(cell) : cell);
+            }
+            out += "}";
+        }
+        out += singleObject ? "\n" : "\n]\n";
+        fputs(out.c_str(), stdout);
+        return;
+    }
+
+    string out;
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        out += (c > 0 ? "," : "") + table.columns[c];
+    }
+    out += "\n";
+    for (const auto& row : table.rows) {
+        for (size_t c = 0; c < row.size(); ++c) {
+            out += (c > 0 ? "," : "") + row[c];
+        }
+        out += "\n";
+    }
+    fputs(out.c_str(), stdout);
+}
+
+bool parseFormat(const Arguments& args, OutputFormat& format, bool allowText) {
+    string name = args.get("--format", allowText ? "text" : "csv");
+    if (name == "csv" && !allowText) format = OutputFormat::Csv;
+    else if (name == "json") format = OutputFormat::Json;
+    else if (name == "text" && allowText) format = OutputFormat::Text;
+    else {
+        cerr << "Error: Unsupported --format " << name << endl;
+        return false;
+    }
+    return true;
+}
+
+bool parseTimeOption(const Arguments& args, TimeMode& mode) {
+    string name = args.get("--time", "local");
+    if (!parseTimeMode(name, mode)) {
+        cerr << "Error: Unsupported --time " << name << " (expected local, utc or epoch)" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool parseThreadOption(const Arguments& args, unsigned& threads) {
+    size_t threadCount = 0;
+    if (args.has("--threads") && !parseCount(args.get("--threads", "0"), threadCount)) {
+        cerr << "Error: --threads expects a non-negative integer" << endl;
+        return false;
+    }
+    threads = static_cast<unsigned>(threadCount);
+    return true;
+}
+
+// Gemensamma indataflaggor: tidsformat, antal trådar och att INPUT finns
+bool parseInputOptions(const Arguments& args, TimeMode& timeMode, unsigned& threads) {
+    if (!parseTimeOption(args, timeMode)) return false;
+    if (!parseThreadOption(args, threads)) return false;
+
+    if (args.positional.empty()) {
+        cerr << "Error: " << args.command << " needs an INPUT file (or - for stdin)" << endl;
+        return false;
+    }
+    const string& input = args.positional[0];
+    if (input != DataManager::STANDARD_STREAM) {
+        FILE* file = fopen(input.c_str(), "rb");
+        if (file == nullptr) {
+            cerr << "Error: Could not open file for reading: " << input << endl;
+            return false;
+        }
+        fclose(file);
+    }
+    return true;
+}
+
+// Läs indata och ställ in trådar och tidsformat; felmeddelanden skrivs av DataManager.
+// Med --sensor NAME (kan upprepas) läses bara de sensorernas rader.
+bool loadInput(DataManager& dm, const Arguments& args) {
+    TimeMode timeMode;
+    unsigned threads;
+    if (!parseInputOptions(args, timeMode, threads)) return false;
+    dm.setTimeMode(timeMode);
+    dm.setThreadCount(threads);
+
+    // loadFromFile returnerar false även för en tom fil, vilket inte är
+    // ett fel här; resultatet blir då en tom analys. En fil som inte kunde
+    // läsas är däremot ett fel.
+    const string& input = args.positional[0];
+    vector<string> sensorNames = args.all("--sensor");
+    if (sensorNames.empty()) {
+        return dm.loadFromFile(input) || !dm.getLastLoadReport().failed;
+    }
+
+    SensorStore store;
+    store.setTimeMode(timeMode);
+    if (!store.loadFromFile(input) && store.getLastLoadReport().failed) return false;
+    for (const string& name : sensorNames) {
+        uint32_t sensor;
+        if (!store.findSensor(name, sensor)) {
+            cerr << "Error: Unknown sensor " << name << " in " << input << endl;
+            return false;
+        }
+        store.copySensorTo(sensor, dm);
+    }
+    return true;
+}
+
+bool loadSensorInput(SensorStore& store, const Arguments& args) {
+    TimeMode timeMode;
+    unsigned threads;
+    if (!parseInputOptions(args, timeMode, threads)) return false;
+    store.setTimeMode(timeMode);
+    store.setThreadCount(threads);
+    return store.loadFromFile(args.positional[0]) || !store.getLastLoadReport().failed;
+}
+
+// Tidsgräns från --from/--to; saknas flaggan används fallback
+bool parseTimeBound(const Arguments& args, const string& key, TimeMode mode, int64_t fallback,
+                    int64_t& timestampNs) {
+    if (!args.has(key)) {
+        timestampNs = fallback;
+        return true;
+    }
+    string text = args.get(key, "");
+    TimeCodec codec(mode);
+    if (!codec.parse(text.data(), text.data() + text.size(), timestampNs)) {
+        cerr << "Error: Invalid " << key << " " << text << endl;
+        return false;
+    }
+    return true;
+}
+
+// Valfritt tidsintervall [--from, --to); utan någon av flaggorna gäller
+// hela tidsaxeln och ranged blir falskt
+bool parseTimeRange(const Arguments& args, TimeMode mode, bool& ranged, DataManager::TimePoint& start,
+                    DataManager::TimePoint& end) {
+    int64_t from, to;
+    if (!parseTimeBound(args, "--from", mode, numeric_limits<int64_t>::min(), from) ||
+        !parseTimeBound(args, "--to", mode, numeric_limits<int64_t>::max(), to)) {
+        return false;
+    }
+    ranged = args.has("--from") || args.has("--to");
+    start = fromEpochNanoseconds(from);
+    end = fromEpochNanoseconds(to);
+    return true;
+}
+
+int commandConvert(const Arguments& args) {
+    string output = args.positional.size() > 1 ? args.positional[1]
+                                               : args.get("--output", DataManager::STANDARD_STREAM);
+
+    // En sensorkolumn följer bara med om filen läses till SensorStore, och
+    // den kan bara skrivas som CSV. Standard in kan inte läsas två gånger och
+    // går därför alltid den vägen. Med --sensor blir de valda sensorerna en serie.
+    const string& input = args.positional[0];
+    bool sensorInput = !args.has("--sensor") &&
+        (input == DataManager::STANDARD_STREAM ||
+         (!isSnapshotFile(input) && !isArchiveFile(input) && CsvReader::hasSensorColumn(input)));
+    if (sensorInput) {
+        SensorStore store;
+        if (!loadSensorInput(store, args)) return 1;
+        if (store.getLastLoadReport().sensorColumn) return store.saveToFile(output) ? 0 : 1;
+
+        TimeMode timeMode;
+        if (!parseTimeOption(args, timeMode)) return 2;
+        DataManager dm;
+        dm.setTimeMode(timeMode);
+        store.copySensorTo(SensorRegistry::DEFAULT_SENSOR, dm);
+        return dm.saveToFile(output) ? 0 : 1;
+    }
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+    return dm.saveToFile(output) ? 0 : 1;
+}
+
+int commandStats(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    bool ranged;
+    DataManager::TimePoint start, end;
+    if (!parseTimeRange(args, timeMode, ranged, start, end)) return 2;
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    const vector<double> qs = { 0.5, 0.95, 0.99 };
+    DataManager::Statistics stats = ranged ? dm.calculateRangeStatistics(start, end) : dm.calculateStatistics();
+    vector<double> percentiles = ranged ? dm.exactQuantiles(qs, start, end) : dm.exactQuantiles(qs);
+    bool empty = stats.count == 0;
+    double nan = numeric_limits<double>::quiet_NaN();
+
+    Table table;
+    vector<string> row;
+    auto add = [&](const string& name, double value) {
+        table.addColumn(name);
+        row.push_back(formatNumber(value, format));
+    };
+    add("count", static_cast<double>(stats.count));
+    add("sum", stats.sum);
+    add("mean", empty ? nan : stats.mean);
+    add("min", empty ? nan : stats.min);
+    add("max", empty ? nan : stats.max);
+    add("variance", empty ? nan : stats.variance);
+    add("stddev", empty ? nan : stats.standardDeviation);
+    add("median", percentiles[0]);
+    add("p95", percentiles[1]);
+    add("p99", percentiles[2]);
+    table.rows.push_back(row);
+    writeTable(table, format, true);
+    return 0;
+}
+
+int commandThreshold(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+
+    // Villkor: (namn, undre, övre); ett värde matchar om det uppfyller villkoret
+    struct Condition {
+        string name;
+        double low;
+        double high;
+        string label;
+        bool matches(double value) const {
+            if (name == "above") return value > low;
+            if (name == "below") return value <= high;
+            return value >= low && value <= high;
+        }
+    };
+    vector<Condition> conditions;
+    for (const string& text : args.all("--above")) {
+        double value;
+        if (!parseNumber(text, value)) { cerr << "Error: Invalid --above " << text << endl; return 2; }
+        conditions.push_back({ "above", value, 0, text });
+    }
+    for (const string& text : args.all("--below")) {
+        double value;
+        if (!parseNumber(text, value)) { cerr << "Error: Invalid --below " << text << endl; return 2; }
+        conditions.push_back({ "below", 0, value, text });
+    }
+    for (const string& text : args.all("--range")) {
+        double low, high;
+        size_t colon = text.find(':');
+        if (colon == string::npos || !parseNumber(text.substr(0, colon), low) ||
+            !parseNumber(text.substr(colon + 1), high)) {
+            cerr << "Error: --range expects LOW:HIGH" << endl;
+            return 2;
+        }
+        conditions.push_back({ "range", low, high, text });
+    }
+    if (conditions.empty()) {
+        cerr << "Error: threshold needs --above, --below or --range" << endl;
+        return 2;
+    }
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    bool ranged;
+    DataManager::TimePoint start, end;
+    if (!parseTimeRange(args, timeMode, ranged, start, end)) return 2;
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    if (args.has("--rows")) {
+        // Matchande rader i tidsordning, som CSV
+        CsvWriter writer;
+        writer.setTimeMode(dm.getTimeMode());
+        string output = args.get("--output", DataManager::STANDARD_STREAM);
+        if (output == DataManager::STANDARD_STREAM) {
+            writer.attach(stdout);
+        } else if (!writer.open(output)) {
+            cerr << "Error: Could not open file for writing: " << output << endl;
+            return 1;
+        }
+        writer.writeHeader();
+        MeasurementSelection rows = dm.findInTimeRange(start, end);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            for (const Condition& condition : conditions) {
+                if (condition.matches(rows.value(i))) {
+                    writer.writeRow(rows.timestampNs(i), rows.value(i));
+                    break;
+                }
+            }
+        }
+        return writer.close() ? 0 : 1;
+    }
+
+    Table table;
+    table.addColumn("condition", true);
+    table.addColumn("threshold", true);
+    table.addColumn("count");
+    table.addColumn("percent");
+    // Med tidsintervall räknas intervallets rader; annars används värdeindexet
+    MeasurementSelection rows;
+    if (ranged) rows = dm.findInTimeRange(start, end);
+    size_t total = ranged ? rows.size() : dm.getMeasurementCount();
+    for (const Condition& condition : conditions) {
+        size_t count = 0;
+        if (ranged) {
+            for (size_t i = 0; i < rows.size(); ++i) {
+                if (condition.matches(rows.value(i))) ++count;
+            }
+        } else if (condition.name == "above") count = dm.countAboveThreshold(condition.low);
+        else if (condition.name == "below") count = dm.countBelowThreshold(condition.high);
+        else count = dm.countInRange(condition.low, condition.high);
+        double percent = total > 0 ? 100.0 * count / total : 0.0;
+        table.rows.push_back({ condition.name, condition.label,
+                               formatNumber(static_cast<double>(count), format),
+                               formatNumber(percent, format) });
+    }
+    writeTable(table, format, false);
+    return 0;
+}
+
+int commandMovingAverage(const Arguments& args) {
+    map<string, WindowAggregate> aggregates = {
+        { "mean", WindowAggregate::Mean }, { "min", WindowAggregate::Min },
+        { "max", WindowAggregate::Max }, { "variance", WindowAggregate::Variance },
+        { "stddev", WindowAggregate::StandardDeviation } };
+    auto aggregate = aggregates.find(args.get("--aggregate", "mean"));
+    if (aggregate == aggregates.end()) {
+        cerr << "Error: Unknown --aggregate " << args.get("--aggregate", "") << endl;
+        return 2;
+    }
+    size_t window = 0;
+    double minutes = 0;
+    if (args.has("--window") == args.has("--minutes") ||
+        (args.has("--window") && (!parseCount(args.get("--window", ""), window) || window == 0)) ||
+        (args.has("--minutes") && (!parseNumber(args.get("--minutes", ""), minutes) || minutes <= 0))) {
+        cerr << "Error: moving-average needs either --window N or --minutes M (positive)" << endl;
+        return 2;
+    }
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    bool ranged;
+    DataManager::TimePoint start, end;
+    if (!parseTimeRange(args, timeMode, ranged, start, end)) return 2;
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    // Fönstren räknas alltid i tidsordning över intervallets rader (hela
+    // datan utan --from/--to); i tidsordnad data läses kolumnerna direkt
+    MeasurementSelection rows = dm.findInTimeRange(start, end);
+    vector<int64_t> timestamps(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        timestamps[i] = rows.timestampNs(i);
+    }
+    vector<double> out;
+    size_t outputs;
+    const int64_t* outputTimestamps = timestamps.data();
+    if (window > 0) {
+        out.resize(SlidingWindowEngine::outputCount(rows.size(), window));
+        outputs = dm.calculateMovingWindow(window, aggregate->second, start, end, out.data());
+        // Utvärde i hör till fönstret som slutar på värde i + window - 1
+        if (outputs > 0) outputTimestamps += window - 1;
+    } else {
+        chrono::nanoseconds duration(static_cast<int64_t>(minutes * 60e9));
+        out.resize(rows.size());
+        outputs = dm.calculateMovingWindow(duration, aggregate->second, start, end, out.data());
+    }
+
+    CsvWriter writer;
+    writer.setTimeMode(dm.getTimeMode());
+    string output = args.get("--output", DataManager::STANDARD_STREAM);
+    if (output == DataManager::STANDARD_STREAM) {
+        writer.attach(stdout);
+    } else if (!writer.open(output)) {
+        cerr << "Error: Could not open file for writing: " << output << endl;
+        return 1;
+    }
+    writer.writeHeader();
+    writer.writeRows(out.data(), outputTimestamps, outputs);
+    return writer.close() ? 0 : 1;
+}
+
+int commandHistogram(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+    double width = 1.0;
+    if (args.has("--width") && (!parseNumber(args.get("--width", ""), width) || width <= 0)) {
+        cerr << "Error: --width expects a positive number" << endl;
+        return 2;
+    }
+    double low = 0;
+    unsigned long bins = 0;
+    bool fixedRange = args.has("--bins");
+    if (fixedRange && (sscanf(args.get("--bins", "").c_str(), "%lf:%lf:%lu", &low, &width, &bins) != 3 ||
+                       width <= 0)) {
+        cerr << "Error: --bins expects LOW:WIDTH:BINS" << endl;
+        return 2;
+    }
+    if (fixedRange && (bins == 0 || bins > HISTOGRAM_MAX_BINS)) {
+        cerr << "Error: --bins allows 1 to " << HISTOGRAM_MAX_BINS << " bins" << endl;
+        return 2;
+    }
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    bool ranged;
+    DataManager::TimePoint start, end;
+    if (!parseTimeRange(args, timeMode, ranged, start, end)) return 2;
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+    Histogram histogram;
+    if (ranged) {
+        histogram = fixedRange ? dm.generateHistogram(low, width, bins, start, end)
+                               : dm.generateHistogram(width, start, end);
+    } else {
+        histogram = fixedRange ? dm.generateHistogram(low, width, bins) : dm.generateHistogram(width);
+    }
+
+    Table table;
+    table.addColumn("lower");
+    table.addColumn("upper");
+    table.addColumn("count");
+    double infinity = numeric_limits<double>::infinity();
+    auto addRow = [&](double lower, double upper, uint64_t count) {
+        table.rows.push_back({ formatNumber(lower, OutputFormat::Csv), formatNumber(upper, OutputFormat::Csv),
+                               formatNumber(static_cast<double>(count), format) });
+    };
+    // Värden utanför intervallet redovisas med oändliga gränser
+    if (histogram.underflowCount() > 0) addRow(-infinity, histogram.getLowerBound(), histogram.underflowCount());
+    for (size_t bin = 0; bin < histogram.binCount(); ++bin) {
+        addRow(histogram.binLower(bin), histogram.binLower(bin + 1), histogram.binValue(bin));
+    }
+    if (histogram.overflowCount() > 0) {
+        addRow(histogram.binLower(histogram.binCount()), infinity, histogram.overflowCount());
+    }
+    if (format == OutputFormat::Json) {
+        // Gränserna kan vara oändliga och skrivs därför som text i JSON
+        table.textColumns[0] = table.textColumns[1] = true;
+    }
+    writeTable(table, format, false);
+    return 0;
+}
+
+int commandRollup(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    RollupTier tier = RollupTier::Hour;
+    string tierName = args.get("--tier", "hour");
+    bool knownTier = false;
+    for (RollupTier candidate : ROLLUP_TIERS) {
+        if (tierName == rollupTierName(candidate)) {
+            tier = candidate;
+            knownTier = true;
+        }
+    }
+    if (!knownTier) {
+        cerr << "Error: Unsupported --tier " << tierName << " (expected minute, hour or day)" << endl;
+        return 2;
+    }
+    int64_t from, to;
+    if (!parseTimeBound(args, "--from", timeMode, numeric_limits<int64_t>::min(), from) ||
+        !parseTimeBound(args, "--to", timeMode, numeric_limits<int64_t>::max(), to)) {
+        return 2;
+    }
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    Table table;
+    table.addColumn("start", true);
+    table.addColumn("count");
+    table.addColumn("mean");
+    table.addColumn("min");
+    table.addColumn("max");
+    table.addColumn("stddev");
+    TimeCodec codec(timeMode);
+    for (const RollupBucket& bucket : dm.getRollups().buckets(tier)) {
+        if (bucket.startNs < from || bucket.startNs >= to) continue;
+        DataManager::Statistics stats = DataManager::toStatistics(bucket.stats);
+        table.rows.push_back({ codec.format(bucket.startNs), formatNumber(static_cast<double>(stats.count), format),
+                               formatNumber(stats.mean, format), formatNumber(stats.min, format),
+                               formatNumber(stats.max, format), formatNumber(stats.standardDeviation, format) });
+    }
+    writeTable(table, format, false);
+    return 0;
+}
+
+int commandRangeStats(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    if (!args.has("--from") || !args.has("--to")) {
+        cerr << "Error: range-stats needs --from and --to" << endl;
+        return 2;
+    }
+    int64_t from, to;
+    if (!parseTimeBound(args, "--from", timeMode, 0, from) || !parseTimeBound(args, "--to", timeMode, 0, to)) {
+        return 2;
+    }
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    DataManager::Statistics stats =
+        dm.calculateRangeStatistics(fromEpochNanoseconds(from), fromEpochNanoseconds(to));
+    bool empty = stats.count == 0;
+    double nan = numeric_limits<double>::quiet_NaN();
+
+    Table table;
+    vector<string> row;
+    auto add = [&](const string& name, double value) {
+        table.addColumn(name);
+        row.push_back(formatNumber(value, format));
+    };
+    add("count", static_cast<double>(stats.count));
+    add("sum", stats.sum);
+    add("mean", empty ? nan : stats.mean);
+    add("min", empty ? nan : stats.min);
+    add("max", empty ? nan : stats.max);
+    add("variance", empty ? nan : stats.variance);
+    add("stddev", empty ? nan : stats.standardDeviation);
+    table.rows.push_back(row);
+    writeTable(table, format, true);
+    return 0;
+}
+
+int commandDownsample(const Arguments& args) {
+    size_t points = 0;
+    if (!parseCount(args.get("--points", ""), points) || points == 0) {
+        cerr << "Error: downsample needs --points N (positive)" << endl;
+        return 2;
+    }
+    DownsampleMethod method;
+    string methodName = args.get("--method", "lttb");
+    if (!parseDownsampleMethod(methodName, method)) {
+        cerr << "Error: Unsupported --method " << methodName << " (expected minmax or lttb)" << endl;
+        return 2;
+    }
+
+    DataManager dm;
+    if (!loadInput(dm, args)) return 1;
+
+    CsvWriter writer;
+    writer.setTimeMode(dm.getTimeMode());
+    string output = args.get("--output", DataManager::STANDARD_STREAM);
+    if (output == DataManager::STANDARD_STREAM) {
+        writer.attach(stdout);
+    } else if (!writer.open(output)) {
+        cerr << "Error: Could not open file for writing: " << output << endl;
+        return 1;
+    }
+    writer.writeHeader();
+    MeasurementView view = dm.measurementsView();
+    for (size_t row : dm.downsample(points, method)) {
+        writer.writeRow(view.timestampData()[row], view.valueData()[row]);
+    }
+    return writer.close() ? 0 : 1;
+}
+
+// En rad per sensor: statistik ur sensorns aggregat och antal över varje tröskel
+int commandSensors(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, false)) return 2;
+    vector<double> thresholds;
+    for (const string& text : args.all("--threshold")) {
+        double value;
+        if (!parseNumber(text, value)) { cerr << "Error: Invalid --threshold " << text << endl; return 2; }
+        thresholds.push_back(value);
+    }
+
+    SensorStore store;
+    if (!loadSensorInput(store, args)) return 1;
+
+    // Utan --sensor grupperas alla sensorer i ett svep; annars läses bara de valda
+    vector<SensorStore::SensorSummary> summaries;
+    vector<string> sensorNames = args.all("--sensor");
+    if (sensorNames.empty()) {
+        summaries = store.summarizeBySensor(thresholds);
+    }
+    for (const string& name : sensorNames) {
+        SensorStore::SensorSummary summary;
+        if (!store.findSensor(name, summary.sensor)) {
+            cerr << "Error: Unknown sensor " << name << " in " << args.positional[0] << endl;
+            return 1;
+        }
+        summary.stats = store.calculateStatistics(summary.sensor);
+        for (double threshold : thresholds) {
+            summary.aboveCounts.push_back(store.countAboveThreshold(summary.sensor, threshold));
+        }
+        summaries.push_back(summary);
+    }
+
+    Table table;
+    table.addColumn("sensor", true);
+    table.addColumn("count");
+    table.addColumn("mean");
+    table.addColumn("min");
+    table.addColumn("max");
+    table.addColumn("stddev");
+    for (const string& text : args.all("--threshold")) {
+        table.addColumn("above_" + text);
+    }
+    double nan = numeric_limits<double>::quiet_NaN();
+    for (const SensorStore::SensorSummary& summary : summaries) {
+        const DataManager::Statistics& stats = summary.stats;
+        bool empty = stats.count == 0;
+        vector<string> row = { store.sensorName(summary.sensor),
+                               formatNumber(static_cast<double>(stats.count), format),
+                               formatNumber(empty ? nan : stats.mean, format),
+                               formatNumber(empty ? nan : stats.min, format),
+                               formatNumber(empty ? nan : stats.max, format),
+                               formatNumber(empty ? nan : stats.standardDeviation, format) };
+        for (size_t count : summary.aboveCounts) {
+            row.push_back(formatNumber(static_cast<double>(count), format));
+        }
+        table.rows.push_back(row);
+    }
+    writeTable(table, format, false);
+    return 0;
+}
+
+// Skriv en statusrad för fönstret och töm stdout så att raden syns direkt
+void writeMonitorRow(const RetentionBuffer& buffer, TimeCodec& codec) {
+    DataManager::Statistics stats = buffer.calculateStatistics();
+    string row = codec.format(buffer.timestampNs(buffer.size() - 1)) + "," + to_string(stats.count) + "," +
+                 formatNumber(stats.mean, OutputFormat::Csv) + "," + formatNumber(stats.min, OutputFormat::Csv) +
+                 "," + formatNumber(stats.max, OutputFormat::Csv) + "," +
+                 formatNumber(stats.standardDeviation, OutputFormat::Csv) + "," +
+                 to_string(buffer.evictedCount()) + "\n";
+    fputs(row.c_str(), stdout);
+    fflush(stdout);
+}
+
+// Läs rad för rad (inte i block) så att en växande fil eller ett rör följs
+// utan fördröjning; minnet är fönstret plus en radbuffert
+int commandMonitor(const Arguments& args) {
+    size_t keep = 0;
+    if (!args.has("--keep") || !parseCount(args.get("--keep", ""), keep) || keep == 0) {
+        cerr << "Error: monitor needs --keep N with N > 0" << endl;
+        return 2;
+    }
+    size_t every = 1000;
+    if (args.has("--every") && (!parseCount(args.get("--every", ""), every) || every == 0)) {
+        cerr << "Error: --every expects a positive integer" << endl;
+        return 2;
+    }
+    chrono::nanoseconds maxAge(0);
+    if (args.has("--minutes")) {
+        double minutes;
+        if (!parseNumber(args.get("--minutes", ""), minutes) || !(minutes > 0)) {
+            cerr << "Error: --minutes expects a positive number" << endl;
+            return 2;
+        }
+        maxAge = chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double, ratio<60>>(minutes));
+    }
+    TimeMode timeMode;
+    if (!parseTimeOption(args, timeMode)) return 2;
+    if (args.positional.empty()) {
+        cerr << "Error: monitor needs an INPUT file (or - for stdin)" << endl;
+        return 2;
+    }
+    const string& filename = args.positional[0];
+
+    RetentionBuffer buffer(keep, maxAge);
+    if (args.has("--archive") && !buffer.setArchive(args.get("--archive", ""))) return 1;
+
+    FILE* file = filename == DataManager::STANDARD_STREAM ? stdin : fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        cerr << "Error: Could not open file for reading: " << filename << endl;
+        return 1;
+    }
+
+    CsvReader reader;
+    reader.setTimeMode(timeMode);
+    TimeCodec codec(timeMode);
+    CsvLoadReport report;
+    fputs("timestamp,count,mean,min,max,stddev,evicted\n", stdout);
+
+    char line[4096];
+    size_t lineNumber = 0;
+    bool sensorColumn = false;
+    bool truncatedLine = false;
+    size_t sinceReport = 0;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        size_t length = strlen(line);
+        bool complete = length > 0 && line[length - 1] == '\n';
+        // Resten av en för lång rad hoppas över; själva raden räknas som fel
+        if (truncatedLine) {
+            truncatedLine = !complete;
+            continue;
+        }
+        ++lineNumber;
+        truncatedLine = !complete && !feof(file);
+        const char* begin = line;
+        const char* end = line + length;
+        while (end > begin && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) --end;
+
+        if (lineNumber == 1) {
+            sensorColumn = count(begin, end, ',') == 2;
+            continue;
+        }
+        if (begin == end) continue;
+
+        double value;
+        int64_t timestampNs;
+        const char* sensorBegin;
+        const char* sensorEnd;
+        bool parsed = !truncatedLine &&
+            (sensorColumn ? reader.parseSensorLine(begin, end, value, timestampNs, sensorBegin, sensorEnd)
+                          : reader.parseLine(begin, end, value, timestampNs));
+        if (!parsed) {
+            if (report.parseErrors == 0) {
+                report.firstErrorLine = lineNumber;
+                report.firstErrorText.assign(begin, min<size_t>(end - begin, 80));
+            }
+            ++report.parseErrors;
+            continue;
+        }
+        buffer.addMeasurement(value, timestampNs);
+        ++report.rowsLoaded;
+        if (++sinceReport == every) {
+            writeMonitorRow(buffer, codec);
+            sinceReport = 0;
+        }
+    }
+    if (file != stdin) fclose(file);
+
+    if (sinceReport > 0) writeMonitorRow(buffer, codec);
+    if (report.parseErrors > 0) {
+        cerr << "Warning: Skipped " << report.parseErrors << " unparseable line(s) in " << filename
+             << " (first at line " << report.firstErrorLine << ": " << report.firstErrorText << ")" << endl;
+    }
+    if (buffer.hasArchive() && !buffer.flushArchive()) return 1;
+    return 0;
+}
+
+// Simuleringsprofil från flaggorna; utelämnade flaggor behåller profilens standardvärden
+bool parseSimulationProfile(const Arguments& args, TimeMode timeMode, SimulationProfile& profile) {
+    struct NumberOption {
+        const char* key;
+        double* target;
+    };
+    const NumberOption options[] = {
+        { "--baseline", &profile.baseline },
+        { "--drift", &profile.driftPerDay },
+        { "--diurnal", &profile.diurnalAmplitude },
+        { "--noise", &profile.noise },
+        { "--spikes", &profile.spikeRate },
+        { "--spike-size", &profile.spikeMagnitude },
+        { "--dropouts", &profile.dropoutRate },
+        { "--dropout-length", &profile.dropoutLength },
+        { "--resolution", &profile.resolution },
+    };
+    for (const NumberOption& option : options) {
+        if (args.has(option.key) && !parseNumber(args.get(option.key, ""), *option.target)) {
+            cerr << "Error: " << option.key << " expects a number" << endl;
+            return false;
+        }
+    }
+    if (profile.spikeRate < 0 || profile.spikeRate > 1 || profile.dropoutRate < 0 || profile.dropoutRate >= 1) {
+        cerr << "Error: --spikes expects a rate in [0, 1] and --dropouts a rate in [0, 1)" << endl;
+        return false;
+    }
+
+    size_t seed;
+    if (args.has("--seed")) {
+        if (!parseCount(args.get("--seed", ""), seed)) {
+            cerr << "Error: --seed expects a non-negative integer" << endl;
+            return false;
+        }
+        profile.seed = seed;
+    }
+    double interval;
+    if (args.has("--interval")) {
+        if (!parseNumber(args.get("--interval", ""), interval) || interval * 1e9 < 1) {
+            cerr << "Error: --interval expects a positive number of seconds" << endl;
+            return false;
+        }
+        profile.intervalNs = static_cast<int64_t>(llround(interval * 1e9));
+    }
+    return parseTimeBound(args, "--start", timeMode, profile.startNs, profile.startNs);
+}
+
+int commandSimulate(const Arguments& args) {
+    size_t count;
+    if (args.positional.empty() || !parseCount(args.positional[0], count) || count == 0) {
+        cerr << "Error: simulate needs a positive COUNT" << endl;
+        return 2;
+    }
+    TimeMode timeMode;
+    unsigned threads;
+    SimulationProfile profile;
+    if (!parseTimeOption(args, timeMode) || !parseThreadOption(args, threads) ||
+        !parseSimulationProfile(args, timeMode, profile)) {
+        return 2;
+    }
+    string output = args.positional.size() > 1 ? args.positional[1]
+                                               : args.get("--output", DataManager::STANDARD_STREAM);
+
+    // En snapshot skrivs från minnet; CSV och arkiv strömmas block för block
+    const string snapshotExtension = DataManager::SNAPSHOT_EXTENSION;
+    if (output.size() > snapshotExtension.size() &&
+        output.compare(output.size() - snapshotExtension.size(), snapshotExtension.size(), snapshotExtension) == 0) {
+        DataManager dm;
+        dm.setThreadCount(threads);
+        dm.simulate(profile, count);
+        return dm.saveToFile(output) ? 0 : 1;
+    }
+    unique_ptr<ThreadPool> pool;
+    if (threads != 1) pool.reset(new ThreadPool(threads));
+    SensorSimulator simulator(profile, count);
+    return simulator.saveToFile(output, timeMode, pool && pool->size() > 1 ? pool.get() : nullptr) ? 0 : 1;
+}
+
+int commandAnalyze(const Arguments& args) {
+    OutputFormat format;
+    if (!parseFormat(args, format, true)) return 2;
+
+    StreamAnalysisOptions options;
+    if (!parseTimeOption(args, options.timeMode)) return 2;
+    for (const string& text : args.all("--threshold")) {
+        double value;
+        if (!parseNumber(text, value)) { cerr << "Error: Invalid --threshold " << text << endl; return 2; }
+        options.thresholds.push_back(value);
+    }
+    if (args.has("--window") && !parseCount(args.get("--window", ""), options.movingWindow)) {
+        cerr << "Error: --window expects a non-negative integer" << endl;
+        return 2;
+    }
+    options.movingAverageFile = args.get("--moving-average-out", "");
+    if (args.has("--histogram")) {
+        unsigned long bins;
+        if (sscanf(args.get("--histogram", "").c_str(), "%lf:%lf:%lu",
+                   &options.histogramLow, &options.histogramWidth, &bins) != 3 ||
+            options.histogramWidth <= 0) {
+            cerr << "Error: --histogram expects LOW:WIDTH:BINS" << endl;
+            return 2;
+        }
+        if (bins == 0 || bins > HISTOGRAM_MAX_BINS) {
+            cerr << "Error: --histogram allows 1 to " << HISTOGRAM_MAX_BINS << " bins" << endl;
+            return 2;
+        }
+        options.histogramBins = bins;
+    }
+    if (args.positional.empty()) {
+        cerr << "Error: analyze needs an INPUT file (or - for stdin)" << endl;
+        return 2;
+    }
+    const string& filename = args.positional[0];
+
+    StreamAnalyzer analyzer(options);
+    StreamAnalysisResult result;
+    string error;
+    bool ok = filename == DataManager::STANDARD_STREAM ? analyzer.analyzeStream(stdin, result, error)
+                                                       : analyzer.analyzeFile(filename, result, error);
+    if (!ok) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    if (result.csvReport.parseErrors > 0) {
+        cerr << "Warning: Skipped " << result.csvReport.parseErrors << " unparseable line(s) (first at line "
+             << result.csvReport.firstErrorLine << ": " << result.csvReport.firstErrorText << ")" << endl;
+    }
+    if (result.skippedBytes > 0) {
+        cerr << "Warning: Skipped " << result.skippedBytes << " byte(s) of incomplete or corrupt data at the end of "
+             << filename << endl;
+    }
+
+    DataManager::Statistics stats = DataManager::toStatistics(result.stats);
+    const Histogram& histogram = result.histogram;
+
+    if (format == OutputFormat::Json) {
+        string out = "{\"file\": " + jsonString(filename) +
+            ", \"count\": " + to_string(stats.count) +
+            ", \"mean\": " + formatNumber(stats.mean, format) +
+            ", \"min\": " + formatNumber(stats.min, format) +
+            ", \"max\": " + formatNumber(stats.max, format) +
+            ", \"stddev\": " + formatNumber(stats.standardDeviation, format) + ",\n \"percentiles\": {";
+        for (size_t i = 0; i < options.quantiles.size(); ++i) {
+            out += (i > 0 ? ", " : "") + jsonString(formatNumber(options.quantiles[i], format)) + ": " +
+                   formatNumber(result.quantileValues[i], format);
+        }
+        out += "},\n \"above\": {";
+        for (size_t i = 0; i < options.thresholds.size(); ++i) {
+            out += (i > 0 ? ", " : "") + jsonString(formatNumber(options.thresholds[i], format)) + ": " +
+                   to_string(result.aboveCounts[i]);
+        }
+        out += "},\n \"moving_average\": {\"window\": " + to_string(options.movingWindow) +
+               ", \"count\": " + to_string(result.movingAverageCount) +
+               ", \"last\": " + formatNumber(result.lastMovingAverage, format) + "},\n" +
+               " \"histogram\": {\"lower\": " + formatNumber(histogram.getLowerBound(), format) +
+               ", \"width\": " + formatNumber(histogram.getBinWidth(), format) +
+               ", \"underflow\": " + to_string(histogram.underflowCount()) +
+               ", \"overflow\": " + to_string(histogram.overflowCount()) + ", \"counts\": [";
+        for (size_t bin = 0; bin < histogram.binCount(); ++bin) {
+            out += (bin > 0 ? "," : "") + to_string(histogram.binValue(bin));
+        }
+        out += "]}}\n";
+        fputs(out.c_str(), stdout);
+        return 0;
+    }
+
+    cout << "=== STREAMING ANALYSIS: " << filename << " ===" << endl;
+    cout << "Count: " << stats.count << endl;
+    if (stats.count == 0) return 0;
+
+    TimeCodec codec(options.timeMode);
+    cout << "Time span: " << codec.format(result.firstTimestampNs) << " - "
+         << codec.format(result.lastTimestampNs) << endl;
+    cout << fixed;
+    cout.precision(2);
+    cout << "Mean: " << stats.mean << endl;
+    cout << "Minimum: " << stats.min << " (Measurement #" << (stats.minIndex + 1) << ")" << endl;
+    cout << "Maximum: " << stats.max << " (Measurement #" << (stats.maxIndex + 1) << ")" << endl;
+    cout.precision(4);
+    cout << "Standard Deviation: " << stats.standardDeviation << endl;
+    cout.precision(2);
+    for (size_t i = 0; i < options.quantiles.size(); ++i) {
+        cout << "Percentile " << options.quantiles[i] * 100 << " (estimated): "
+             << result.quantileValues[i] << endl;
+    }
+    for (size_t i = 0; i < options.thresholds.size(); ++i) {
+        cout << "Above " << options.thresholds[i] << ": " << result.aboveCounts[i] << " ("
+             << 100.0 * result.aboveCounts[i] / stats.count << "%)" << endl;
+    }
+    if (options.movingWindow > 0) {
+        cout << "Moving average (window " << options.movingWindow << "): "
+             << result.movingAverageCount << " values, last " << result.lastMovingAverage << endl;
+    }
+    cout << "Histogram:" << endl;
+    if (histogram.underflowCount() > 0) {
+        cout << "  < " << histogram.getLowerBound() << ": " << histogram.underflowCount() << endl;
+    }
+    for (size_t bin = 0; bin < histogram.binCount(); ++bin) {
+        if (histogram.binValue(bin) == 0) continue;
+        cout << "  [" << histogram.binLower(bin) << ", " << histogram.binLower(bin + 1) << "): "
+             << histogram.binValue(bin) << endl;
+    }
+    if (histogram.overflowCount() > 0) {
+        cout << "  >= " << histogram.binLower(histogram.binCount()) << ": " << histogram.overflowCount() << endl;
+    }
+    return 0;
+}
+
+} // namespace
+
+bool isCommandLineInvocation(int argc, char* argv[]) {
+    (void)argv;
+    return argc > 1;
+}
+
+int runCommandLine(int argc, char* argv[]) {
+    Arguments args;
+    string error;
+    if (!parseArguments(argc, argv, args, error)) {
+        cerr << "Error: " << error << endl;
+        return 2;
+    }
+    if (args.command == "help" || args.command == "--help" || args.has("--help")) {
+        printUsage();
+        return 0;
+    }
+
+    typedef int (*Command)(const Arguments&);
+    static const map<string, Command> commands = {
+        { "convert", commandConvert },
+        { "load", commandConvert },
+        { "stats", commandStats },
+        { "threshold", commandThreshold },
+        { "moving-average", commandMovingAverage },
+        { "histogram", commandHistogram },
+        { "sensors", commandSensors },
+        { "rollup", commandRollup },
+        { "range-stats", commandRangeStats },
+        { "downsample", commandDownsample },
+        { "monitor", commandMonitor },
+        { "simulate", commandSimulate },
+        { "analyze", commandAnalyze },
+    };
+    auto command = commands.find(args.command);
+    if (command == commands.end()) {
+        cerr << "Error: Unknown command " << args.command << endl;
+        printUsage();
+        return 2;
+    }
+    int status = command->second(args);
+
+    // Mätvärdena skrivs även när kommandot misslyckades
+    if (args.has("--metrics")) {
+        string target = args.get("--metrics", "");
+        if (target == "-") {
+            cerr << formatMetricsPrometheus(snapshotMetrics());
+        } else if (!exportMetrics(target) && status == 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
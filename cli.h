@@ -0,0 +1,19 @@
+#ifndef CLI_H
+#define CLI_H
+
+// Icke-interaktivt kommandoradsläge för skript, cron-jobb och pipelines:
+//
+//   iot_analyzer <kommando> [argument] [flaggor]
+//
+// Kommandona anropar samma DataManager-funktioner som menyn men utan
+// menyutskrifter och utan automatisk sparning vid avslut. Sammanfattningar
+// skrivs som CSV (standard) eller JSON (--format json), tidsserier som CSV.
+// Filnamnet "-" betyder stdin respektive stdout. Diagnostik går till stderr.
+
+// Sant om argumenten ska hanteras av kommandoradsläget i stället för menyn
+bool isCommandLineInvocation(int argc, char* argv[]);
+
+// Kör ett kommando; returnerar slutkoden (0 ok, 1 körfel, 2 felaktiga argument)
+int runCommandLine(int argc, char* argv[]);
+
+#endif // CLI_H
@@ -0,0 +1,298 @@
+#include "compressed_block.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// Bitström med mest signifikanta biten först
+class BitWriter {
+private:
+    unsigned char* out;
+    size_t position;
+    uint64_t buffer;
+    unsigned filled;
+
+public:
+    explicit BitWriter(unsigned char* out) : out(out), position(0), buffer(0), filled(0) {}
+
+    // Skriv de lägsta bits bitarna av value, 1 <= bits <= 64
+    void write(uint64_t value, unsigned bits) {
+        if (bits < 64) value &= (uint64_t(1) << bits) - 1;
+        unsigned space = 64 - filled;
+        if (bits < space) {
+            buffer |= value << (space - bits);
+            filled += bits;
+            return;
+        }
+        // Fyll bufferten, töm den och lägg resten först i en ny
+        unsigned rest = bits - space;
+        buffer |= rest < 64 ? value >> rest : 0;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out[position++] = static_cast<unsigned char>(buffer >> shift);
+        }
+        buffer = rest > 0 ? value << (64 - rest) : 0;
+        filled = rest;
+    }
+
+    // Töm de sista bitarna och returnera antalet skrivna byte
+    size_t finish() {
+        for (int shift = 56; filled > 0; shift -= 8) {
+            out[position++] = static_cast<unsigned char>(buffer >> shift);
+            filled = filled > 8 ? filled - 8 : 0;
+        }
+        buffer = 0;
+        return position;
+    }
+};
+
+class BitReader {
+private:
+    const unsigned char* next;
+    const unsigned char* end;
+    uint64_t buffer;     // Olästa bitar, vänsterjusterade
+    unsigned available;
+    bool overrun;
+
+    void refill() {
+        // Snabbväg: läs åtta byte på en gång och behåll de som får plats
+        if (end - next >= 8) {
+            uint64_t word;
+            memcpy(&word, next, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            word = __builtin_bswap64(word);
+#elif !defined(__GNUC__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+            word = 0;
+            for (int i = 0; i < 8; ++i) word = (word << 8) | next[i];
+#endif
+            unsigned bytes = (64 - available) / 8;
+            buffer |= word >> available;
+            buffer &= available + bytes * 8 < 64 ? ~(~uint64_t(0) >> (available + bytes * 8)) : ~uint64_t(0);
+            next += bytes;
+            available += bytes * 8;
+            return;
+        }
+        // Fyll på hela byte så länge det får plats
+        while (available <= 56 && next < end) {
+            buffer |= static_cast<uint64_t>(*next++) << (56 - available);
+            available += 8;
+        }
+    }
+
+public:
+    BitReader(const unsigned char* data, size_t size)
+        : next(data), end(data + size), buffer(0), available(0), overrun(false) {}
+
+    // Läs bits bitar, 1 <= bits <= 64
+    uint64_t read(unsigned bits) {
+        if (bits > 56) {
+            uint64_t high = read(bits - 32);
+            return (high << 32) | read(32);
+        }
+        if (bits > available) {
+            refill();
+            if (bits > available) {
+                overrun = true;
+                available = 0;
+                buffer = 0;
+                return 0;
+            }
+        }
+        uint64_t value = buffer >> (64 - bits);
+        buffer <<= bits;
+        available -= bits;
+        return value;
+    }
+
+    bool readBit() {
+        if (available == 0) {
+            refill();
+            if (available == 0) {
+                overrun = true;
+                return false;
+            }
+        }
+        bool bit = (buffer >> 63) != 0;
+        buffer <<= 1;
+        --available;
+        return bit;
+    }
+
+    bool failed() const { return overrun; }
+    // Sant om bara utfyllnadsbitar i sista byten återstår
+    bool atEnd() const { return next == end && available < 8; }
+};
+
+uint64_t bitsOf(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+unsigned leadingZeros(uint64_t x) {
+    if (x == 0) return 64;
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    for (; (x >> 63) == 0; x <<= 1) ++n;
+    return n;
+#endif
+}
+
+unsigned trailingZeros(uint64_t x) {
+    if (x == 0) return 64;
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    for (; (x & 1) == 0; x >>= 1) ++n;
+    return n;
+#endif
+}
+
+// Prefixkoder för delta-of-delta (zigzag-kodad): 0, 10, 110, 1110, 11110, 11111
+const unsigned DOD_FIELD_BITS[] = { 7, 14, 24, 40 };
+
+// Största antalet bitar per rad efter den första: tidsstämpel 5 + 64, värde 2 + 5 + 6 + 64
+const size_t MAX_ROW_BITS = 69 + 77;
+
+} // namespace
+
+size_t maxCompressedBytes(size_t count) {
+    return count == 0 ? 0 : 16 + ((count - 1) * MAX_ROW_BITS + 7) / 8;
+}
+
+size_t encodeCompressedBlock(const double* values, const int64_t* timestamps, size_t count,
+                             CompressedBlockHeader& header, unsigned char* out) {
+    memset(&header, 0, sizeof(header));
+    RunningStats stats = summarizeValues(values, count);
+    header.count = static_cast<uint32_t>(count);
+    header.sum = stats.sum;
+    header.mean = stats.mean;
+    header.m2 = stats.m2;
+    header.min = stats.min;
+    header.max = stats.max;
+    header.minIndex = static_cast<uint32_t>(stats.minIndex);
+    header.maxIndex = static_cast<uint32_t>(stats.maxIndex);
+    header.minTimestamp = *min_element(timestamps, timestamps + count);
+    header.maxTimestamp = *max_element(timestamps, timestamps + count);
+    for (size_t i = 0; i < count; ++i) {
+        header.nanCount += values[i] != values[i];
+    }
+
+    BitWriter writer(out);
+    writer.write(static_cast<uint64_t>(timestamps[0]), 64);
+    writer.write(bitsOf(values[0]), 64);
+
+    uint64_t previousTs = static_cast<uint64_t>(timestamps[0]);
+    uint64_t previousDelta = 0;
+    uint64_t previousBits = bitsOf(values[0]);
+    unsigned windowLeading = 65;      // Inget fönster ännu
+    unsigned windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        // Tidsstämpel: skillnaderna räknas med omslag så att allt är reversibelt
+        uint64_t ts = static_cast<uint64_t>(timestamps[i]);
+        uint64_t delta = ts - previousTs;
+        uint64_t dod = delta - previousDelta;
+        uint64_t zigzag = (dod << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(dod) >> 63);
+        if (zigzag == 0) {
+            writer.write(0, 1);
+        } else {
+            unsigned level = 0;
+            while (level < 4 && zigzag >= (uint64_t(1) << DOD_FIELD_BITS[level])) ++level;
+            // level + 1 ettor följda av en nolla, utom för den sista nivån
+            writer.write(level < 4 ? (uint64_t(1) << (level + 2)) - 2 : 0x1f, level < 4 ? level + 2 : 5);
+            writer.write(zigzag, level < 4 ? DOD_FIELD_BITS[level] : 64);
+        }
+        previousTs = ts;
+        previousDelta = delta;
+
+        // Värde: XOR mot föregående
+        uint64_t bits = bitsOf(values[i]);
+        uint64_t x = bits ^ previousBits;
+        previousBits = bits;
+        if (x == 0) {
+            writer.write(0, 1);
+            continue;
+        }
+        unsigned leading = min(leadingZeros(x), 31u);
+        unsigned trailing = trailingZeros(x);
+        if (windowLeading <= 64 && leading >= windowLeading && trailing >= windowTrailing) {
+            // Ryms i föregående fönster: 10 + de signifikanta bitarna
+            unsigned length = 64 - windowLeading - windowTrailing;
+            writer.write(2, 2);
+            writer.write(x >> windowTrailing, length);
+        } else {
+            // 11 + 5 bitar ledande nollor + 6 bitar längd (64 skrivs som 0) + bitarna
+            unsigned length = 64 - leading - trailing;
+            writer.write(3, 2);
+            writer.write(leading, 5);
+            writer.write(length & 63, 6);
+            writer.write(x >> trailing, length);
+            windowLeading = leading;
+            windowTrailing = trailing;
+        }
+    }
+    header.byteCount = static_cast<uint32_t>(writer.finish());
+    return header.byteCount;
+}
+
+bool decodeCompressedBlock(const CompressedBlockHeader& header, const unsigned char* data,
+                           double* values, int64_t* timestamps) {
+    size_t count = header.count;
+    if (count == 0) return header.byteCount == 0;
+    BitReader reader(data, header.byteCount);
+    uint64_t ts = reader.read(64);
+    uint64_t bits = reader.read(64);
+    timestamps[0] = static_cast<int64_t>(ts);
+    values[0] = fromBits(bits);
+
+    uint64_t delta = 0;
+    unsigned windowLeading = 0;
+    unsigned windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        if (reader.readBit()) {
+            unsigned level = 0;
+            while (level < 4 && reader.readBit()) ++level;
+            uint64_t zigzag = reader.read(level < 4 ? DOD_FIELD_BITS[level] : 64);
+            delta += (zigzag >> 1) ^ (0 - (zigzag & 1));
+        }
+        ts += delta;
+        timestamps[i] = static_cast<int64_t>(ts);
+
+        if (reader.readBit()) {
+            if (reader.readBit()) {
+                windowLeading = static_cast<unsigned>(reader.read(5));
+                unsigned length = static_cast<unsigned>(reader.read(6));
+                if (length == 0) length = 64;
+                if (windowLeading + length > 64) return false;
+                windowTrailing = 64 - windowLeading - length;
+            }
+            unsigned length = 64 - windowLeading - windowTrailing;
+            bits ^= reader.read(length) << windowTrailing;
+        }
+        values[i] = fromBits(bits);
+    }
+    return !reader.failed() && reader.atEnd();
+}
+
+RunningStats blockStats(const CompressedBlockHeader& header) {
+    RunningStats stats;
+    stats.count = header.count;
+    stats.sum = header.sum;
+    stats.mean = header.mean;
+    stats.m2 = header.m2;
+    stats.min = header.min;
+    stats.max = header.max;
+    stats.minIndex = header.minIndex;
+    stats.maxIndex = header.maxIndex;
+    return stats;
+}
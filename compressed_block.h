@@ -0,0 +1,57 @@
+#ifndef COMPRESSED_BLOCK_H
+#define COMPRESSED_BLOCK_H
+
+#include "stats_kernel.h"
+#include <cstddef>
+#include <cstdint>
+
+// Komprimerade block av mätvärden (Gorilla-kodning).
+//
+// Tidsstämplarna lagras som skillnaden mellan två på varandra följande
+// tidsskillnader (delta-of-delta). Med jämnt samplade värden är den noll
+// och kostar en bit; små avvikelser får korta fält med prefixkod.
+// Värdena lagras som bitarna XOR föregående värde: oförändrat värde kostar
+// en bit, och för ändrade värden skrivs bara de signifikanta bitarna, i
+// samma fönster som föregående värde om de ryms där.
+//
+// Varje block har en header med blockets aggregat (antal, summa, M2,
+// min/max och tidsintervall), så att skanningar kan hoppa över block helt
+// eller svara ur headern utan att avkoda något.
+
+// Standardstorlek för block; mindre block ger finare överhoppning, större
+// block bättre komprimering
+const size_t COMPRESSED_BLOCK_ROWS = 4096;
+
+// Skrivs rått till disk (se archive.h), fast storlek och utan utfyllnad
+struct CompressedBlockHeader {
+    std::uint32_t count;
+    std::uint32_t byteCount;       // Nyttolastens storlek
+    std::int64_t minTimestamp;     // Nanosekunder sedan epoch
+    std::int64_t maxTimestamp;
+    double sum;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    std::uint32_t minIndex;        // Position inom blocket
+    std::uint32_t maxIndex;
+    std::uint32_t nanCount;        // Med NaN kan inte min/max ensamma avgöra trösklar
+    std::uint32_t reserved;
+};
+
+// Största möjliga nyttolast för count rader
+size_t maxCompressedBytes(size_t count);
+
+// Koda count > 0 rader. out måste rymma maxCompressedBytes(count) byte;
+// headern fylls i och nyttolastens storlek returneras.
+size_t encodeCompressedBlock(const double* values, const std::int64_t* timestamps, size_t count,
+                             CompressedBlockHeader& header, unsigned char* out);
+
+// Avkoda ett block till header.count rader; false om nyttolasten är skadad
+bool decodeCompressedBlock(const CompressedBlockHeader& header, const unsigned char* data,
+                           double* values, std::int64_t* timestamps);
+
+// Blockets aggregat som RunningStats (index inom blocket)
+RunningStats blockStats(const CompressedBlockHeader& header);
+
+#endif // COMPRESSED_BLOCK_H
@@ -0,0 +1,228 @@
+#include "compressed_series.h"
+#include "archive.h"
+#include "metrics.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+CompressedSeries::CompressedSeries(size_t blockRows)
+    : blockRows(max<size_t>(min(blockRows, size_t(1) << 20), 1)), rowCount(0) {
+}
+
+// Privat hjälpmetod: Koda det öppna blocket direkt in i payload
+void CompressedSeries::sealTail() {
+    if (tailValues.empty()) return;
+    Block block;
+    block.offset = payload.size();
+    block.firstRow = rowCount - tailValues.size();
+    payload.resize(block.offset + maxCompressedBytes(tailValues.size()));
+    size_t bytes = encodeCompressedBlock(tailValues.data(), tailTimestamps.data(), tailValues.size(),
+                                         block.header, payload.data() + block.offset);
+    payload.resize(block.offset + bytes);
+    blocks.push_back(block);
+    tailValues.clear();
+    tailTimestamps.clear();
+}
+
+void CompressedSeries::addMeasurement(double value, int64_t timestampNs) {
+    tailValues.push_back(value);
+    tailTimestamps.push_back(timestampNs);
+    ++rowCount;
+    if (tailValues.size() == blockRows) sealTail();
+}
+
+void CompressedSeries::appendBatch(const double* values, const int64_t* timestamps, size_t count) {
+    while (count > 0) {
+        size_t rows = min(count, blockRows - tailValues.size());
+        tailValues.insert(tailValues.end(), values, values + rows);
+        tailTimestamps.insert(tailTimestamps.end(), timestamps, timestamps + rows);
+        rowCount += rows;
+        if (tailValues.size() == blockRows) sealTail();
+        values += rows;
+        timestamps += rows;
+        count -= rows;
+    }
+}
+
+void CompressedSeries::seal() {
+    sealTail();
+}
+
+void CompressedSeries::shrinkToFit() {
+    blocks.shrink_to_fit();
+    payload.shrink_to_fit();
+    tailValues.shrink_to_fit();
+    tailTimestamps.shrink_to_fit();
+}
+
+void CompressedSeries::clear() {
+    blocks.clear();
+    payload.clear();
+    tailValues.clear();
+    tailTimestamps.clear();
+    rowCount = 0;
+}
+
+size_t CompressedSeries::memoryUsage() const {
+    return blocks.capacity() * sizeof(Block) + payload.capacity() +
+           tailValues.capacity() * sizeof(double) + tailTimestamps.capacity() * sizeof(int64_t);
+}
+
+bool CompressedSeries::decodeBlock(size_t block, double* values, int64_t* timestamps) const {
+    const Block& b = blocks[block];
+    return decodeCompressedBlock(b.header, payload.data() + b.offset, values, timestamps);
+}
+
+void CompressedSeries::forEachBatch(const BatchSink& sink) const {
+    vector<double> values;
+    vector<int64_t> timestamps;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        values.resize(blocks[b].header.count);
+        timestamps.resize(blocks[b].header.count);
+        if (decodeBlock(b, values.data(), timestamps.data())) {
+            sink(values.data(), timestamps.data(), values.size());
+        }
+    }
+    if (!tailValues.empty()) sink(tailValues.data(), tailTimestamps.data(), tailValues.size());
+}
+
+RunningStats CompressedSeries::summary() const {
+    RunningStats stats;
+    for (const Block& block : blocks) {
+        stats.merge(blockStats(block.header), block.firstRow);
+    }
+    size_t tailStart = rowCount - tailValues.size();
+    for (size_t i = 0; i < tailValues.size(); ++i) stats.addAt(tailValues[i], tailStart + i);
+    return stats;
+}
+
+RunningStats CompressedSeries::summarizeTimeRange(int64_t fromNs, int64_t toNs) const {
+    IOT_TIME_OPERATION(RangeQuery);
+    RunningStats stats;
+    vector<double> values;
+    vector<int64_t> timestamps;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const CompressedBlockHeader& header = blocks[b].header;
+        if (header.maxTimestamp < fromNs || header.minTimestamp >= toNs) continue;
+        if (header.minTimestamp >= fromNs && header.maxTimestamp < toNs) {
+            stats.merge(blockStats(header), blocks[b].firstRow);
+            continue;
+        }
+        // Blocket skär en gräns; bara det avkodas
+        values.resize(header.count);
+        timestamps.resize(header.count);
+        if (!decodeBlock(b, values.data(), timestamps.data())) continue;
+        for (size_t i = 0; i < header.count; ++i) {
+            if (timestamps[i] >= fromNs && timestamps[i] < toNs) stats.addAt(values[i], blocks[b].firstRow + i);
+        }
+    }
+    size_t tailStart = rowCount - tailValues.size();
+    for (size_t i = 0; i < tailValues.size(); ++i) {
+        if (tailTimestamps[i] >= fromNs && tailTimestamps[i] < toNs) stats.addAt(tailValues[i], tailStart + i);
+    }
+    return stats;
+}
+
+size_t CompressedSeries::countAboveThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    size_t total = 0;
+    vector<double> values;
+    vector<int64_t> timestamps;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const CompressedBlockHeader& header = blocks[b].header;
+        if (header.nanCount == 0) {
+            if (header.max <= threshold) continue;
+            if (header.min > threshold) {
+                total += header.count;
+                continue;
+            }
+        }
+        values.resize(header.count);
+        timestamps.resize(header.count);
+        if (!decodeBlock(b, values.data(), timestamps.data())) continue;
+        total += count_if(values.begin(), values.end(), [threshold](double v) { return v > threshold; });
+    }
+    total += count_if(tailValues.begin(), tailValues.end(), [threshold](double v) { return v > threshold; });
+    return total;
+}
+
+size_t CompressedSeries::countBelowThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    size_t total = 0;
+    vector<double> values;
+    vector<int64_t> timestamps;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const CompressedBlockHeader& header = blocks[b].header;
+        if (header.nanCount == 0) {
+            if (header.min > threshold) continue;
+            if (header.max <= threshold) {
+                total += header.count;
+                continue;
+            }
+        }
+        values.resize(header.count);
+        timestamps.resize(header.count);
+        if (!decodeBlock(b, values.data(), timestamps.data())) continue;
+        total += count_if(values.begin(), values.end(), [threshold](double v) { return v <= threshold; });
+    }
+    total += count_if(tailValues.begin(), tailValues.end(), [threshold](double v) { return v <= threshold; });
+    return total;
+}
+
+bool CompressedSeries::saveToFile(const string& filename) const {
+    IOT_TIME_OPERATION(SaveArchive);
+    ArchiveWriter writer;
+    string error;
+    if (!writer.create(filename, error)) {
+        cerr << "Error: Could not write archive " << filename << ": " << error << endl;
+        return false;
+    }
+    for (const Block& block : blocks) {
+        writer.writeEncodedBlock(block.header, payload.data() + block.offset);
+    }
+    writer.writeBlock(tailValues.data(), tailTimestamps.data(), tailValues.size());
+    if (!writer.close()) {
+        cerr << "Error: Could not write archive " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// Blocken kopieras som de är; varje block avkodas en gång för att
+// kontrollera att det är helt
+bool CompressedSeries::loadFromFile(const string& filename) {
+    IOT_TIME_OPERATION(LoadArchive);
+    clear();
+    vector<double> values;
+    vector<int64_t> timestamps;
+    size_t corruptBlocks = 0;
+    string error;
+    uint64_t skippedBytes = 0;
+    bool opened = readArchiveBlocks(filename,
+        [&](const CompressedBlockHeader& header, const unsigned char* data) {
+            values.resize(header.count);
+            timestamps.resize(header.count);
+            if (!decodeCompressedBlock(header, data, values.data(), timestamps.data())) {
+                ++corruptBlocks;
+                return;
+            }
+            Block block;
+            block.header = header;
+            block.offset = payload.size();
+            block.firstRow = rowCount;
+            payload.insert(payload.end(), data, data + header.byteCount);
+            blocks.push_back(block);
+            rowCount += header.count;
+        },
+        error, skippedBytes);
+    if (!opened) {
+        cerr << "Error: Could not load archive " << filename << ": " << error << endl;
+        return false;
+    }
+    if (skippedBytes > 0 || corruptBlocks > 0) {
+        cerr << "Warning: Skipped " << corruptBlocks << " corrupt block(s) and " << skippedBytes
+             << " byte(s) of incomplete data in " << filename << endl;
+    }
+    return rowCount > 0;
+}
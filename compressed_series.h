@@ -0,0 +1,80 @@
+#ifndef COMPRESSED_SERIES_H
+#define COMPRESSED_SERIES_H
+
+#include "compressed_block.h"
+#include "stats_kernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Komprimerad tidsserie i minnet, t.ex. för kall data som sällan läses.
+//
+// Raderna samlas okomprimerade i ett öppet block tills det har
+// blockRows rader och kodas då till ett block (se compressed_block.h)
+// som läggs sist i en gemensam bytebuffert. Med jämna tidsstämplar och
+// långsamt föränderliga värden blir en rad några byte i stället för 16.
+//
+// Frågorna läser blockens headers först: block utanför ett tidsintervall
+// hoppas över, block helt innanför det eller helt på ena sidan om en
+// tröskel besvaras ur headern, och bara de återstående blocken avkodas.
+// Samma block sparas och läses som arkivfil (archive.h) utan omkodning.
+class CompressedSeries {
+public:
+    typedef std::function<void(const double* values, const std::int64_t* timestamps,
+                               size_t count)> BatchSink;
+
+private:
+    struct Block {
+        CompressedBlockHeader header;
+        size_t offset;      // Nyttolastens början i payload
+        size_t firstRow;    // Radnummer för blockets första rad
+    };
+
+    std::vector<Block> blocks;
+    std::vector<unsigned char> payload;
+    std::vector<double> tailValues;            // Det öppna blocket
+    std::vector<std::int64_t> tailTimestamps;
+    size_t blockRows;
+    size_t rowCount;
+
+    void sealTail();
+
+public:
+    explicit CompressedSeries(size_t blockRows = COMPRESSED_BLOCK_ROWS);
+
+    void addMeasurement(double value, std::int64_t timestampNs);
+    void appendBatch(const double* values, const std::int64_t* timestamps, size_t count);
+    // Koda även det öppna blocket, t.ex. när serien inte längre växer
+    void seal();
+    // Lämna tillbaka buffertarnas överskottskapacitet
+    void shrinkToFit();
+    void clear();
+
+    size_t size() const { return rowCount; }
+    bool empty() const { return rowCount == 0; }
+    // Kodade block; det öppna blocket räknas inte
+    size_t blockCount() const { return blocks.size(); }
+    const CompressedBlockHeader& blockHeader(size_t block) const { return blocks[block].header; }
+    // Allokerat minne i byte, inklusive det öppna blocket och överskottskapacitet
+    size_t memoryUsage() const;
+
+    // Avkoda ett block till buffertar som rymmer blockHeader(block).count rader
+    bool decodeBlock(size_t block, double* values, std::int64_t* timestamps) const;
+    // Alla rader i ordning, ett block per anrop
+    void forEachBatch(const BatchSink& sink) const;
+
+    // Aggregat för alla rader ur blockens headers; index är radnummer
+    RunningStats summary() const;
+    // Rader med from <= tidsstämpel < to (nanosekunder sedan epoch)
+    RunningStats summarizeTimeRange(std::int64_t fromNs, std::int64_t toNs) const;
+    size_t countAboveThreshold(double threshold) const;   // värde >  threshold
+    size_t countBelowThreshold(double threshold) const;   // värde <= threshold
+
+    // Arkivformatet (archive.h). Sparade block skrivs som de är.
+    bool saveToFile(const std::string& filename) const;
+    bool loadFromFile(const std::string& filename);
+};
+
+#endif // COMPRESSED_SERIES_H
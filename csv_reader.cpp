@@ -0,0 +1,362 @@
+#include "csv_reader.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void trim(const char*& begin, const char*& end) {
+    while (begin < end && isBlank(*begin)) ++begin;
+    while (end > begin && isBlank(end[-1])) --end;
+}
+
+bool parseValue(const char* begin, const char* end, double& value) {
+    trim(begin, end);
+    if (begin < end && *begin == '+') ++begin;
+    from_chars_result parsed = from_chars(begin, end, value);
+    return parsed.ec == errc() && parsed.ptr == end;
+}
+
+void recordError(CsvLoadReport& report, size_t lineNumber, const char* begin, const char* end) {
+    if (report.parseErrors == 0) {
+        report.firstErrorLine = lineNumber;
+        report.firstErrorText.assign(begin, min<size_t>(end - begin, 80));
+    }
+    ++report.parseErrors;
+    IOT_COUNT(ParseErrors, 1);
+}
+
+// Minsta intervall per tråd; mindre filer läses i ett svep
+const uint64_t MIN_RANGE_BYTES = 4 << 20;
+
+} // namespace
+
+CsvReader::CsvReader(size_t blockSize, size_t batchSize)
+    : blockSize(blockSize), batchSize(batchSize) {
+    batchValues.reserve(batchSize);
+    batchTimestamps.reserve(batchSize);
+    batchSensors.reserve(batchSize);
+}
+
+bool CsvReader::parseLine(const char* begin, const char* end, double& value, int64_t& timestampNs) {
+    const char* comma = static_cast<const char*>(memchr(begin, ',', end - begin));
+    if (comma == nullptr) return false;
+    if (!parseValue(comma + 1, end, value)) return false;
+
+    // Trimma blanktecken runt tidsstämpeln
+    const char* tsBegin = begin;
+    const char* tsEnd = comma;
+    trim(tsBegin, tsEnd);
+    return timeCodec.parse(tsBegin, tsEnd, timestampNs);
+}
+
+bool CsvReader::parseSensorLine(const char* begin, const char* end, double& value, int64_t& timestampNs,
+                                const char*& sensorBegin, const char*& sensorEnd) {
+    const char* first = static_cast<const char*>(memchr(begin, ',', end - begin));
+    if (first == nullptr) return false;
+    const char* second = static_cast<const char*>(memchr(first + 1, ',', end - first - 1));
+    if (second == nullptr) return false;
+    if (!parseValue(second + 1, end, value)) return false;
+
+    sensorBegin = first + 1;
+    sensorEnd = second;
+    trim(sensorBegin, sensorEnd);
+    if (sensorBegin == sensorEnd) return false;
+
+    const char* tsBegin = begin;
+    const char* tsEnd = first;
+    trim(tsBegin, tsEnd);
+    return timeCodec.parse(tsBegin, tsEnd, timestampNs);
+}
+
+void CsvReader::flushBatch(const BatchSink* sink, const SensorBatchSink* sensorSink) {
+    if (batchValues.empty()) return;
+    IOT_COUNT(RowsParsed, batchValues.size());
+    if (sensorSink != nullptr) {
+        (*sensorSink)(batchSensors.data(), batchValues.data(), batchTimestamps.data(), batchValues.size());
+    } else {
+        (*sink)(batchValues.data(), batchTimestamps.data(), batchValues.size());
+    }
+    batchValues.clear();
+    batchTimestamps.clear();
+    batchSensors.clear();
+}
+
+bool CsvReader::readFile(const string& filename, const BatchSink& sink, CsvLoadReport& report) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    readStream(file, sink, report);
+    fclose(file);
+    return true;
+}
+
+bool CsvReader::readFile(const string& filename, SensorRegistry& sensors, const SensorBatchSink& sink,
+                         CsvLoadReport& report) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    readStream(file, sensors, sink, report);
+    fclose(file);
+    return true;
+}
+
+void CsvReader::readStream(FILE* file, const BatchSink& sink, CsvLoadReport& report) {
+    readRows(file, &sink, nullptr, nullptr, report);
+}
+
+void CsvReader::readStream(FILE* file, SensorRegistry& sensors, const SensorBatchSink& sink,
+                           CsvLoadReport& report) {
+    readRows(file, nullptr, &sensors, &sink, report);
+}
+
+// Gemensam inläsning; med sensors != nullptr översätts sensorkolumnen till
+// id och batcharna går till sensorSink, annars till sink
+void CsvReader::readRows(FILE* file, const BatchSink* sink, SensorRegistry* sensors,
+                         const SensorBatchSink* sensorSink, CsvLoadReport& report) {
+    IOT_TIME_OPERATION(ReadCsv);
+    buffer.resize(blockSize);
+    size_t filled = 0;
+    size_t lineNumber = 0;
+    bool atEof = false;
+    bool sensorColumn = false;
+    // Rader från samma sensor kommer ofta i följd; då behövs ingen uppslagning
+    string lastSensor;
+    uint32_t lastSensorId = SensorRegistry::DEFAULT_SENSOR;
+
+    while (!atEof) {
+        size_t bytesRead = fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+        if (bytesRead == 0) atEof = true;
+        filled += bytesRead;
+        IOT_COUNT(BytesRead, bytesRead);
+
+        const char* data = buffer.data();
+        size_t pos = 0;
+        while (pos < filled) {
+            const char* lineBegin = data + pos;
+            const char* newline = static_cast<const char*>(memchr(lineBegin, '\n', filled - pos));
+            const char* lineEnd;
+            if (newline != nullptr) {
+                lineEnd = newline;
+            } else if (atEof) {
+                lineEnd = data + filled;  // Sista raden saknar radbrytning
+            } else {
+                break;  // Ofullständig rad, läs mer data
+            }
+            pos = (lineEnd - data) + (newline != nullptr ? 1 : 0);
+            ++lineNumber;
+
+            // Första raden är en header; tre fält betyder en sensorkolumn
+            if (lineNumber == 1) {
+                sensorColumn = count(lineBegin, lineEnd, ',') == 2;
+                report.sensorColumn = sensorColumn;
+                continue;
+            }
+
+            const char* trimmedEnd = lineEnd;
+            while (trimmedEnd > lineBegin && isBlank(trimmedEnd[-1])) --trimmedEnd;
+            if (trimmedEnd == lineBegin) continue;
+
+            double value;
+            int64_t timestampNs;
+            const char* sensorBegin = nullptr;
+            const char* sensorEnd = nullptr;
+            bool parsed = sensorColumn
+                ? parseSensorLine(lineBegin, trimmedEnd, value, timestampNs, sensorBegin, sensorEnd)
+                : parseLine(lineBegin, trimmedEnd, value, timestampNs);
+            if (parsed) {
+                if (sensors != nullptr) {
+                    size_t length = sensorEnd - sensorBegin;
+                    if (sensorColumn && lastSensor.compare(0, string::npos, sensorBegin, length) != 0) {
+                        lastSensor.assign(sensorBegin, length);
+                        lastSensorId = sensors->intern(lastSensor);
+                    }
+                    batchSensors.push_back(lastSensorId);
+                }
+                batchValues.push_back(value);
+                batchTimestamps.push_back(timestampNs);
+                ++report.rowsLoaded;
+                if (batchValues.size() >= batchSize) flushBatch(sink, sensorSink);
+            } else {
+                recordError(report, lineNumber, lineBegin, trimmedEnd);
+            }
+        }
+
+        // Flytta kvarvarande ofullständig rad till början av bufferten
+        size_t remaining = filled - pos;
+        if (remaining > 0 && pos > 0) {
+            memmove(buffer.data(), buffer.data() + pos, remaining);
+        }
+        filled = remaining;
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2);  // Raden är längre än blocket
+        }
+    }
+
+    flushBatch(sink, sensorSink);
+}
+
+bool CsvReader::hasSensorColumn(const string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) return false;
+    size_t commas = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF && c != '\n') commas += c == ',';
+    fclose(file);
+    return commas == 2;
+}
+
+bool CsvReader::readFileParallel(const string& filename, ThreadPool& pool, vector<CsvChunk>& chunks,
+                                 CsvLoadReport& report) {
+    IOT_TIME_OPERATION(ReadCsv);
+    chunks.clear();
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    // Headern läses först; den avgör om det finns en sensorkolumn
+    string header;
+    int c;
+    while ((c = fgetc(file)) != EOF && c != '\n') header.push_back(static_cast<char>(c));
+    uint64_t dataBegin = header.size() + (c == '\n' ? 1 : 0);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    IOT_COUNT(BytesRead, dataBegin);
+    uint64_t fileSize = size > 0 ? static_cast<uint64_t>(size) : 0;
+    bool sensorColumn = count(header.begin(), header.end(), ',') == 2;
+    report.sensorColumn = sensorColumn;
+    if (fileSize <= dataBegin) return true;
+
+    // Fler intervall än trådar jämnar ut lasten när raderna är olika dyra
+    uint64_t dataBytes = fileSize - dataBegin;
+    size_t rangeCount = static_cast<size_t>(
+        max<uint64_t>(1, min<uint64_t>(uint64_t(pool.size()) * 4, dataBytes / MIN_RANGE_BYTES)));
+    vector<uint64_t> bounds(rangeCount + 1);
+    for (size_t r = 0; r <= rangeCount; ++r) bounds[r] = dataBegin + dataBytes * r / rangeCount;
+
+    chunks.resize(rangeCount);
+    vector<CsvLoadReport> reports(rangeCount);
+    vector<size_t> lineCounts(rangeCount, 0);
+    vector<char> opened(rangeCount, 0);
+    pool.run(rangeCount, [&](size_t r) {
+        FILE* rangeFile = fopen(filename.c_str(), "rb");
+        if (rangeFile == nullptr) return;
+        opened[r] = 1;
+        // Egen läsare per tråd: buffertarna och tidszonscachen delas inte
+        CsvReader reader(blockSize, batchSize);
+        reader.timeCodec = timeCodec;
+        reader.readRange(rangeFile, bounds[r], bounds[r + 1], sensorColumn, chunks[r], reports[r], lineCounts[r]);
+        fclose(rangeFile);
+    });
+    if (find(opened.begin(), opened.end(), 0) != opened.end()) {
+        chunks.clear();
+        return false;
+    }
+
+    // Intervallens radnummer är lokala; headern är rad 1
+    size_t lineNumber = 1;
+    for (size_t r = 0; r < rangeCount; ++r) {
+        report.rowsLoaded += reports[r].rowsLoaded;
+        if (reports[r].parseErrors > 0 && report.parseErrors == 0) {
+            report.firstErrorLine = lineNumber + reports[r].firstErrorLine;
+            report.firstErrorText = reports[r].firstErrorText;
+        }
+        report.parseErrors += reports[r].parseErrors;
+        lineNumber += lineCounts[r];
+    }
+    return true;
+}
+
+// Parsa raderna som börjar i [begin, end), begin > 0. Raden som pågår vid
+// begin hör till föregående intervall, och den sista raden läses klart
+// även om den slutar efter end.
+void CsvReader::readRange(FILE* file, uint64_t begin, uint64_t end, bool sensorColumn, CsvChunk& chunk,
+                          CsvLoadReport& report, size_t& lineCount) {
+    lineCount = 0;
+    // Börja en byte före intervallet: är den en radbrytning börjar en rad vid begin
+    uint64_t offset = begin - 1;   // Filposition för buffer[0]
+    if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0) return;
+    buffer.resize(blockSize);
+    // Minst 16 byte per rad; reservationen rör inga sidor som inte används
+    chunk.values.reserve((end - begin) / 16 + 1);
+    chunk.timestamps.reserve((end - begin) / 16 + 1);
+    size_t filled = 0;
+    bool atEof = false;
+    bool skipping = true;
+    bool done = false;
+
+    while (!atEof && !done) {
+        size_t bytesRead = fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+        if (bytesRead == 0) atEof = true;
+        filled += bytesRead;
+        IOT_COUNT(BytesRead, bytesRead);
+
+        const char* data = buffer.data();
+        size_t pos = 0;
+        while (pos < filled) {
+            const char* lineBegin = data + pos;
+            const char* newline = static_cast<const char*>(memchr(lineBegin, '\n', filled - pos));
+            const char* lineEnd;
+            if (newline != nullptr) {
+                lineEnd = newline;
+            } else if (atEof) {
+                lineEnd = data + filled;
+            } else {
+                break;
+            }
+            uint64_t lineOffset = offset + pos;
+            pos = (lineEnd - data) + (newline != nullptr ? 1 : 0);
+            if (skipping) {
+                skipping = false;
+                continue;
+            }
+            if (lineOffset >= end) {
+                done = true;
+                break;
+            }
+            ++lineCount;
+
+            const char* trimmedEnd = lineEnd;
+            while (trimmedEnd > lineBegin && isBlank(trimmedEnd[-1])) --trimmedEnd;
+            if (trimmedEnd == lineBegin) continue;
+
+            double value;
+            int64_t timestampNs;
+            const char* sensorBegin;
+            const char* sensorEnd;
+            bool parsed = sensorColumn
+                ? parseSensorLine(lineBegin, trimmedEnd, value, timestampNs, sensorBegin, sensorEnd)
+                : parseLine(lineBegin, trimmedEnd, value, timestampNs);
+            if (parsed) {
+                chunk.values.push_back(value);
+                chunk.timestamps.push_back(timestampNs);
+            } else {
+                recordError(report, lineCount, lineBegin, trimmedEnd);
+            }
+        }
+
+        size_t remaining = filled - pos;
+        if (remaining > 0 && pos > 0) {
+            memmove(buffer.data(), buffer.data() + pos, remaining);
+        }
+        offset += pos;
+        filled = remaining;
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+
+    report.rowsLoaded = chunk.values.size();
+    IOT_COUNT(RowsParsed, chunk.values.size());
+}
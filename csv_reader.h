@@ -0,0 +1,108 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include "sensor_registry.h"
+#include "time_codec.h"
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Sammanställning av en inläsning. Parsningsfel räknas i stället för att
+// skrivas ut rad för rad, så att anroparen kan rapportera dem en gång.
+struct CsvLoadReport {
+    size_t rowsLoaded;
+    size_t parseErrors;
+    size_t firstErrorLine;        // 1-baserat radnummer, 0 om inga fel
+    std::string firstErrorText;   // Den första felaktiga raden (avkortad)
+    // Filen kunde inte öppnas eller läsas. Skiljer ett fel från en tom fil,
+    // eftersom loadFromFile returnerar false i båda fallen.
+    bool failed;
+    // Headern hade tre fält, dvs. en sensorkolumn
+    bool sensorColumn;
+
+    CsvLoadReport() : rowsLoaded(0), parseErrors(0), firstErrorLine(0), failed(false), sensorColumn(false) {}
+};
+
+// Parsade kolumner för ett byteintervall av en fil, se readFileParallel
+struct CsvChunk {
+    std::vector<double> values;
+    std::vector<std::int64_t> timestamps;
+};
+
+// Strömmande inläsning av "timestamp,value"- och "timestamp,sensor,value"-filer.
+// Filen läses i stora block, varje rad parsas utan strömmar eller
+// allokeringar och resultatet lämnas vidare i batchar till en mottagare.
+// Sensorkolumnen känns igen på att headern har tre fält.
+class CsvReader {
+public:
+    // Mottagare för en batch parsade rader. Tidsstämplar anges som
+    // nanosekunder sedan epoch. Pekarna gäller endast under anropet.
+    typedef std::function<void(const double* values,
+                               const std::int64_t* timestamps,
+                               size_t count)> BatchSink;
+    // Som BatchSink men med sensor-id (se SensorRegistry) för varje rad
+    typedef std::function<void(const std::uint32_t* sensors,
+                               const double* values,
+                               const std::int64_t* timestamps,
+                               size_t count)> SensorBatchSink;
+
+    explicit CsvReader(size_t blockSize = 1 << 20, size_t batchSize = 1 << 14);
+
+    // Läs en fil; returnerar false om filen inte kunde öppnas
+    bool readFile(const std::string& filename, const BatchSink& sink, CsvLoadReport& report);
+
+    // Läs en fil med trådarna i pool. Filen delas i byteintervall vid
+    // radbrytningar och varje intervall parsas av en egen tråd till egna
+    // kolumner; chunks får dem i filordning. Antal rader, fel och det
+    // första felets radnummer blir desamma som med readFile. En
+    // sensorkolumn hoppas över, så alla sensorer blir en serie.
+    bool readFileParallel(const std::string& filename, ThreadPool& pool, std::vector<CsvChunk>& chunks,
+                          CsvLoadReport& report);
+
+    // Läs från en redan öppnad ström (första raden antas vara en header).
+    // En sensorkolumn hoppas över, så alla sensorer blir en serie.
+    void readStream(std::FILE* file, const BatchSink& sink, CsvLoadReport& report);
+
+    // Sant om filens första rad är en header med sensorkolumn. Läser bara
+    // headern, så anroparen måste själv utesluta binära format.
+    static bool hasSensorColumn(const std::string& filename);
+
+    // Läs med sensorkolumn; namnen översätts till id via sensors. Filer
+    // utan sensorkolumn hamnar på SensorRegistry::DEFAULT_SENSOR.
+    bool readFile(const std::string& filename, SensorRegistry& sensors, const SensorBatchSink& sink,
+                  CsvLoadReport& report);
+    void readStream(std::FILE* file, SensorRegistry& sensors, const SensorBatchSink& sink,
+                    CsvLoadReport& report);
+
+    // Parsa en enskild rad "YYYY-MM-DD HH:MM[:SS],value" (eller epoch-sekunder)
+    bool parseLine(const char* begin, const char* end, double& value, std::int64_t& timestampNs);
+    // Parsa "tidsstämpel,sensor,value"; sensornamnet lämnas som [sensorBegin, sensorEnd)
+    bool parseSensorLine(const char* begin, const char* end, double& value, std::int64_t& timestampNs,
+                         const char*& sensorBegin, const char*& sensorEnd);
+
+    // Hur datum i filen tolkas (standard lokal tid), se TimeCodec
+    void setTimeMode(TimeMode mode) { timeCodec.setMode(mode); }
+
+private:
+    size_t blockSize;
+    size_t batchSize;
+    std::vector<char> buffer;
+    std::vector<double> batchValues;
+    std::vector<std::int64_t> batchTimestamps;
+    std::vector<std::uint32_t> batchSensors;
+
+    TimeCodec timeCodec;
+
+    void readRows(std::FILE* file, const BatchSink* sink, SensorRegistry* sensors,
+                  const SensorBatchSink* sensorSink, CsvLoadReport& report);
+    void flushBatch(const BatchSink* sink, const SensorBatchSink* sensorSink);
+    void readRange(std::FILE* file, std::uint64_t begin, std::uint64_t end, bool sensorColumn, CsvChunk& chunk,
+                   CsvLoadReport& report, size_t& lineCount);
+};
+
+#endif // CSV_READER_H
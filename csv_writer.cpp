@@ -0,0 +1,145 @@
+#include "csv_writer.h"
+#include "metrics.h"
+#include <charconv>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Längsta möjliga rad: tidsstämpel, komma, ett double med två decimaler
+const size_t MAX_ROW_LENGTH = 400;
+
+} // namespace
+
+CsvWriter::CsvWriter(size_t bufferSize)
+    : buffer(bufferSize < MAX_ROW_LENGTH * 2 ? MAX_ROW_LENGTH * 2 : bufferSize), used(0),
+      file(nullptr), ownsFile(false), failed(false) {
+}
+
+CsvWriter::~CsvWriter() {
+    // En fil som aldrig slutfördes tas bort i stället för att ersätta målet
+    if (file != nullptr && ownsFile) {
+        fclose(file);
+        if (writtenName != targetName) {
+            remove(writtenName.c_str());
+        }
+    }
+}
+
+bool CsvWriter::open(const string& filename, bool atomic) {
+    targetName = filename;
+    writtenName = atomic ? filename + ".tmp" : filename;
+    file = fopen(writtenName.c_str(), "wb");
+    ownsFile = true;
+    failed = file == nullptr;
+    used = 0;
+    return file != nullptr;
+}
+
+void CsvWriter::attach(FILE* stream) {
+    file = stream;
+    ownsFile = false;
+    failed = stream == nullptr;
+    used = 0;
+}
+
+void CsvWriter::flushBuffer() {
+    if (used == 0) return;
+    if (file == nullptr || fwrite(buffer.data(), 1, used, file) != used) {
+        failed = true;
+    } else {
+        IOT_COUNT(BytesWritten, used);
+    }
+    used = 0;
+}
+
+void CsvWriter::writeHeader() {
+    static const char header[] = "timestamp,value\n";
+    if (buffer.size() - used < sizeof(header)) flushBuffer();
+    memcpy(buffer.data() + used, header, sizeof(header) - 1);
+    used += sizeof(header) - 1;
+}
+
+void CsvWriter::writeRow(int64_t timestampNs, double value) {
+    if (buffer.size() - used < MAX_ROW_LENGTH) flushBuffer();
+
+    char* out = buffer.data() + used;
+    char* end = buffer.data() + buffer.size();
+    out = timeCodec.format(out, timestampNs);
+    *out++ = ',';
+    to_chars_result result = to_chars(out, end, value, chars_format::fixed, 2);
+    out = result.ptr;
+    *out++ = '\n';
+    used = out - buffer.data();
+}
+
+void CsvWriter::writeSensorHeader() {
+    static const char header[] = "timestamp,sensor,value\n";
+    if (buffer.size() - used < sizeof(header)) flushBuffer();
+    memcpy(buffer.data() + used, header, sizeof(header) - 1);
+    used += sizeof(header) - 1;
+}
+
+void CsvWriter::writeRow(int64_t timestampNs, const string& sensor, double value) {
+    // Sensornamnet kan vara längre än en vanlig rad
+    if (buffer.size() - used < MAX_ROW_LENGTH + sensor.size()) {
+        flushBuffer();
+        if (buffer.size() < MAX_ROW_LENGTH + sensor.size()) buffer.resize(MAX_ROW_LENGTH + sensor.size());
+    }
+
+    char* out = buffer.data() + used;
+    char* end = buffer.data() + buffer.size();
+    out = timeCodec.format(out, timestampNs);
+    *out++ = ',';
+    memcpy(out, sensor.data(), sensor.size());
+    out += sensor.size();
+    *out++ = ',';
+    to_chars_result result = to_chars(out, end, value, chars_format::fixed, 2);
+    out = result.ptr;
+    *out++ = '\n';
+    used = out - buffer.data();
+}
+
+void CsvWriter::writeRows(const double* values, const int64_t* timestamps, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        writeRow(timestamps[i], values[i]);
+    }
+}
+
+bool CsvWriter::close() {
+    flushBuffer();
+    if (file == nullptr) return false;
+
+    if (fflush(file) != 0) failed = true;
+    if (!ownsFile) {
+        file = nullptr;
+        return !failed;
+    }
+
+#ifndef _WIN32
+    // Se till att datan ligger på disk innan den ersätter den gamla filen
+    if (writtenName != targetName && fsync(fileno(file)) != 0) failed = true;
+#endif
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+
+    if (writtenName != targetName) {
+        if (failed) {
+            remove(writtenName.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        remove(targetName.c_str());
+#endif
+        if (rename(writtenName.c_str(), targetName.c_str()) != 0) {
+            remove(writtenName.c_str());
+            return false;
+        }
+    }
+    return !failed;
+}
@@ -0,0 +1,57 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "time_codec.h"
+#include <vector>
+
+// Buffrad CSV-skrivare för "timestamp,value"- och "timestamp,sensor,value"-filer.
+// Rader formateras direkt in i en stor återanvänd buffert: tidsstämpeln
+// med TimeCodec och värdet med std::to_chars. I lokal tid är utdata
+// byte-för-byte identisk med Measurement::toFileString().
+class CsvWriter {
+private:
+    std::vector<char> buffer;
+    size_t used;
+    std::FILE* file;
+    bool ownsFile;
+    bool failed;
+    std::string targetName;     // Slutligt filnamn
+    std::string writtenName;    // Filen som faktiskt skrivs (temporär vid atomisk sparning)
+
+    TimeCodec timeCodec;
+
+    void flushBuffer();
+
+public:
+    explicit CsvWriter(size_t bufferSize = 1 << 20);
+    ~CsvWriter();
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    // Öppna en fil. Vid atomisk sparning skrivs datan till en temporär fil
+    // som döps om till filename först i close(), så att en krasch mitt i
+    // sparningen aldrig lämnar en trunkerad fil efter sig.
+    bool open(const std::string& filename, bool atomic = true);
+
+    // Skriv till en redan öppnad ström (t.ex. stdout); strömmen stängs inte
+    void attach(std::FILE* stream);
+
+    // Hur tidsstämplar skrivs (standard lokal tid), se TimeCodec
+    void setTimeMode(TimeMode mode) { timeCodec.setMode(mode); }
+
+    void writeHeader();
+    void writeRow(std::int64_t timestampNs, double value);
+    void writeRows(const double* values, const std::int64_t* timestamps, size_t count);
+    // Med sensorkolumn (se SensorStore)
+    void writeSensorHeader();
+    void writeRow(std::int64_t timestampNs, const std::string& sensor, double value);
+
+    // Töm bufferten och slutför filen; false om någon skrivning misslyckades
+    bool close();
+};
+
+#endif // CSV_WRITER_H
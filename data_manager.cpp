@@ -1,289 +1,1104 @@
 #include "data_manager.h"
+#include "archive.h"
+#include "csv_reader.h"
+#include "csv_writer.h"
+#include "metrics.h"
+#include "stats_kernel.h"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
 #include <random>
-#include <fstream>
-#include <sstream>
+#include <limits>
+#include <cstdio>
 #include <iostream>
-#include <iomanip>
-#include <map>
 
 using namespace std;
 
+namespace {
+
+// Blockstorlek för parallella svep (256 Ki värden = 2 MiB)
+const size_t PARALLEL_CHUNK_SIZE = 1 << 18;
+
+// Samla index för värden som uppfyller villkoret; blockens resultat
+// slås ihop i ordning så att utdata blir densamma som seriellt
+template <typename Predicate>
+vector<size_t> collectIndices(ThreadPool* pool, const double* data, size_t count, Predicate predicate) {
+    vector<size_t> indices;
+    if (pool == nullptr) {
+        for (size_t i = 0; i < count; ++i) {
+            if (predicate(data[i])) indices.push_back(i);
+        }
+        return indices;
+    }
+    
+    vector<vector<size_t>> parts(ThreadPool::chunkCount(count, PARALLEL_CHUNK_SIZE));
+    pool->forEachChunk(count, PARALLEL_CHUNK_SIZE, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (predicate(data[i])) parts[chunk].push_back(i);
+        }
+    });
+    size_t total = 0;
+    for (const auto& part : parts) total += part.size();
+    indices.reserve(total);
+    for (const auto& part : parts) indices.insert(indices.end(), part.begin(), part.end());
+    return indices;
+}
+
+// Räkna värden som uppfyller villkoret
+template <typename Predicate>
+size_t countMatching(ThreadPool* pool, const double* data, size_t count, Predicate predicate) {
+    if (pool == nullptr) {
+        return count_if(data, data + count, predicate);
+    }
+    vector<size_t> parts(ThreadPool::chunkCount(count, PARALLEL_CHUNK_SIZE));
+    pool->forEachChunk(count, PARALLEL_CHUNK_SIZE, [&](size_t chunk, size_t begin, size_t end) {
+        parts[chunk] = count_if(data + begin, data + end, predicate);
+    });
+    return accumulate(parts.begin(), parts.end(), size_t(0));
+}
+
+// Samla radnummer i ett tidsintervall vars värden uppfyller villkoret,
+// i tidsordning
+template <typename Predicate>
+vector<size_t> collectRows(ThreadPool* pool, const double* data, const TimeRange& rows, Predicate predicate) {
+    if (rows.isContiguous()) {
+        vector<size_t> indices = collectIndices(pool, data + rows.firstRow(), rows.size(), predicate);
+        for (size_t& index : indices) index += rows.firstRow();
+        return indices;
+    }
+    vector<size_t> indices;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (predicate(data[rows.row(i)])) indices.push_back(rows.row(i));
+    }
+    return indices;
+}
+
+} // namespace
+
 // Konstruktor
-DataManager::DataManager() {
+DataManager::DataManager() : quantileSketchStale(false), rollupsStale(false), parallelCutoff(1 << 20), valueIndexEnabled(false), liveHistogramEnabled(false), mergedSensors(false), timeMode(TimeMode::Local), displayOrder(DisplayOrder::Time) {
     // Initieringslogik om det behövs
 }
 
+const char* const DataManager::SNAPSHOT_EXTENSION = ".snap";
+const char* const DataManager::STANDARD_STREAM = "-";
+
+// Privat hjälpmetod: Värdekolumnen, från snapshot eller vektor
+const double* DataManager::valueData() const {
+    return snapshot ? snapshot->values() : values.data();
+}
+
+// Privat hjälpmetod: Tidsstämpelkolumnen, från snapshot eller vektor
+const int64_t* DataManager::timestampData() const {
+    return snapshot ? snapshot->timestamps() : timestamps.data();
+}
+
+// Privat hjälpmetod: Kopiera in en mappad snapshot innan datan ändras
+void DataManager::detachSnapshot() {
+    if (!snapshot) return;
+    values.assign(snapshot->values(), snapshot->values() + snapshot->size());
+    timestamps.assign(snapshot->timestamps(), snapshot->timestamps() + snapshot->size());
+    snapshot.reset();
+}
+
 // Lägg till ett nytt mätvärde
 void DataManager::addMeasurement(double value) {
-    Measurement m;
-    m.value = value;
-    m.timestamp = chrono::system_clock::now();
-    measurements.push_back(m);
+    addMeasurement(value, chrono::system_clock::now());
+}
+
+void DataManager::addMeasurement(double value, chrono::system_clock::time_point timestamp) {
+    IOT_COUNT(MeasurementsAdded, 1);
+    detachSnapshot();
+    int64_t timestampNs = toEpochNanoseconds(timestamp);
+    if (!rollupsStale) rollups.add(value, timestampNs, values.size());
+    values.push_back(value);
+    timestamps.push_back(timestampNs);
+    runningStats.add(value);
+    if (!quantileSketchStale) quantileSketch.update(value);
+    if (liveHistogramEnabled) liveHistogram.add(value);
+}
+
+void DataManager::appendBatch(const double* batchValues, const int64_t* batchTimestamps, size_t count) {
+    if (count == 0) return;
+    IOT_TIME_OPERATION(AppendBatch);
+    IOT_COUNT(MeasurementsAdded, count);
+    detachSnapshot();
+    // Sammanfatta batchen medan den ligger i cache
+    runningStats.merge(summarizeValues(batchValues, count), values.size());
+    if (!quantileSketchStale) quantileSketch.updateRange(batchValues, count);
+    if (!rollupsStale) rollups.addBatch(batchValues, batchTimestamps, count, values.size());
+    if (liveHistogramEnabled) liveHistogram.addRange(batchValues, count);
+    values.insert(values.end(), batchValues, batchValues + count);
+    timestamps.insert(timestamps.end(), batchTimestamps, batchTimestamps + count);
+}
+
+// Privat hjälpmetod: Lägg till kolumner som parsats parallellt. Ett enda
+// block flyttas in utan kopiering när lagret är tomt; annars kopieras
+// blocken till sina platser och sammanfattas parallellt. Kvantilskissen
+// och aggregaten byggs som efter en snapshot först när de efterfrågas
+// (se finishBulkAppend).
+void DataManager::appendChunks(vector<CsvChunk>& chunks) {
+    size_t total = 0;
+    for (const CsvChunk& chunk : chunks) total += chunk.values.size();
+    if (total == 0) return;
+    IOT_TIME_OPERATION(AppendBatch);
+    IOT_COUNT(MeasurementsAdded, total);
+    detachSnapshot();
+    
+    size_t start = values.size();
+    vector<size_t> offsets(chunks.size());
+    vector<RunningStats> parts(chunks.size());
+    if (start == 0 && chunks.size() == 1) {
+        values = move(chunks[0].values);
+        timestamps = move(chunks[0].timestamps);
+        parts[0] = summarizeValues(values.data(), total);
+    } else {
+        for (size_t c = 1; c < chunks.size(); ++c) offsets[c] = offsets[c - 1] + chunks[c - 1].values.size();
+        values.resize(start + total);
+        timestamps.resize(start + total);
+        auto place = [&](size_t c) {
+            CsvChunk& chunk = chunks[c];
+            size_t at = start + offsets[c];
+            copy(chunk.values.begin(), chunk.values.end(), values.begin() + at);
+            copy(chunk.timestamps.begin(), chunk.timestamps.end(), timestamps.begin() + at);
+            parts[c] = summarizeValues(values.data() + at, chunk.values.size());
+            // Lämna tillbaka blockets minne direkt så att toppen hålls nere
+            vector<double>().swap(chunk.values);
+            vector<int64_t>().swap(chunk.timestamps);
+        };
+        ThreadPool* pool = parallelPool(total);
+        if (pool == nullptr) {
+            for (size_t c = 0; c < chunks.size(); ++c) place(c);
+        } else {
+            pool->run(chunks.size(), place);
+        }
+    }
+    finishBulkAppend(start, parts, offsets);
+}
+
+// Privat hjälpmetod: Slå ihop delsammanfattningarna för rader som lagts
+// till i bulk från rad start (del c börjar vid start + offsets[c])
+void DataManager::finishBulkAppend(size_t start, const vector<RunningStats>& parts, const vector<size_t>& offsets) {
+    for (size_t c = 0; c < parts.size(); ++c) {
+        runningStats.merge(parts[c], start + offsets[c]);
+    }
+    quantileSketchStale = true;
+    rollupsStale = true;
+    if (liveHistogramEnabled) liveHistogram.addRange(values.data() + start, values.size() - start);
 }
 
 // Rensa alla mätvärden
 void DataManager::clearAllMeasurements() {
-    measurements.clear();
+    snapshot.reset();
+    values.clear();
+    timestamps.clear();
+    runningStats = RunningStats();
+    quantileSketch.clear();
+    quantileSketchStale = false;
+    rollups.clear();
+    rollupsStale = false;
+    timeIndex.clear();
+    valueIndex.clear();
+    displayOrder = DisplayOrder::Time;
+    liveHistogram.clear();
+    mergedSensors = false;
 }
 
 // Hämta antal mätvärden
 size_t DataManager::getMeasurementCount() const {
-    return measurements.size();
+    return snapshot ? snapshot->size() : values.size();
 }
 
-// Privat hjälpmetod: Beräkna medelvärde
-double DataManager::calculateMean() const {
-    if (measurements.empty()) return 0.0;
+// Privat hjälpmetod: Sammanfatta alla värden, block för block parallellt
+RunningStats DataManager::summarizeAll() const {
+    const double* data = valueData();
+    size_t count = getMeasurementCount();
+    ThreadPool* pool = parallelPool(count);
+    if (pool == nullptr) {
+        return summarizeValues(data, count);
+    }
     
-    double sum = 0.0;
-    for (const auto& m : measurements) {
-        sum += m.value;
+    vector<RunningStats> parts(ThreadPool::chunkCount(count, PARALLEL_CHUNK_SIZE));
+    pool->forEachChunk(count, PARALLEL_CHUNK_SIZE, [&](size_t chunk, size_t begin, size_t end) {
+        parts[chunk] = summarizeValues(data + begin, end - begin);
+    });
+    RunningStats total;
+    for (size_t chunk = 0; chunk < parts.size(); ++chunk) {
+        total.merge(parts[chunk], chunk * PARALLEL_CHUNK_SIZE);
     }
-    return sum / measurements.size();
+    return total;
 }
 
-// Privat hjälpmetod: Beräkna varians
-double DataManager::calculateVariance(double mean) const {
-    if (measurements.size() <= 1) return 0.0;
-    
-    double variance = 0.0;
-    for (const auto& m : measurements) {
-        variance += pow(m.value - mean, 2);
+// Privat hjälpmetod: Trådpoolen om svepet är stort nog att dela upp
+ThreadPool* DataManager::parallelPool(size_t count) const {
+    if (!threadPool || threadPool->size() <= 1 || count < parallelCutoff) {
+        return nullptr;
     }
-    return variance / measurements.size();
+    return threadPool.get();
+}
+
+// Ställ in antal trådar för analyserna
+void DataManager::setThreadCount(unsigned threads) {
+    if (threads == 1) {
+        threadPool.reset();
+    } else if (!threadPool || threads == 0 || threadPool->size() != threads) {
+        threadPool = make_shared<ThreadPool>(threads);
+    }
+}
+
+unsigned DataManager::getThreadCount() const {
+    return threadPool ? threadPool->size() : 1;
+}
+
+void DataManager::setParallelCutoff(size_t minimumCount) {
+    parallelCutoff = minimumCount;
 }
 
-// Beräkna fullständig statistik
+// Räkna om statistiken från grunden
+DataManager::Statistics DataManager::scanStatistics() const {
+    IOT_TIME_OPERATION(Statistics);
+    return toStatistics(summarizeAll());
+}
+
+// Hämta fullständig statistik från de löpande aggregaten
 DataManager::Statistics DataManager::calculateStatistics() const {
-    Statistics stats;
-    
-    if (measurements.empty()) {
-        return stats;
+    return toStatistics(runningStats);
+}
+
+// Hämta de löpande aggregaten för sammanslagning med andra delresultat
+const RunningStats& DataManager::getRunningStats() const {
+    return runningStats;
+}
+
+// Lägg till en annan DataManagers mätvärden; aggregaten slås ihop i O(1)
+void DataManager::appendMeasurements(const DataManager& other) {
+    if (&other == this) {
+        DataManager copy(other);
+        appendMeasurements(copy);
+        return;
+    }
+    detachSnapshot();
+    size_t offset = values.size();
+    size_t otherCount = other.getMeasurementCount();
+    values.insert(values.end(), other.valueData(), other.valueData() + otherCount);
+    timestamps.insert(timestamps.end(), other.timestampData(), other.timestampData() + otherCount);
+    runningStats.merge(other.runningStats, offset);
+    if (!quantileSketchStale) quantileSketch.merge(other.syncedQuantileSketch());
+    if (!rollupsStale) rollups.merge(other.syncedRollups(), offset);
+    if (liveHistogramEnabled &&
+        !(other.liveHistogramEnabled && liveHistogram.merge(other.liveHistogram))) {
+        liveHistogram.addRange(other.valueData(), otherCount);
+    }
+}
+
+double DataManager::exactQuantile(double q) const {
+    IOT_TIME_OPERATION(Quantile);
+    return ::exactQuantile(valueData(), getMeasurementCount(), q);
+}
+
+vector<double> DataManager::exactQuantiles(const vector<double>& qs) const {
+    IOT_TIME_OPERATION(Quantile);
+    return ::exactQuantiles(valueData(), getMeasurementCount(), qs);
+}
+
+double DataManager::estimateQuantile(double q) const {
+    IOT_TIME_OPERATION(Quantile);
+    return syncedQuantileSketch().quantile(q);
+}
+
+const KllSketch& DataManager::getQuantileSketch() const {
+    return syncedQuantileSketch();
+}
+
+// Privat hjälpmetod: Bygg om skissen från alla värden om den är inaktuell
+const KllSketch& DataManager::syncedQuantileSketch() const {
+    if (quantileSketchStale) {
+        quantileSketch.clear();
+        quantileSketch.updateRange(valueData(), getMeasurementCount());
+        quantileSketchStale = false;
+    }
+    return quantileSketch;
+}
+
+// Privat hjälpmetod: Bygg om aggregaten om de är inaktuella. En snapshot
+// med sparade aggregat kopierar dem i stället för att läsa kolumnerna.
+const Rollups& DataManager::syncedRollups() const {
+    if (rollupsStale) {
+        rollups.clear();
+        if (snapshot && snapshot->hasRollups()) {
+            for (RollupTier tier : ROLLUP_TIERS) {
+                rollups.assign(tier, snapshot->rollupBuckets(tier), snapshot->rollupBucketCount(tier));
+            }
+        } else {
+            rollups.addBatch(valueData(), timestampData(), getMeasurementCount(), 0);
+        }
+        rollupsStale = false;
+    }
+    return rollups;
+}
+
+const Rollups& DataManager::getRollups() const {
+    return syncedRollups();
+}
+
+// Privat hjälpmetod: Ta med nya rader i tidsindexet
+const TimeIndex& DataManager::syncedTimeIndex() const {
+    timeIndex.sync(timestampData(), getMeasurementCount());
+    timeIndex.mergePending(timestampData());
+    return timeIndex;
+}
+
+// Privat hjälpmetod: Kolumnerna för [startNs, endNs) i tidsordning
+DataManager::RangeColumns DataManager::timeRangeColumns(int64_t startNs, int64_t endNs,
+                                                        vector<double>& valueBuffer,
+                                                        vector<int64_t>& timestampBuffer) const {
+    RangeColumns columns;
+    columns.rows = syncedTimeIndex().find(timestampData(), startNs, endNs);
+    columns.count = columns.rows.size();
+    if (columns.rows.isContiguous()) {
+        columns.values = valueData() + columns.rows.firstRow();
+        columns.timestamps = timestampData() + columns.rows.firstRow();
+        return columns;
     }
     
-    stats.count = measurements.size();
+    const double* data = valueData();
+    const int64_t* times = timestampData();
+    valueBuffer.resize(columns.count);
+    timestampBuffer.resize(columns.count);
+    for (size_t i = 0; i < columns.count; ++i) {
+        valueBuffer[i] = data[columns.rows.row(i)];
+        timestampBuffer[i] = times[columns.rows.row(i)];
+    }
+    columns.values = valueBuffer.data();
+    columns.timestamps = timestampBuffer.data();
+    return columns;
+}
+
+// Privat hjälpmetod: Sammanfatta raderna i ett intervall med radnummer som index
+RunningStats DataManager::summarizeRows(const TimeRange& rows) const {
+    RunningStats total;
+    if (rows.isContiguous()) {
+        total.merge(summarizeValues(valueData() + rows.firstRow(), rows.size()), rows.firstRow());
+        return total;
+    }
+    const double* data = valueData();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        total.addAt(data[rows.row(i)], rows.row(i));
+    }
+    return total;
+}
+
+// Privat hjälpmetod: Sammanfatta raderna med tidsstämpel i [startNs, endNs)
+RunningStats DataManager::summarizeTimeRange(int64_t startNs, int64_t endNs) const {
+    const TimeIndex& index = syncedTimeIndex();
+    const int64_t* times = timestampData();
+    TimeRange rows = index.find(times, startNs, endNs);
+    if (rows.empty()) {
+        return RunningStats();
+    }
     
-    // Beräkna summa, min och max
-    stats.min = measurements[0].value;
-    stats.max = measurements[0].value;
-    stats.minIndex = 0;
-    stats.maxIndex = 0;
+    // Hela minuter inom intervallet tas från aggregaten. Gränserna räknas
+    // från de faktiska första och sista raderna så att inget kan slå runt.
+    int64_t minute = rollupWidthNs(RollupTier::Minute);
+    int64_t wholeStart = rollupBucketStart(RollupTier::Minute, times[rows.row(0)]);
+    if (wholeStart < startNs) wholeStart += minute;
+    int64_t wholeEnd = rollupBucketStart(RollupTier::Minute, times[rows.row(rows.size() - 1)]);
+    if (wholeEnd + minute <= endNs) wholeEnd += minute;
+    if (wholeStart >= wholeEnd) {
+        return summarizeRows(rows);
+    }
     
-    for (size_t i = 0; i < measurements.size(); ++i) {
-        double value = measurements[i].value;
-        stats.sum += value;
-        
-        if (value < stats.min) {
-            stats.min = value;
-            stats.minIndex = i;
-        }
-        if (value > stats.max) {
-            stats.max = value;
-            stats.maxIndex = i;
+    // Kanterna hittas med två binärsökningar till i indexet
+    RunningStats total = summarizeRows(index.find(times, startNs, wholeStart));
+    total.merge(syncedRollups().combineRange(wholeStart, wholeEnd));
+    total.merge(summarizeRows(index.find(times, wholeEnd, endNs)));
+    return total;
+}
+
+size_t DataManager::countInTimeRange(TimePoint start, TimePoint end) const {
+    return syncedTimeIndex().find(timestampData(), toEpochNanoseconds(start), toEpochNanoseconds(end)).size();
+}
+
+MeasurementSelection DataManager::findInTimeRange(TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(RangeQuery);
+    TimeRange rows = syncedTimeIndex().find(timestampData(), toEpochNanoseconds(start), toEpochNanoseconds(end));
+    vector<size_t> indices(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        indices[i] = rows.row(i);
+    }
+    return MeasurementSelection(measurementsView(), move(indices));
+}
+
+MeasurementSelection DataManager::findAboveThreshold(double threshold, TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(Threshold);
+    TimeRange rows = syncedTimeIndex().find(timestampData(), toEpochNanoseconds(start), toEpochNanoseconds(end));
+    return MeasurementSelection(measurementsView(), collectRows(parallelPool(rows.size()), valueData(), rows,
+        [threshold](double v) { return v > threshold; }));
+}
+
+MeasurementSelection DataManager::findBelowThreshold(double threshold, TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(Threshold);
+    TimeRange rows = syncedTimeIndex().find(timestampData(), toEpochNanoseconds(start), toEpochNanoseconds(end));
+    return MeasurementSelection(measurementsView(), collectRows(parallelPool(rows.size()), valueData(), rows,
+        [threshold](double v) { return v <= threshold; }));
+}
+
+DataManager::Statistics DataManager::calculateRangeStatistics(TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(RangeQuery);
+    return toStatistics(summarizeTimeRange(toEpochNanoseconds(start), toEpochNanoseconds(end)));
+}
+
+vector<double> DataManager::exactQuantiles(const vector<double>& qs, TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(Quantile);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(toEpochNanoseconds(start), toEpochNanoseconds(end),
+                                            valueBuffer, timestampBuffer);
+    return ::exactQuantiles(columns.values, columns.count, qs);
+}
+
+size_t DataManager::calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, TimePoint start,
+                                          TimePoint end, double* out) const {
+    IOT_TIME_OPERATION(MovingWindow);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(toEpochNanoseconds(start), toEpochNanoseconds(end),
+                                            valueBuffer, timestampBuffer);
+    return movingWindowOver(columns.values, columns.count, windowSize, aggregate, out);
+}
+
+size_t DataManager::calculateMovingWindow(chrono::nanoseconds duration, WindowAggregate aggregate,
+                                          TimePoint start, TimePoint end, double* out) const {
+    IOT_TIME_OPERATION(MovingWindow);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(toEpochNanoseconds(start), toEpochNanoseconds(end),
+                                            valueBuffer, timestampBuffer);
+    return movingWindowOverTime(columns.values, columns.timestamps, columns.count, duration.count(),
+                                aggregate, out);
+}
+
+// Fack som täcker intervallets ändliga värden; de läses två gånger
+Histogram DataManager::generateHistogram(double binWidth, TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(Histogram);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(toEpochNanoseconds(start), toEpochNanoseconds(end),
+                                            valueBuffer, timestampBuffer);
+    double low = numeric_limits<double>::infinity();
+    double high = -numeric_limits<double>::infinity();
+    for (size_t i = 0; i < columns.count; ++i) {
+        if (isfinite(columns.values[i])) {
+            low = min(low, columns.values[i]);
+            high = max(high, columns.values[i]);
         }
     }
+    Histogram layout = Histogram::centeredCovering(low, high, binWidth);
+    return histogramOver(columns.values, columns.count, layout.getLowerBound(), layout.getBinWidth(),
+                         layout.binCount());
+}
+
+Histogram DataManager::generateHistogram(double lowerBound, double binWidth, size_t binCount,
+                                         TimePoint start, TimePoint end) const {
+    IOT_TIME_OPERATION(Histogram);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(toEpochNanoseconds(start), toEpochNanoseconds(end),
+                                            valueBuffer, timestampBuffer);
+    return histogramOver(columns.values, columns.count, lowerBound, binWidth, binCount);
+}
+
+// Välj ut rader att rita, i tidsordning; oordnade rader läses via tidsindexet
+vector<size_t> DataManager::downsample(size_t targetPoints, DownsampleMethod method) const {
+    IOT_TIME_OPERATION(Downsample);
+    vector<double> valueBuffer;
+    vector<int64_t> timestampBuffer;
+    RangeColumns columns = timeRangeColumns(numeric_limits<int64_t>::min(), numeric_limits<int64_t>::max(),
+                                            valueBuffer, timestampBuffer);
+    vector<size_t> selected = method == DownsampleMethod::MinMax
+        ? downsampleMinMax(columns.values, columns.count, (targetPoints + 1) / 2)
+        : downsampleLttb(columns.values, columns.timestamps, columns.count, targetPoints);
+    for (size_t& position : selected) {
+        position = columns.rows.row(position);
+    }
+    return selected;
+}
+
+// Omvandla en sammanfattning till rapportformatet
+DataManager::Statistics DataManager::toStatistics(const RunningStats& summary) {
+    Statistics stats;
+    
+    if (summary.count == 0) {
+        return stats;
+    }
     
-    // Beräkna övrig statistik
-    stats.mean = stats.sum / stats.count;
-    stats.variance = calculateVariance(stats.mean);
+    stats.count = summary.count;
+    stats.sum = summary.sum;
+    stats.mean = summary.mean;
+    stats.min = summary.min;
+    stats.max = summary.max;
+    stats.minIndex = summary.minIndex;
+    stats.maxIndex = summary.maxIndex;
+    stats.variance = summary.variance();
     stats.standardDeviation = sqrt(stats.variance);
     
     return stats;
 }
 
-// Simulera sensordata
+// Simulera sensordata: likformigt 20-30, en mätning per sekund fram till nu
 void DataManager::simulateSensorData(int count) {
+    if (count <= 0) return;
     random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<double> dist(20.0, 30.0);
+    Xoshiro256 generator((static_cast<uint64_t>(rd()) << 32) | rd());
+    int64_t step = 1000000000LL;
+    int64_t first = toEpochNanoseconds(chrono::system_clock::now()) - (count - 1) * step;
     
-    for (int i = 0; i < count; ++i) {
-        addMeasurement(dist(gen));
+    const size_t batchSize = 1 << 14;
+    vector<double> batchValues(batchSize);
+    vector<int64_t> batchTimestamps(batchSize);
+    detachSnapshot();
+    values.reserve(values.size() + count);
+    timestamps.reserve(timestamps.size() + count);
+    for (size_t done = 0; done < static_cast<size_t>(count); ) {
+        size_t n = min(batchSize, static_cast<size_t>(count) - done);
+        for (size_t i = 0; i < n; ++i) {
+            batchValues[i] = 20.0 + 10.0 * generator.nextDouble();
+            batchTimestamps[i] = first + static_cast<int64_t>(done + i) * step;
+        }
+        appendBatch(batchValues.data(), batchTimestamps.data(), n);
+        done += n;
     }
 }
 
-// Hämta alla värden som en vektor
-vector<double> DataManager::getAllValues() const {
-    vector<double> values;
-    for (const auto& m : measurements) {
-        values.push_back(m.value);
-    }
-    return values;
+void DataManager::simulate(const SimulationProfile& profile, size_t count) {
+    IOT_TIME_OPERATION(AppendBatch);
+    SensorSimulator simulator(profile, count);
+    size_t blocks = simulator.blockCount();
+    if (blocks == 0) return;
+    ThreadPool* pool = parallelPool(count);
+    auto forEachBlock = [pool, blocks](const function<void(size_t)>& body) {
+        if (pool == nullptr) {
+            for (size_t b = 0; b < blocks; ++b) body(b);
+        } else {
+            pool->run(blocks, body);
+        }
+    };
+    
+    // Första svepet räknar raderna som blir kvar efter avbrotten, så att
+    // varje block vet var det ska skrivas
+    vector<size_t> offsets(blocks + 1, 0);
+    forEachBlock([&](size_t b) { offsets[b + 1] = simulator.blockRows(b); });
+    partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    size_t total = offsets.back();
+    offsets.pop_back();
+    if (total == 0) return;
+    IOT_COUNT(MeasurementsAdded, total);
+    
+    detachSnapshot();
+    size_t start = values.size();
+    values.resize(start + total);
+    timestamps.resize(start + total);
+    vector<RunningStats> parts(blocks);
+    forEachBlock([&](size_t b) {
+        double* blockValues = values.data() + start + offsets[b];
+        size_t rows = simulator.generateBlock(b, blockValues, timestamps.data() + start + offsets[b]);
+        parts[b] = summarizeValues(blockValues, rows);
+    });
+    finishBulkAppend(start, parts, offsets);
+}
+
+// Hämta alla värden som en vy över kolumnen
+ValueSpan DataManager::getAllValues() const {
+    return ValueSpan(valueData(), getMeasurementCount());
+}
+
+MeasurementView DataManager::getAllMeasurements() const {
+    return measurementsView();
+}
+
+Measurement DataManager::getMeasurement(size_t index) const {
+    return Measurement{ valueData()[index], fromEpochNanoseconds(timestampData()[index]) };
 }
 
-// Hämta alla mätvärden
-vector<Measurement> DataManager::getAllMeasurements() const {
-    return measurements;
+MeasurementView DataManager::measurementsView() const {
+    return MeasurementView(valueData(), timestampData(), getMeasurementCount());
 }
 
 // Sök efter specifikt värde
-vector<int> DataManager::findValue(double target, double tolerance) const {
-    vector<int> indices;
+vector<size_t> DataManager::findValue(double target, double tolerance) const {
+    IOT_TIME_OPERATION(Search);
+    const double* data = valueData();
     
-    for (size_t i = 0; i < measurements.size(); ++i) {
-        if (abs(measurements[i].value - target) < tolerance) {
-            indices.push_back(i);
+    if (valueIndexEnabled) {
+        // Kandidaterna ligger i ett sammanhängande intervall i indexet
+        vector<size_t> indices;
+        for (size_t i : indicesInRange(target - tolerance, target + tolerance)) {
+            if (abs(data[i] - target) < tolerance) {
+                indices.push_back(i);
+            }
         }
+        sort(indices.begin(), indices.end());
+        return indices;
     }
     
-    return indices;
+    size_t count = getMeasurementCount();
+    return collectIndices(parallelPool(count), data, count,
+        [target, tolerance](double v) { return abs(v - target) < tolerance; });
 }
 
-// Hitta mätvärden över tröskel
-vector<Measurement> DataManager::findAboveThreshold(double threshold) const {
-    vector<Measurement> result;
-    
-    for (const auto& m : measurements) {
-        if (m.value > threshold) {
-            result.push_back(m);
-        }
-    }
-    
-    return result;
+// Hitta mätvärden över tröskel; urvalet pekar in i lagret i stället för
+// att kopiera ut varje rad
+MeasurementSelection DataManager::findAboveThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    MeasurementView view = measurementsView();
+    return MeasurementSelection(view, collectIndices(parallelPool(view.size()), view.valueData(), view.size(),
+        [threshold](double v) { return v > threshold; }));
 }
 
 // Hitta mätvärden under tröskel
-vector<Measurement> DataManager::findBelowThreshold(double threshold) const {
-    vector<Measurement> result;
-    
-    for (const auto& m : measurements) {
-        if (m.value <= threshold) {
-            result.push_back(m);
-        }
+MeasurementSelection DataManager::findBelowThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    MeasurementView view = measurementsView();
+    return MeasurementSelection(view, collectIndices(parallelPool(view.size()), view.valueData(), view.size(),
+        [threshold](double v) { return v <= threshold; }));
+}
+
+// Privat hjälpmetod: Uppdatera värdeindexet med nya rader
+const ValueIndex& DataManager::syncedValueIndex(bool merged) const {
+    valueIndex.sync(valueData(), getMeasurementCount());
+    if (merged) {
+        valueIndex.mergePending(valueData());
     }
-    
-    return result;
+    return valueIndex;
+}
+
+// Slå på eller av värdeindexet
+void DataManager::setValueIndexEnabled(bool enabled) {
+    valueIndexEnabled = enabled;
+    if (!enabled) {
+        valueIndex.clear();
+    }
+}
+
+bool DataManager::isValueIndexEnabled() const {
+    return valueIndexEnabled;
 }
 
-// Sortera mätvärden stigande
+// Räkna mätvärden över tröskel
+size_t DataManager::countAboveThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    if (valueIndexEnabled) {
+        return syncedValueIndex(false).countAbove(valueData(), threshold);
+    }
+    return countMatching(parallelPool(getMeasurementCount()), valueData(), getMeasurementCount(),
+        [threshold](double v) { return v > threshold; });
+}
+
+// Räkna mätvärden på eller under tröskel
+size_t DataManager::countBelowThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    if (valueIndexEnabled) {
+        return syncedValueIndex(false).countAtMost(valueData(), threshold);
+    }
+    return countMatching(parallelPool(getMeasurementCount()), valueData(), getMeasurementCount(),
+        [threshold](double v) { return v <= threshold; });
+}
+
+// Räkna mätvärden i ett slutet intervall
+size_t DataManager::countInRange(double low, double high) const {
+    IOT_TIME_OPERATION(Threshold);
+    if (valueIndexEnabled) {
+        return syncedValueIndex(false).countInRange(valueData(), low, high);
+    }
+    return countMatching(parallelPool(getMeasurementCount()), valueData(), getMeasurementCount(),
+        [low, high](double v) { return v >= low && v <= high; });
+}
+
+IndexSpan DataManager::indicesAboveThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    return syncedValueIndex(true).above(valueData(), threshold);
+}
+
+IndexSpan DataManager::indicesBelowThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    return syncedValueIndex(true).atMost(valueData(), threshold);
+}
+
+IndexSpan DataManager::indicesInRange(double low, double high) const {
+    IOT_TIME_OPERATION(Threshold);
+    return syncedValueIndex(true).inRange(valueData(), low, high);
+}
+
+// Sortera mätvärden stigande. Värdeindexet sorteras klart här så att
+// visningen sedan bara läser ut det.
 void DataManager::sortMeasurementsAscending() {
-    sort(measurements.begin(), measurements.end(), 
-        [](const Measurement& a, const Measurement& b) {
-            return a.value < b.value;
-        });
+    IOT_TIME_OPERATION(Sort);
+    syncedValueIndex(true);
+    displayOrder = DisplayOrder::ValueAscending;
 }
 
 // Sortera mätvärden fallande
 void DataManager::sortMeasurementsDescending() {
-    sort(measurements.begin(), measurements.end(), 
-        [](const Measurement& a, const Measurement& b) {
-            return a.value > b.value;
-        });
+    IOT_TIME_OPERATION(Sort);
+    syncedValueIndex(true);
+    displayOrder = DisplayOrder::ValueDescending;
+}
+
+void DataManager::setDisplayOrder(DisplayOrder order) {
+    displayOrder = order;
+}
+
+DataManager::DisplayOrder DataManager::getDisplayOrder() const {
+    return displayOrder;
+}
+
+// Radnumren i visningsordning; NaN hamnar sist stigande och först fallande
+MeasurementSelection DataManager::measurementsInDisplayOrder() const {
+    vector<size_t> rows;
+    if (displayOrder == DisplayOrder::Time) {
+        TimeRange all = syncedTimeIndex().all();
+        rows.resize(all.size());
+        for (size_t i = 0; i < all.size(); ++i) {
+            rows[i] = all.row(i);
+        }
+    } else {
+        IndexSpan sorted = syncedValueIndex(true).all();
+        if (displayOrder == DisplayOrder::ValueAscending) {
+            rows.assign(sorted.begin(), sorted.end());
+        } else {
+            rows.assign(reverse_iterator<const size_t*>(sorted.end()),
+                        reverse_iterator<const size_t*>(sorted.begin()));
+        }
+    }
+    return MeasurementSelection(measurementsView(), move(rows));
 }
 
 // Beräkna glidande medelvärde
 vector<double> DataManager::calculateMovingAverage(int windowSize) const {
-    vector<double> movingAverages;
+    if (windowSize <= 0) {
+        return vector<double>();
+    }
     
-    if (measurements.size() < windowSize) {
-        return movingAverages;
+    vector<double> movingAverages(movingWindowOutputCount(windowSize));
+    calculateMovingWindow(windowSize, WindowAggregate::Mean, movingAverages.data());
+    return movingAverages;
+}
+
+// Antal fönster av given storlek som ryms i datan
+size_t DataManager::movingWindowOutputCount(size_t windowSize) const {
+    return SlidingWindowEngine::outputCount(getMeasurementCount(), windowSize);
+}
+
+// Glidande fönster över de senaste windowSize mätvärdena
+size_t DataManager::calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, double* out) const {
+    IOT_TIME_OPERATION(MovingWindow);
+    return movingWindowOver(valueData(), getMeasurementCount(), windowSize, aggregate, out);
+}
+
+// Glidande fönster över en bakåtblickande tidsperiod
+size_t DataManager::calculateMovingWindow(chrono::nanoseconds duration, WindowAggregate aggregate,
+                                          double* out) const {
+    // Tidsfönster kräver tidsordning; oordnade rader läses via tidsindexet
+    if (!syncedTimeIndex().isOrdered()) {
+        return calculateMovingWindow(duration, aggregate, TimePoint::min(), TimePoint::max(), out);
+    }
+    IOT_TIME_OPERATION(MovingWindow);
+    return movingWindowOverTime(valueData(), timestampData(), getMeasurementCount(), duration.count(),
+                                aggregate, out);
+}
+
+// Privat hjälpmetod: Räknebaserat fönster över en kolumn, parallellt om den är stor
+size_t DataManager::movingWindowOver(const double* data, size_t count, size_t windowSize,
+                                     WindowAggregate aggregate, double* out) const {
+    size_t outputs = SlidingWindowEngine::outputCount(count, windowSize);
+    ThreadPool* pool = parallelPool(outputs);
+    if (pool == nullptr) {
+        return windowEngine.rolling(data, count, windowSize, aggregate, out);
     }
     
-    for (size_t i = windowSize - 1; i < measurements.size(); ++i) {
-        double sum = 0.0;
-        for (int j = 0; j < windowSize; ++j) {
-            sum += measurements[i - j].value;
-        }
-        movingAverages.push_back(sum / windowSize);
+    // Varje block av utdata läser sina egna windowSize - 1 värden bakåt
+    pool->forEachChunk(outputs, PARALLEL_CHUNK_SIZE, [&](size_t, size_t begin, size_t end) {
+        SlidingWindowEngine engine;
+        engine.rolling(data + begin, end - begin + windowSize - 1, windowSize, aggregate, out + begin);
+    });
+    return outputs;
+}
+
+// Privat hjälpmetod: Tidsbaserat fönster över tidsordnade kolumner
+size_t DataManager::movingWindowOverTime(const double* data, const int64_t* times, size_t count,
+                                         int64_t durationNs, WindowAggregate aggregate, double* out) const {
+    ThreadPool* pool = parallelPool(count);
+    if (pool == nullptr) {
+        return windowEngine.rollingByTime(data, times, count, durationNs, aggregate, out);
     }
     
-    return movingAverages;
+    // Varje block börjar läsa vid det äldsta värdet i sitt första fönster
+    pool->forEachChunk(count, PARALLEL_CHUNK_SIZE, [&](size_t, size_t begin, size_t end) {
+        size_t historyStart = upper_bound(times, times + begin, times[begin] - durationNs) - times;
+        SlidingWindowEngine engine;
+        engine.rollingByTime(data + historyStart, times + historyStart, end - historyStart,
+                             durationNs, aggregate, out + begin, begin - historyStart);
+    });
+    return count;
 }
 
 // Generera histogram
-map<int, int> DataManager::generateHistogram() const {
-    map<int, int> histogram;
+Histogram DataManager::generateHistogram(double binWidth) const {
+    double low = runningStats.min;
+    double high = runningStats.max;
+    
+    // Aggregaten kan innehålla NaN eller oändligheter; ta då fram det
+    // ändliga intervallet med ett extra svep
+    if (!isfinite(low) || !isfinite(high)) {
+        low = numeric_limits<double>::infinity();
+        high = -numeric_limits<double>::infinity();
+        const double* data = valueData();
+        size_t count = getMeasurementCount();
+        for (size_t i = 0; i < count; ++i) {
+            if (isfinite(data[i])) {
+                low = min(low, data[i]);
+                high = max(high, data[i]);
+            }
+        }
+    }
+    
+    Histogram layout = Histogram::centeredCovering(low, high, binWidth);
+    return generateHistogram(layout.getLowerBound(), layout.getBinWidth(), layout.binCount());
+}
+
+Histogram DataManager::generateHistogram(double lowerBound, double binWidth, size_t binCount) const {
+    IOT_TIME_OPERATION(Histogram);
+    return histogramOver(valueData(), getMeasurementCount(), lowerBound, binWidth, binCount);
+}
+
+// Privat hjälpmetod: Histogram över en kolumn, med ett delhistogram per tråd
+Histogram DataManager::histogramOver(const double* data, size_t count, double lowerBound, double binWidth,
+                                     size_t binCount) const {
+    Histogram histogram(lowerBound, binWidth, binCount);
+    ThreadPool* pool = parallelPool(count);
+    
+    if (pool == nullptr) {
+        histogram.addRange(data, count);
+        return histogram;
+    }
     
-    for (const auto& m : measurements) {
-        int rounded = static_cast<int>(round(m.value));
-        histogram[rounded]++;
+    // Ett delhistogram per tråd i stället för per block, så att minnet inte
+    // växer med datamängden; räknarna är heltal och summan blir exakt
+    size_t chunks = ThreadPool::chunkCount(count, PARALLEL_CHUNK_SIZE);
+    size_t workers = min<size_t>(pool->size(), chunks);
+    vector<Histogram> parts(workers, histogram);
+    pool->run(workers, [&](size_t worker) {
+        for (size_t chunk = worker; chunk < chunks; chunk += workers) {
+            size_t begin = chunk * PARALLEL_CHUNK_SIZE;
+            parts[worker].addRange(data + begin, min(count, begin + PARALLEL_CHUNK_SIZE) - begin);
+        }
+    });
+    for (const Histogram& part : parts) {
+        histogram.merge(part);
     }
     
     return histogram;
 }
 
+void DataManager::enableLiveHistogram(double lowerBound, double binWidth, size_t binCount) {
+    liveHistogram = generateHistogram(lowerBound, binWidth, binCount);
+    liveHistogramEnabled = true;
+}
+
+void DataManager::disableLiveHistogram() {
+    liveHistogram = Histogram();
+    liveHistogramEnabled = false;
+}
+
+bool DataManager::isLiveHistogramEnabled() const {
+    return liveHistogramEnabled;
+}
+
+const Histogram& DataManager::getLiveHistogram() const {
+    return liveHistogram;
+}
+
 // NY FUNKTION: Spara till fil
 bool DataManager::saveToFile(const string& filename) const {
-    ofstream file(filename);
+    // Binärt format väljs utifrån filändelsen
+    auto hasExtension = [&filename](const string& extension) {
+        return filename.size() > extension.size() &&
+               filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+    };
+    // Alla sensorer lästes som en serie; filen får bara värdena
+    if (mergedSensors) {
+        cerr << "Warning: The loaded file had a sensor column; " << filename
+             << " gets all sensors as one series without it" << endl;
+    }
+    if (hasExtension(SNAPSHOT_EXTENSION)) return saveSnapshot(filename);
+    if (hasExtension(ARCHIVE_EXTENSION)) return saveArchive(filename);
     
-    if (!file.is_open()) {
+    // Skriv till en temporär fil som ersätter målet först när allt är skrivet;
+    // "-" betyder standard ut
+    IOT_TIME_OPERATION(SaveCsv);
+    CsvWriter writer;
+    writer.setTimeMode(timeMode);
+    if (filename == STANDARD_STREAM) {
+        writer.attach(stdout);
+    } else if (!writer.open(filename)) {
         cerr << "Error: Could not open file for writing: " << filename << endl;
         return false;
     }
     
-    // Skriv header
-    file << "timestamp,value" << endl;
+    // Skriv header och alla mätvärden
+    writer.writeHeader();
+    writer.writeRows(valueData(), timestampData(), getMeasurementCount());
     
-    // Skriv alla mätvärden
-    for (const auto& m : measurements) {
-        file << m.toFileString() << endl;
+    if (!writer.close()) {
+        cerr << "Error: Could not write file: " << filename << endl;
+        return false;
     }
-    
-    file.close();
     return true;
 }
 
 // NY FUNKTION: Ladda från fil
 bool DataManager::loadFromFile(const string& filename) {
-    ifstream file(filename);
+    // Binära snapshots känns igen på sin header
+    if (filename != STANDARD_STREAM && isSnapshotFile(filename)) {
+        return loadSnapshot(filename);
+    }
+    if (filename != STANDARD_STREAM && isArchiveFile(filename)) {
+        return loadArchive(filename);
+    }
     
-    if (!file.is_open()) {
-        cerr << "Error: Could not open file for reading: " << filename << endl;
-        return false;
+    CsvReader reader;
+    reader.setTimeMode(timeMode);
+    CsvLoadReport& report = lastLoadReport;
+    report = CsvLoadReport();
+    
+    // Öppna filen innan befintliga mätvärden rensas, så att ett felaktigt
+    // filnamn inte tömmer lagret
+    FILE* file = stdin;
+    if (filename != STANDARD_STREAM) {
+        file = fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            cerr << "Error: Could not open file for reading: " << filename << endl;
+            report.failed = true;
+            return false;
+        }
     }
+    clearAllMeasurements();
     
-    // Rensa befintliga mätvärden
-    measurements.clear();
-    
-    string line;
-    getline(file, line); // Läs bort header
-    
-    int loadedCount = 0;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        
-        stringstream ss(line);
-        string timestampStr, valueStr;
-        
-        // Försök att läsa kommaseparerade värden
-        if (getline(ss, timestampStr, ',') && getline(ss, valueStr)) {
-            try {
-                // Konvertera sträng till time_point
-                tm tm = {};
-                stringstream tsStream(timestampStr);
-                tsStream >> get_time(&tm, "%Y-%m-%d %H:%M:%S");
-                
-                if (tsStream.fail()) {
-                    // Försök med alternativt format
-                    tsStream.clear();
-                    tsStream.str(timestampStr);
-                    tsStream >> get_time(&tm, "%Y-%m-%d %H:%M");
-                }
-                
-                time_t time = mktime(&tm);
-                chrono::system_clock::time_point tp = chrono::system_clock::from_time_t(time);
-                
-                // Konvertera värde
-                double value = stod(valueStr);
-                
-                // Skapa och lägg till mätvärde
-                Measurement m;
-                m.value = value;
-                m.timestamp = tp;
-                measurements.push_back(m);
-                loadedCount++;
-                
-            } catch (const exception& e) {
-                cerr << "Warning: Could not parse line: " << line << endl;
-                cerr << "Error: " << e.what() << endl;
-            }
+    if (file != stdin && threadPool && threadPool->size() > 1) {
+        // Varje tråd parsar sin del av filen med en egen ström; små filer blir en enda del
+        fclose(file);
+        vector<CsvChunk> chunks;
+        if (!reader.readFileParallel(filename, *threadPool, chunks, report)) {
+            cerr << "Error: Could not open file for reading: " << filename << endl;
+            report.failed = true;
+            return false;
         }
+        appendChunks(chunks);
+    } else {
+        reader.readStream(file, [this](const double* batchValues, const int64_t* batchTimestamps, size_t count) {
+            appendBatch(batchValues, batchTimestamps, count);
+        }, report);
+        if (file != stdin) fclose(file);
     }
+    mergedSensors = report.sensorColumn;
+    
+    // Rapportera parsningsfel en gång i stället för per rad
+    if (report.parseErrors > 0) {
+        cerr << "Warning: Skipped " << report.parseErrors << " unparseable line(s) in "
+             << filename << " (first at line " << report.firstErrorLine << ": "
+             << report.firstErrorText << ")" << endl;
+    }
+    
+    return report.rowsLoaded > 0;
+}
+
+// Spara en binär snapshot av kolumnerna och aggregaten
+bool DataManager::saveSnapshot(const string& filename) const {
+    IOT_TIME_OPERATION(SaveSnapshot);
+    if (!writeSnapshot(filename, valueData(), timestampData(), getMeasurementCount(), runningStats,
+                       &syncedRollups())) {
+        cerr << "Error: Could not write snapshot: " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// Skriv kolumnerna som komprimerade block
+bool DataManager::saveArchive(const string& filename) const {
+    IOT_TIME_OPERATION(SaveArchive);
+    ArchiveWriter writer;
+    string error;
+    if (!writer.create(filename, error) ||
+        !writer.writeBlock(valueData(), timestampData(), getMeasurementCount()) || !writer.close()) {
+        cerr << "Error: Could not write archive " << filename << (error.empty() ? "" : ": " + error) << endl;
+        return false;
+    }
+    return true;
+}
+
+// Läs ett arkiv block för block
+bool DataManager::loadArchive(const string& filename) {
+    IOT_TIME_OPERATION(LoadArchive);
+    lastLoadReport = CsvLoadReport();
+    string error;
+    uint64_t skippedBytes = 0;
+    // Lagret rensas först när arkivets header har godkänts
+    bool cleared = false;
+    bool opened = readArchive(filename,
+        [this, &cleared](const double* batchValues, const int64_t* batchTimestamps, size_t count) {
+            if (!cleared) {
+                clearAllMeasurements();
+                cleared = true;
+            }
+            appendBatch(batchValues, batchTimestamps, count);
+        },
+        error, skippedBytes);
+    if (!opened) {
+        cerr << "Error: Could not load archive " << filename << ": " << error << endl;
+        lastLoadReport.failed = true;
+        return false;
+    }
+    if (!cleared) clearAllMeasurements();
+    if (skippedBytes > 0) {
+        cerr << "Warning: Skipped " << skippedBytes << " byte(s) of incomplete or corrupt data at the end of "
+             << filename << endl;
+    }
+    lastLoadReport.rowsLoaded = getMeasurementCount();
+    return getMeasurementCount() > 0;
+}
+
+const CsvLoadReport& DataManager::getLastLoadReport() const {
+    return lastLoadReport;
+}
+
+void DataManager::setTimeMode(TimeMode mode) {
+    timeMode = mode;
+}
+
+TimeMode DataManager::getTimeMode() const {
+    return timeMode;
+}
+
+// Mappa en binär snapshot utan att kopiera kolumnerna
+bool DataManager::loadSnapshot(const string& filename) {
+    IOT_TIME_OPERATION(LoadSnapshot);
+    string error;
+    shared_ptr<const MappedSnapshot> mapped = MappedSnapshot::open(filename, error);
+    if (!mapped) {
+        cerr << "Error: Could not load snapshot " << filename << ": " << error << endl;
+        lastLoadReport = CsvLoadReport();
+        lastLoadReport.failed = true;
+        return false;
+    }
+    
+    clearAllMeasurements();
+    snapshot = mapped;
+    runningStats = snapshot->summary();
+    quantileSketchStale = true;
+    rollupsStale = true;
+    if (liveHistogramEnabled) liveHistogram.addRange(valueData(), snapshot->size());
     
-    file.close();
-    cout << "Loaded " << loadedCount << " measurements from " << filename << endl;
-    return loadedCount > 0;
+    lastLoadReport = CsvLoadReport();
+    lastLoadReport.rowsLoaded = snapshot->size();
+    return snapshot->size() > 0;
 }
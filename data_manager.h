@@ -1,20 +1,119 @@
 #ifndef DATA_MANAGER_H
 #define DATA_MANAGER_H
 
+#include "histogram.h"
+#include "csv_reader.h"
+#include "downsample.h"
 #include "measurement.h"
+#include "measurement_view.h"
+#include "quantile.h"
+#include "rollup.h"
+#include "sensor_simulator.h"
+#include "sliding_window.h"
+#include "snapshot.h"
+#include "stats_kernel.h"
+#include "thread_pool.h"
+#include "time_codec.h"
+#include "time_index.h"
+#include "value_index.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
-#include <map>
 
 // Klass för att hantera alla mätvärden och deras analys
 // Jag valde klass för att kapsla in komplex logik och datamanipulation
 class DataManager {
+public:
+    // Ordningen mätvärdena visas i; lagret är alltid i ankomstordning
+    enum class DisplayOrder {
+        Time,
+        ValueAscending,
+        ValueDescending
+    };
+    typedef std::chrono::system_clock::time_point TimePoint;
+    
 private:
-    std::vector<Measurement> measurements;  // Alla sparade mätvärden
+    // Kolumnlagring: värden och tidsstämplar i separata, täta vektorer
+    // så att analyser som bara läser värden inte drar in tidsstämplarna
+    std::vector<double> values;             // Alla sparade mätvärden
+    std::vector<std::int64_t> timestamps;   // Nanosekunder sedan epoch
+    
+    // En skrivskyddat mappad snapshot. Analyser läser direkt från de mappade
+    // sidorna; kolumnerna kopieras in i vektorerna först vid en ändring.
+    std::shared_ptr<const MappedSnapshot> snapshot;
+    
+    // Löpande aggregat som uppdateras vid varje tillägg, så att
+    // statistikfrågor besvaras i O(1) utan att läsa om datan
+    RunningStats runningStats;
+    
+    // Kvantilskiss som uppdateras tillsammans med de löpande aggregaten.
+    // Efter en snapshot-laddning byggs den först när den efterfrågas, så
+    // att laddningen förblir O(1).
+    mutable KllSketch quantileSketch;
+    mutable bool quantileSketchStale;
+    
+    // Minut-, tim- och dygnsaggregat som uppdateras vid varje tillägg.
+    // Efter en snapshot-laddning kopieras de från snapshoten (eller byggs
+    // om) först när de efterfrågas.
+    mutable Rollups rollups;
+    mutable bool rollupsStale;
+    
+    // Tidsindex för intervallfrågor; synkas med nya rader vid varje fråga
+    mutable TimeIndex timeIndex;
+    
+    // Arbetsyta för glidande fönster, återanvänds mellan anrop
+    mutable SlidingWindowEngine windowEngine;
+    
+    // Trådpool för parallella svep; delas mellan kopior av objektet
+    std::shared_ptr<ThreadPool> threadPool;
+    size_t parallelCutoff;   // Mindre datamängder körs alltid seriellt
+    
+    // Valfritt värdeindex, byggs först när en fråga behöver det
+    mutable ValueIndex valueIndex;
+    bool valueIndexEnabled;
+    
+    // Valfritt histogram som hålls uppdaterat vid varje tillägg
+    Histogram liveHistogram;
+    bool liveHistogramEnabled;
+    
+    CsvLoadReport lastLoadReport;
+    bool mergedSensors;   // Inläst CSV hade en sensorkolumn som inte sparas
+    TimeMode timeMode;   // Tidsformat i CSV-filer
+    DisplayOrder displayOrder;   // Se sortMeasurementsAscending
+    
+    // Kolumnerna för ett tidsintervall i tidsordning. Pekar direkt in i
+    // lagret när det är tidsordnat; annars kopieras raderna till buffertarna.
+    struct RangeColumns {
+        const double* values;
+        const std::int64_t* timestamps;
+        size_t count;
+        TimeRange rows;
+    };
     
     // Privata hjälpmetoder
-    double calculateMean() const;
-    double calculateVariance(double mean) const;
+    const double* valueData() const;
+    const std::int64_t* timestampData() const;
+    void detachSnapshot();
+    const ValueIndex& syncedValueIndex(bool merged) const;
+    const TimeIndex& syncedTimeIndex() const;
+    RangeColumns timeRangeColumns(std::int64_t startNs, std::int64_t endNs, std::vector<double>& valueBuffer,
+                                  std::vector<std::int64_t>& timestampBuffer) const;
+    RunningStats summarizeRows(const TimeRange& rows) const;
+    size_t movingWindowOver(const double* data, size_t count, size_t windowSize, WindowAggregate aggregate,
+                            double* out) const;
+    size_t movingWindowOverTime(const double* data, const std::int64_t* times, size_t count,
+                                std::int64_t durationNs, WindowAggregate aggregate, double* out) const;
+    Histogram histogramOver(const double* data, size_t count, double lowerBound, double binWidth,
+                            size_t binCount) const;
+    ThreadPool* parallelPool(size_t count) const;
+    RunningStats summarizeAll() const;
+    void appendChunks(std::vector<CsvChunk>& chunks);
+    void finishBulkAppend(size_t start, const std::vector<RunningStats>& parts, const std::vector<size_t>& offsets);
+    const KllSketch& syncedQuantileSketch() const;
+    const Rollups& syncedRollups() const;
+    RunningStats summarizeTimeRange(std::int64_t startNs, std::int64_t endNs) const;
     
 public:
     // Konstruktor och destruktor
@@ -23,17 +122,50 @@ public:
     
     // Grundläggande operationer
     void addMeasurement(double value);
+    void addMeasurement(double value, std::chrono::system_clock::time_point timestamp);
+    // Lägg till count värden med tidsstämplar i nanosekunder sedan epoch
+    void appendBatch(const double* batchValues, const std::int64_t* batchTimestamps, size_t count);
     void clearAllMeasurements();
     size_t getMeasurementCount() const;
     
-    // Filhantering - ny funktionalitet för inlämning 2
+    // Filhantering - ny funktionalitet för inlämning 2.
+    // Filnamnet STANDARD_STREAM ("-") läser CSV från stdin / skriver till stdout.
+    // Inget skrivs till cout; fel och varningar går till cerr.
+    static const char* const STANDARD_STREAM;
     bool saveToFile(const std::string& filename) const;
     bool loadFromFile(const std::string& filename);
+    // Sammanställning av senaste loadFromFile (rader och parsningsfel)
+    const CsvLoadReport& getLastLoadReport() const;
+    // Tidsformat för CSV: lokal tid (standard), UTC eller epoch-sekunder.
+    // Vid inläsning accepteras epoch-sekunder i alla lägen.
+    void setTimeMode(TimeMode mode);
+    TimeMode getTimeMode() const;
+    
+    // Binär snapshot (se snapshot.h). saveToFile/loadFromFile använder
+    // formatet automatiskt för filer som slutar på SNAPSHOT_EXTENSION
+    // respektive börjar med snapshot-headern.
+    static const char* const SNAPSHOT_EXTENSION;
+    bool saveSnapshot(const std::string& filename) const;
+    bool loadSnapshot(const std::string& filename);
+    // Komprimerat arkiv (se archive.h). saveToFile/loadFromFile använder
+    // formatet för filer som slutar på ARCHIVE_EXTENSION respektive börjar
+    // med arkivheadern.
+    bool saveArchive(const std::string& filename) const;
+    bool loadArchive(const std::string& filename);
     
     // Avancerade funktioner från inlämning 1
     void simulateSensorData(int count);
-    std::vector<double> getAllValues() const;
-    std::vector<Measurement> getAllMeasurements() const;
+    // Lägg till count simulerade rader enligt profilen (se sensor_simulator.h).
+    // Lagringen växer en gång och blocken fylls parallellt på sina platser.
+    void simulate(const SimulationProfile& profile, size_t count);
+    
+    // Läsning utan kopiering. Vyerna pekar direkt in i lagret (eller den
+    // mappade snapshoten) och blir ogiltiga när datan ändras.
+    ValueSpan getAllValues() const;
+    MeasurementView getAllMeasurements() const;
+    MeasurementView measurementsView() const;
+    // Ett enskilt mätvärde; index måste vara mindre än getMeasurementCount()
+    Measurement getMeasurement(size_t index) const;
     
     // Statistikberäkningar
     struct Statistics {
@@ -44,30 +176,125 @@ public:
         double max;
         double variance;
         double standardDeviation;
-        int minIndex;
-        int maxIndex;
+        // Radnummer för min och max; NO_INDEX när det saknas
+        size_t minIndex;
+        size_t maxIndex;
+        
+        static const size_t NO_INDEX = static_cast<size_t>(-1);
         
         // Konstruktor för att initiera värden
         Statistics() : count(0), sum(0), mean(0), min(0), max(0), 
-                      variance(0), standardDeviation(0), minIndex(-1), maxIndex(-1) {}
+                      variance(0), standardDeviation(0), minIndex(NO_INDEX), maxIndex(NO_INDEX) {}
     };
     
+    // O(1): läses från de löpande aggregaten
     Statistics calculateStatistics() const;
     
+    // Fullständig omräkning genom att läsa all data (parallellt om påslaget)
+    Statistics scanStatistics() const;
+    
+    // Parallell körning: antal trådar (1 = seriellt, 0 = alla kärnor) och
+    // minsta antal mätvärden för att dela upp ett svep på flera trådar.
+    // Resultaten slås ihop i blockordning och är oberoende av antalet trådar.
+    void setThreadCount(unsigned threads);
+    unsigned getThreadCount() const;
+    void setParallelCutoff(size_t minimumCount);
+    
+    // Sammanslagning av delresultat, t.ex. från shards eller parallella producenter
+    const RunningStats& getRunningStats() const;
+    static Statistics toStatistics(const RunningStats& summary);
+    void appendMeasurements(const DataManager& other);
+    
+    // Kvantiler. Exakta värden beräknas på en arbetskopia och ändrar inte
+    // ordningen på mätvärdena; uppskattningen kommer från KLL-skissen (se
+    // quantile.h för felgränser) och kostar inget svep över datan.
+    double exactQuantile(double q) const;
+    std::vector<double> exactQuantiles(const std::vector<double>& qs) const;
+    double estimateQuantile(double q) const;
+    const KllSketch& getQuantileSketch() const;
+    
+    // Tidsintervall [start, end). Raderna hittas med tidsindexet i
+    // O(log n) (se time_index.h) och bara de raderna läses, i tidsordning
+    // även om de lagts till i en annan ordning.
+    size_t countInTimeRange(TimePoint start, TimePoint end) const;
+    // Raderna i intervallet i tidsordning
+    MeasurementSelection findInTimeRange(TimePoint start, TimePoint end) const;
+    MeasurementSelection findAboveThreshold(double threshold, TimePoint start, TimePoint end) const;
+    MeasurementSelection findBelowThreshold(double threshold, TimePoint start, TimePoint end) const;
+    // Det mesta av intervallet täcks av färdiga minut-, tim- och
+    // dygnsaggregat; bara de ofullständiga minuterna i kanterna läses ur
+    // rådata. Index i resultatet är radnummer.
+    Statistics calculateRangeStatistics(TimePoint start, TimePoint end) const;
+    std::vector<double> exactQuantiles(const std::vector<double>& qs, TimePoint start, TimePoint end) const;
+    // Som motsvarande metoder nedan men över intervallets rader; out måste
+    // rymma SlidingWindowEngine::outputCount(countInTimeRange(...), windowSize)
+    // respektive countInTimeRange(...) värden
+    size_t calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, TimePoint start, TimePoint end,
+                                 double* out) const;
+    size_t calculateMovingWindow(std::chrono::nanoseconds duration, WindowAggregate aggregate,
+                                 TimePoint start, TimePoint end, double* out) const;
+    Histogram generateHistogram(double binWidth, TimePoint start, TimePoint end) const;
+    Histogram generateHistogram(double lowerBound, double binWidth, size_t binCount,
+                                TimePoint start, TimePoint end) const;
+    const Rollups& getRollups() const;
+    
+    // Radindex i tidsordning för att rita serien med ungefär targetPoints
+    // punkter; MinMax ger upp till två punkter per fack (se downsample.h)
+    std::vector<size_t> downsample(size_t targetPoints, DownsampleMethod method) const;
+    
     // Sök- och filterfunktioner
-    std::vector<int> findValue(double target, double tolerance = 0.001) const;
-    std::vector<Measurement> findAboveThreshold(double threshold) const;
-    std::vector<Measurement> findBelowThreshold(double threshold) const;
+    // Radindex i stigande ordning
+    std::vector<size_t> findValue(double target, double tolerance = 0.001) const;
+    MeasurementSelection findAboveThreshold(double threshold) const;
+    MeasurementSelection findBelowThreshold(double threshold) const;
     
-    // Sorteringsfunktioner
+    // Värdeindex: gör tröskel- och intervallfrågor till binärsökningar.
+    // Utan index används linjär sökning för räknefrågorna; frågorna som
+    // returnerar IndexSpan bygger alltid indexet. En IndexSpan är ordnad
+    // efter värde och gäller tills datan ändras.
+    void setValueIndexEnabled(bool enabled);
+    bool isValueIndexEnabled() const;
+    size_t countAboveThreshold(double threshold) const;   // värde >  threshold
+    size_t countBelowThreshold(double threshold) const;   // värde <= threshold
+    size_t countInRange(double low, double high) const;   // low <= värde <= high
+    IndexSpan indicesAboveThreshold(double threshold) const;
+    IndexSpan indicesBelowThreshold(double threshold) const;
+    IndexSpan indicesInRange(double low, double high) const;
+    
+    // Sortering efter värde ändrar bara visningsordningen. Lagret behåller
+    // ankomstordningen så att tidsintervall, glidande fönster och rollups
+    // fortsätter att gälla; själva sorteringen görs i värdeindexet.
     void sortMeasurementsAscending();
     void sortMeasurementsDescending();
+    void setDisplayOrder(DisplayOrder order);
+    DisplayOrder getDisplayOrder() const;
+    // Alla mätvärden i visningsordning
+    MeasurementSelection measurementsInDisplayOrder() const;
     
     // Glidande medelvärde
     std::vector<double> calculateMovingAverage(int windowSize) const;
     
-    // Histogramgenerering
-    std::map<int, int> generateHistogram() const;
+    // Glidande fönster i O(n) för valfri fönsterstorlek. Resultatet skrivs
+    // till anroparens buffert som måste rymma movingWindowOutputCount()
+    // värden (räknebaserat) respektive getMeasurementCount() värden (tidsbaserat).
+    // Det räknebaserade fönstret följer lagrets ordning, det tidsbaserade
+    // tidsordningen (samma sak så länge mätvärdena kommit i tidsordning).
+    size_t movingWindowOutputCount(size_t windowSize) const;
+    size_t calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, double* out) const;
+    size_t calculateMovingWindow(std::chrono::nanoseconds duration, WindowAggregate aggregate,
+                                 double* out) const;
+    
+    // Histogramgenerering i ett svep utan allokering per värde. Utan
+    // intervall täcker facken hela värdeintervallet och är centrerade på
+    // multiplar av binWidth (1.0 ger ett fack per hel grad).
+    Histogram generateHistogram(double binWidth = 1.0) const;
+    Histogram generateHistogram(double lowerBound, double binWidth, size_t binCount) const;
+    
+    // Löpande histogram med fast facklayout, uppdateras vid varje tillägg
+    void enableLiveHistogram(double lowerBound, double binWidth, size_t binCount);
+    void disableLiveHistogram();
+    bool isLiveHistogramEnabled() const;
+    const Histogram& getLiveHistogram() const;
 };
 
 #endif // DATA_MANAGER_H
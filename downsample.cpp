@@ -0,0 +1,111 @@
+#include "downsample.h"
+#include <cmath>
+#include <numeric>
+
+using namespace std;
+
+const char* downsampleMethodName(DownsampleMethod method) {
+    switch (method) {
+        case DownsampleMethod::MinMax: return "minmax";
+        case DownsampleMethod::Lttb: return "lttb";
+    }
+    return "minmax";
+}
+
+bool parseDownsampleMethod(const string& name, DownsampleMethod& method) {
+    if (name == "minmax") {
+        method = DownsampleMethod::MinMax;
+    } else if (name == "lttb") {
+        method = DownsampleMethod::Lttb;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+vector<size_t> downsampleMinMax(const double* values, size_t count, size_t buckets) {
+    vector<size_t> selected;
+    if (count == 0 || buckets == 0) {
+        return selected;
+    }
+    if (count <= 2 * buckets) {
+        selected.resize(count);
+        iota(selected.begin(), selected.end(), size_t(0));
+        return selected;
+    }
+    
+    selected.reserve(2 * buckets);
+    for (size_t bucket = 0; bucket < buckets; ++bucket) {
+        size_t begin = bucket * count / buckets;
+        size_t end = (bucket + 1) * count / buckets;
+        size_t low = begin, high = begin;
+        for (size_t i = begin; i < end; ++i) {
+            if (isnan(values[low]) || values[i] < values[low]) low = i;
+            if (isnan(values[high]) || values[i] > values[high]) high = i;
+        }
+        // Raderna i tidsordning så att linjen ritas åt rätt håll
+        if (low == high) {
+            selected.push_back(low);
+        } else {
+            selected.push_back(low < high ? low : high);
+            selected.push_back(low < high ? high : low);
+        }
+    }
+    return selected;
+}
+
+vector<size_t> downsampleLttb(const double* values, const int64_t* timestamps, size_t count,
+                              size_t targetPoints) {
+    vector<size_t> selected;
+    if (targetPoints >= count || targetPoints < 3) {
+        if (targetPoints >= count) {
+            selected.resize(count);
+            iota(selected.begin(), selected.end(), size_t(0));
+        } else if (targetPoints > 0) {
+            selected.push_back(0);
+            if (targetPoints == 2) selected.push_back(count - 1);
+        }
+        return selected;
+    }
+    
+    // x räknas i sekunder från första raden för att behålla precisionen
+    auto x = [timestamps](size_t i) { return (timestamps[i] - timestamps[0]) * 1e-9; };
+    
+    // Första och sista raden är fasta; resten delas i targetPoints - 2 fack
+    selected.reserve(targetPoints);
+    selected.push_back(0);
+    double bucketSize = static_cast<double>(count - 2) / (targetPoints - 2);
+    size_t previous = 0;
+    for (size_t bucket = 0; bucket < targetPoints - 2; ++bucket) {
+        size_t begin = static_cast<size_t>(bucket * bucketSize) + 1;
+        size_t end = static_cast<size_t>((bucket + 1) * bucketSize) + 1;
+        
+        // Medelpunkten i nästa fack är triangelns tredje hörn
+        size_t nextBegin = end;
+        size_t nextEnd = min(static_cast<size_t>((bucket + 2) * bucketSize) + 1, count);
+        double averageX = 0, averageY = 0;
+        for (size_t i = nextBegin; i < nextEnd; ++i) {
+            averageX += x(i);
+            averageY += values[i];
+        }
+        averageX /= nextEnd - nextBegin;
+        averageY /= nextEnd - nextBegin;
+        
+        // Behåll punkten som spänner upp den största triangeln
+        double previousX = x(previous), previousY = values[previous];
+        double largestArea = -1;
+        size_t chosen = begin;
+        for (size_t i = begin; i < end; ++i) {
+            double area = abs((previousX - averageX) * (values[i] - previousY) -
+                              (previousX - x(i)) * (averageY - previousY));
+            if (area > largestArea) {
+                largestArea = area;
+                chosen = i;
+            }
+        }
+        selected.push_back(chosen);
+        previous = chosen;
+    }
+    selected.push_back(count - 1);
+    return selected;
+}
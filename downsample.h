@@ -0,0 +1,29 @@
+#ifndef DOWNSAMPLE_H
+#define DOWNSAMPLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Nedsampling av långa serier inför utritning. Båda metoderna väljer ut
+// befintliga rader och returnerar deras index i stigande ordning, så att
+// anroparen kan läsa värde och tid direkt ur kolumnerna.
+enum class DownsampleMethod {
+    MinMax,   // Minsta och största värdet per fack; toppar försvinner aldrig
+    Lttb      // Largest-Triangle-Three-Buckets (Steinarsson 2013); bevarar formen
+};
+
+const char* downsampleMethodName(DownsampleMethod method);
+bool parseDownsampleMethod(const std::string& name, DownsampleMethod& method);
+
+// Dela raderna i buckets lika stora fack och behåll min- och maxraden i
+// varje fack (högst 2 * buckets index). NaN hoppas över.
+std::vector<size_t> downsampleMinMax(const double* values, size_t count, size_t buckets);
+
+// Välj targetPoints rader med LTTB. Tidsstämplarna används som x-axel,
+// så ojämnt samplade serier ritas rätt. Första och sista raden ingår alltid.
+std::vector<size_t> downsampleLttb(const double* values, const std::int64_t* timestamps, size_t count,
+                                   size_t targetPoints);
+
+#endif // DOWNSAMPLE_H
@@ -0,0 +1,113 @@
+#include "histogram.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Antal värden vars fack beräknas innan räknarna uppdateras
+const size_t BLOCK_SIZE = 256;
+
+} // namespace
+
+Histogram::Histogram() : Histogram(0.0, 1.0, 0) {
+}
+
+Histogram::Histogram(double lowerBound, double binWidth, size_t binCount)
+    : lowerBound(lowerBound), binWidth(binWidth > 0 ? binWidth : 1.0),
+      inverseWidth(1.0 / this->binWidth), bins(min(binCount, HISTOGRAM_MAX_BINS)),
+      slots(bins + 3, 0) {
+}
+
+Histogram Histogram::centeredCovering(double minValue, double maxValue, double binWidth) {
+    if (!(binWidth > 0)) binWidth = 1.0;
+    if (!(minValue <= maxValue) || !isfinite(minValue) || !isfinite(maxValue)) {
+        return Histogram(0.0, binWidth, 0);
+    }
+    // Fack k täcker [(k - 0.5) * w, (k + 0.5) * w), dvs. värdet avrundat till närmaste multipel
+    double first = floor(minValue / binWidth + 0.5);
+    double last = floor(maxValue / binWidth + 0.5);
+    double binCount = last - first + 1;
+    const double maxBins = static_cast<double>(HISTOGRAM_MAX_BINS);
+    if (!(binCount <= maxBins)) {
+        // Bredda facken med en heltalsfaktor tills intervallet ryms
+        double width = binWidth * ceil(binCount / maxBins);
+        while (isfinite(width)) {
+            first = floor(minValue / width + 0.5);
+            last = floor(maxValue / width + 0.5);
+            binCount = last - first + 1;
+            if (binCount <= maxBins) break;
+            width *= 2;
+        }
+        if (!isfinite(width) || !isfinite((first - 0.5) * width) || !isfinite((last + 0.5) * width)) {
+            // Intervallet är nära gränsen för double; dela det jämnt i stället
+            width = (maxValue / maxBins - minValue / maxBins) * (1 + 1e-9);
+            return Histogram(minValue, width, HISTOGRAM_MAX_BINS);
+        }
+        binWidth = width;
+    }
+    return Histogram((first - 0.5) * binWidth, binWidth, static_cast<size_t>(binCount));
+}
+
+void Histogram::add(double value) {
+    double top = static_cast<double>(bins + 1);
+    double slot = (value - lowerBound) * inverseWidth + 1.0;
+    slot = slot > 0.0 ? slot : 0.0;
+    slot = slot < top ? slot : top;
+    ++slots[value == value ? static_cast<size_t>(slot) : bins + 2];
+}
+
+void Histogram::remove(double value) {
+    double top = static_cast<double>(bins + 1);
+    double slot = (value - lowerBound) * inverseWidth + 1.0;
+    slot = slot > 0.0 ? slot : 0.0;
+    slot = slot < top ? slot : top;
+    --slots[value == value ? static_cast<size_t>(slot) : bins + 2];
+}
+
+void Histogram::addRange(const double* data, size_t count) {
+    double top = static_cast<double>(bins + 1);
+    uint32_t nanSlot = static_cast<uint32_t>(bins + 2);
+    uint32_t index[BLOCK_SIZE];
+    uint64_t* counters = slots.data();
+
+    for (size_t start = 0; start < count; start += BLOCK_SIZE) {
+        size_t n = min(BLOCK_SIZE, count - start);
+        const double* block = data + start;
+
+        // Fackberäkningen är grenfri och kan vektoriseras av kompilatorn
+        for (size_t i = 0; i < n; ++i) {
+            double value = block[i];
+            double slot = (value - lowerBound) * inverseWidth + 1.0;
+            slot = slot > 0.0 ? slot : 0.0;
+            slot = slot < top ? slot : top;
+            index[i] = value == value ? static_cast<uint32_t>(slot) : nanSlot;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            ++counters[index[i]];
+        }
+    }
+}
+
+void Histogram::clear() {
+    fill(slots.begin(), slots.end(), 0);
+}
+
+bool Histogram::sameLayout(const Histogram& other) const {
+    return bins == other.bins && lowerBound == other.lowerBound && binWidth == other.binWidth;
+}
+
+bool Histogram::merge(const Histogram& other) {
+    if (!sameLayout(other)) return false;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        slots[i] += other.slots[i];
+    }
+    return true;
+}
+
+uint64_t Histogram::total() const {
+    uint64_t sum = 0;
+    for (uint64_t count : slots) sum += count;
+    return sum;
+}
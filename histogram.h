@@ -0,0 +1,59 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Största antal fack. Större begäranden kapas; värden utanför hamnar i
+// över- och underflödesfacken. centeredCovering breddar i stället facken.
+const size_t HISTOGRAM_MAX_BINS = 65536;
+
+// Histogram med fasta, lika breda fack i en platt räknarvektor.
+// Fack i täcker [lowerBound + i * binWidth, lowerBound + (i + 1) * binWidth).
+// Värden under eller över intervallet räknas i egna fack, NaN räknas separat.
+class Histogram {
+private:
+    double lowerBound;
+    double binWidth;
+    double inverseWidth;
+    size_t bins;
+    // [underflow, fack 0..bins-1, overflow, NaN]
+    std::vector<std::uint64_t> slots;
+
+public:
+    Histogram();
+    Histogram(double lowerBound, double binWidth, size_t binCount);
+
+    // Fack med bredden binWidth centrerade på multiplar av binWidth,
+    // tillräckligt många för att täcka [minValue, maxValue]. Skulle det
+    // krävas fler än HISTOGRAM_MAX_BINS fack breddas de till en multipel
+    // av binWidth, så att en enstaka extrem punkt inte kostar gigabyte.
+    static Histogram centeredCovering(double minValue, double maxValue, double binWidth);
+
+    void add(double value);
+    // Räkna bort ett värde som tidigare lagts till, t.ex. när det lämnar ett fönster
+    void remove(double value);
+    // Räknar in ett helt block; facken beräknas blockvis utan grenar
+    void addRange(const double* data, size_t count);
+    void clear();
+
+    // Slå ihop ett histogram med samma facklayout; false om layouten skiljer
+    bool merge(const Histogram& other);
+    bool sameLayout(const Histogram& other) const;
+
+    size_t binCount() const { return bins; }
+    double getLowerBound() const { return lowerBound; }
+    double getBinWidth() const { return binWidth; }
+    double binLower(size_t bin) const { return lowerBound + bin * binWidth; }
+    double binCenter(size_t bin) const { return lowerBound + (bin + 0.5) * binWidth; }
+    std::uint64_t binValue(size_t bin) const { return slots[bin + 1]; }
+
+    std::uint64_t underflowCount() const { return slots.front(); }
+    std::uint64_t overflowCount() const { return slots[bins + 1]; }
+    std::uint64_t nanCount() const { return slots.back(); }
+    std::uint64_t total() const;
+    bool empty() const { return total() == 0; }
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,164 @@
+#include "ingest_hub.h"
+#include "metrics.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Max antal värden som flyttas från en ring per varv
+const size_t DRAIN_BATCH = 4096;
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+} // namespace
+
+SpscRing::SpscRing(size_t capacity)
+    : slots(roundUpToPowerOfTwo(capacity)), mask(slots.size() - 1), head(0), tail(0), cachedHead(0) {
+}
+
+bool SpscRing::tryPush(const IngestSample& sample) {
+    size_t t = tail.load(memory_order_relaxed);
+    if (t - cachedHead == slots.size()) {
+        // Läs konsumentens position bara när ringen ser full ut
+        cachedHead = head.load(memory_order_acquire);
+        if (t - cachedHead == slots.size()) return false;
+    }
+    slots[t & mask] = sample;
+    tail.store(t + 1, memory_order_release);
+    return true;
+}
+
+size_t SpscRing::popBatch(IngestSample* out, size_t maxCount) {
+    size_t h = head.load(memory_order_relaxed);
+    size_t available = tail.load(memory_order_acquire) - h;
+    size_t count = min(available, maxCount);
+
+    // Kopiera i högst två sammanhängande delar
+    size_t first = min(count, slots.size() - (h & mask));
+    copy(slots.begin() + (h & mask), slots.begin() + (h & mask) + first, out);
+    copy(slots.begin(), slots.begin() + (count - first), out + first);
+
+    head.store(h + count, memory_order_release);
+    return count;
+}
+
+bool IngestProducer::tryAdd(double value, chrono::system_clock::time_point timestamp) {
+    return ring.tryPush(IngestSample{ value, toEpochNanoseconds(timestamp) });
+}
+
+void IngestProducer::add(double value, chrono::system_clock::time_point timestamp) {
+    IngestSample sample = { value, toEpochNanoseconds(timestamp) };
+    while (!ring.tryPush(sample)) {
+        this_thread::yield();
+    }
+}
+
+void IngestProducer::addOrDrop(double value, chrono::system_clock::time_point timestamp) {
+    if (!tryAdd(value, timestamp)) {
+        dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+IngestHub::IngestHub(DataManager& store, size_t ringCapacity)
+    : store(store), ringCapacity(ringCapacity), batch(DRAIN_BATCH),
+      batchValues(DRAIN_BATCH), batchTimestamps(DRAIN_BATCH),
+      published(store.getRunningStats()), running(false) {
+}
+
+IngestHub::~IngestHub() {
+    stop();
+}
+
+IngestProducer& IngestHub::registerProducer() {
+    lock_guard<mutex> lock(producerMutex);
+    producers.push_back(unique_ptr<IngestProducer>(new IngestProducer(ringCapacity)));
+    return *producers.back();
+}
+
+size_t IngestHub::drain() {
+    lock_guard<mutex> storeLock(storeMutex);
+    IOT_TIME_OPERATION(IngestDrain);
+
+    // Producentlistan växer bara; kopiera nya pekare så att ringarna
+    // kan tömmas utan att hålla registreringslåset
+    {
+        lock_guard<mutex> lock(producerMutex);
+        for (size_t p = drainList.size(); p < producers.size(); ++p) {
+            drainList.push_back(producers[p].get());
+        }
+    }
+
+    size_t moved = 0;
+    for (IngestProducer* producer : drainList) {
+        SpscRing& ring = producer->ring;
+        size_t count;
+        // Töm högst en ringkapacitet per varv så att en snabb producent
+        // inte svälter de andra
+        size_t budget = ring.capacity();
+        while (budget > 0 && (count = ring.popBatch(batch.data(), min(budget, DRAIN_BATCH))) > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                batchValues[i] = batch[i].value;
+                batchTimestamps[i] = batch[i].timestampNs;
+            }
+            store.appendBatch(batchValues.data(), batchTimestamps.data(), count);
+            moved += count;
+            budget -= count;
+        }
+    }
+
+    IOT_COUNT(MeasurementsIngested, moved);
+    if (moved > 0) {
+        lock_guard<mutex> lock(publishedMutex);
+        published = store.getRunningStats();
+    }
+    return moved;
+}
+
+void IngestHub::drainLoop() {
+    while (running.load(memory_order_acquire)) {
+        if (drain() == 0) {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+}
+
+void IngestHub::start() {
+    if (running.exchange(true)) return;
+    drainThread = thread(&IngestHub::drainLoop, this);
+}
+
+void IngestHub::stop() {
+    if (running.exchange(false)) {
+        drainThread.join();
+    }
+    while (drain() > 0) {
+    }
+}
+
+DataManager::Statistics IngestHub::snapshotStatistics() const {
+    RunningStats summary;
+    {
+        lock_guard<mutex> lock(publishedMutex);
+        summary = published;
+    }
+    return DataManager::toStatistics(summary);
+}
+
+void IngestHub::readStore(const function<void(const DataManager&)>& reader) const {
+    lock_guard<mutex> lock(storeMutex);
+    reader(store);
+}
+
+uint64_t IngestHub::droppedCount() {
+    lock_guard<mutex> lock(producerMutex);
+    uint64_t total = 0;
+    for (const auto& producer : producers) {
+        total += producer->droppedCount();
+    }
+    return total;
+}
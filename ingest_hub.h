@@ -0,0 +1,122 @@
+#ifndef INGEST_HUB_H
+#define INGEST_HUB_H
+
+#include "data_manager.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Ett mätvärde på väg in i lagret
+struct IngestSample {
+    double value;
+    std::int64_t timestampNs;  // Nanosekunder sedan epoch
+};
+
+// Låsfri ringbuffert för exakt en producent och en konsument
+class SpscRing {
+private:
+    std::vector<IngestSample> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;   // Nästa position att läsa (konsumenten)
+    alignas(64) std::atomic<size_t> tail;   // Nästa position att skriva (producenten)
+    alignas(64) size_t cachedHead;          // Producentens senast sedda head
+
+public:
+    // Kapaciteten avrundas upp till en tvåpotens
+    explicit SpscRing(size_t capacity);
+
+    // Producentsidan: false om bufferten är full
+    bool tryPush(const IngestSample& sample);
+
+    // Konsumentsidan: flytta upp till maxCount värden till out
+    size_t popBatch(IngestSample* out, size_t maxCount);
+
+    size_t capacity() const { return slots.size(); }
+};
+
+// Handtag för en producenttråd. Varje producent har en egen ringbuffert,
+// så producenter delar aldrig lås eller cachelinjer med varandra.
+class IngestProducer {
+private:
+    SpscRing ring;
+    std::atomic<std::uint64_t> dropped;
+
+    friend class IngestHub;
+
+public:
+    explicit IngestProducer(size_t capacity) : ring(capacity), dropped(0) {}
+
+    // Försök lägga till; false om ringen är full
+    bool tryAdd(double value, std::chrono::system_clock::time_point timestamp);
+
+    // Lägg till och vänta (yield) så länge ringen är full
+    void add(double value, std::chrono::system_clock::time_point timestamp);
+
+    // Lägg till, eller räkna värdet som tappat om ringen är full
+    void addOrDrop(double value, std::chrono::system_clock::time_point timestamp);
+
+    std::uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+// Samlar in mätvärden från många producenttrådar till en DataManager.
+// En tömningstråd (eller anropare av drain()) flyttar värden från ringarna
+// i batchar. Läsare får statistik från en publicerad ögonblicksbild och
+// blockerar aldrig producenterna.
+class IngestHub {
+private:
+    DataManager& store;
+    size_t ringCapacity;
+
+    std::mutex producerMutex;
+    std::deque<std::unique_ptr<IngestProducer>> producers;
+
+    // Lagret ändras bara under storeMutex
+    mutable std::mutex storeMutex;
+    std::vector<IngestProducer*> drainList;
+    std::vector<IngestSample> batch;
+    std::vector<double> batchValues;
+    std::vector<std::int64_t> batchTimestamps;
+
+    // Senast publicerade statistik
+    mutable std::mutex publishedMutex;
+    RunningStats published;
+
+    std::thread drainThread;
+    std::atomic<bool> running;
+
+    void drainLoop();
+
+public:
+    explicit IngestHub(DataManager& store, size_t ringCapacity = 1 << 16);
+    ~IngestHub();
+    IngestHub(const IngestHub&) = delete;
+    IngestHub& operator=(const IngestHub&) = delete;
+
+    // Registrera en ny producent; handtaget lever lika länge som hubben
+    IngestProducer& registerProducer();
+
+    // Töm alla ringar en gång; returnerar antal flyttade värden
+    size_t drain();
+
+    // Starta/stoppa en bakgrundstråd som tömmer ringarna kontinuerligt.
+    // stop() tömmer kvarvarande värden innan den returnerar.
+    void start();
+    void stop();
+
+    // Statistik från senaste publicerade ögonblicksbild (blockerar inte producenter)
+    DataManager::Statistics snapshotStatistics() const;
+
+    // Läs lagret konsekvent; tömningen väntar under tiden, producenterna gör det inte
+    void readStore(const std::function<void(const DataManager&)>& reader) const;
+
+    std::uint64_t droppedCount();
+};
+
+#endif // INGEST_HUB_H
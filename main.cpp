@@ -1,9 +1,16 @@
 #include "data_manager.h"
+#include "cli.h"
+#include "metrics.h"
+#include "time_codec.h"
 #include <iostream>
 #include <iomanip>
-#include <map>
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <limits>
+#include <chrono>
+#include <vector>
+#include <cmath>
 
 using namespace std;
 
@@ -22,42 +29,52 @@ void displayMenu() {
     cout << "10. Clear all measurements" << endl;
     cout << "11. Save to file" << endl;
     cout << "12. Load from file" << endl;
+    cout << "13. Show metrics" << endl;
+    cout << "14. Plot measurements" << endl;
+    cout << "15. Time range analysis" << endl;
     cout << "0. Exit program" << endl;
     cout << "Choice: ";
 }
 
-// Funktion för att visa statistik
-void displayStatistics(const DataManager::Statistics& stats, const DataManager& dm) {
+// Funktion för att visa statistik; percentiles är medianen, 95:e och 99:e percentilen
+void displayStatistics(const DataManager::Statistics& stats, const vector<double>& percentiles,
+                       const DataManager& dm) {
     if (stats.count == 0) {
         cout << "No measurements available for analysis." << endl;
         return;
     }
     
-    auto measurements = dm.getAllMeasurements();
+    // Bara de två raderna med min och max läses, inget kopieras
+    size_t count = dm.getMeasurementCount();
     
     cout << "\n=== STATISTICAL ANALYSIS ===" << endl;
     cout << "Count: " << stats.count << endl;
     cout << "Sum: " << fixed << setprecision(2) << stats.sum << endl;
     cout << "Mean: " << fixed << setprecision(2) << stats.mean << endl;
     cout << "Minimum: " << stats.min << " (Measurement #" << (stats.minIndex + 1);
-    if (stats.minIndex >= 0 && stats.minIndex < measurements.size()) {
-        cout << " at " << measurements[stats.minIndex].getTimeString();
+    if (stats.minIndex < count) {
+        cout << " at " << dm.getMeasurement(stats.minIndex).getTimeString();
     }
     cout << ")" << endl;
     
     cout << "Maximum: " << stats.max << " (Measurement #" << (stats.maxIndex + 1);
-    if (stats.maxIndex >= 0 && stats.maxIndex < measurements.size()) {
-        cout << " at " << measurements[stats.maxIndex].getTimeString();
+    if (stats.maxIndex < count) {
+        cout << " at " << dm.getMeasurement(stats.maxIndex).getTimeString();
     }
     cout << ")" << endl;
     
     cout << "Variance: " << fixed << setprecision(4) << stats.variance << endl;
     cout << "Standard Deviation: " << fixed << setprecision(4) << stats.standardDeviation << endl;
+    
+    cout << "Median: " << fixed << setprecision(2) << percentiles[0] << endl;
+    cout << "95th percentile: " << percentiles[1] << endl;
+    cout << "99th percentile: " << percentiles[2] << endl;
 }
 
 // Funktion för att visa histogram
 void displayHistogram(const DataManager& dm) {
-    auto histogram = dm.generateHistogram();
+    // Ett fack per hel grad, centrerat på heltalet
+    Histogram histogram = dm.generateHistogram(1.0);
     
     if (histogram.empty()) {
         cout << "No measurements available for visualization." << endl;
@@ -65,11 +82,9 @@ void displayHistogram(const DataManager& dm) {
     }
     
     // Hitta maxfrekvens för skalning
-    int maxFreq = 0;
-    for (const auto& pair : histogram) {
-        if (pair.second > maxFreq) {
-            maxFreq = pair.second;
-        }
+    uint64_t maxFreq = 0;
+    for (size_t bin = 0; bin < histogram.binCount(); ++bin) {
+        maxFreq = max(maxFreq, histogram.binValue(bin));
     }
     
     const int maxWidth = 50;
@@ -77,16 +92,112 @@ void displayHistogram(const DataManager& dm) {
     cout << "\n=== TEMPERATURE HISTOGRAM ===" << endl;
     cout << "Value Distribution:" << endl;
     
-    for (const auto& pair : histogram) {
-        cout << setw(3) << pair.first << "°C | ";
-        int barWidth = (pair.second * maxWidth) / maxFreq;
-        cout << string(barWidth, '*') << " (" << pair.second << ")" << endl;
+    // Visa bara fack med värden, som tidigare
+    for (size_t bin = 0; bin < histogram.binCount(); ++bin) {
+        uint64_t frequency = histogram.binValue(bin);
+        if (frequency == 0) continue;
+        cout << setw(3) << static_cast<long long>(llround(histogram.binCenter(bin))) << "°C | ";
+        size_t barWidth = maxFreq > 0 ? static_cast<size_t>(frequency * maxWidth / maxFreq) : 0;
+        cout << string(barWidth, '*') << " (" << frequency << ")" << endl;
+    }
+    
+    uint64_t outside = histogram.underflowCount() + histogram.overflowCount() + histogram.nanCount();
+    if (outside > 0) {
+        cout << "(" << outside << " measurement(s) outside the displayed range)" << endl;
     }
 }
 
+// Funktion för att rita serien som ett diagram i terminalen. Serien
+// nedsamplas först så att bara några hundra rader läses oavsett storlek;
+// x-axeln är tiden. Punkterna binds ihop till en linje och varje
+// kolumn visar linjens min-max inom kolumnen.
+void displayPlot(const DataManager& dm, DownsampleMethod method) {
+    const size_t width = 60;
+    const size_t height = 15;
+    size_t count = dm.getMeasurementCount();
+    if (count == 0) {
+        cout << "No measurements available for plotting." << endl;
+        return;
+    }
+    
+    MeasurementView view = dm.measurementsView();
+    const double* values = view.valueData();
+    const int64_t* timestamps = view.timestampData();
+    vector<size_t> rows = dm.downsample(2 * min(width, count), method);
+    // Raderna kommer i tidsordning; kolumnen bestäms av tidsstämpeln så att
+    // ordningen i lagret inte spelar roll
+    int64_t firstNs = timestamps[rows.front()];
+    int64_t lastNs = timestamps[rows.back()];
+    double span = static_cast<double>(lastNs - firstNs) + 1.0;
+    size_t columns = min(width, count);
+    auto columnOf = [&](size_t row) {
+        return min(columns - 1, static_cast<size_t>((timestamps[row] - firstNs) / span * columns));
+    };
+    vector<double> low(columns, numeric_limits<double>::infinity());
+    vector<double> high(columns, -numeric_limits<double>::infinity());
+    auto mark = [&](size_t column, double value) {
+        low[column] = min(low[column], value);
+        high[column] = max(high[column], value);
+    };
+    size_t previous = count;
+    for (size_t row : rows) {
+        if (!isfinite(values[row])) continue;
+        size_t column = columnOf(row);
+        mark(column, values[row]);
+        // Linjen från föregående punkt (i kolumnernas mitt) markeras där
+        // den korsar varje kolumngräns på vägen
+        size_t previousColumn = previous < count ? columnOf(previous) : column;
+        for (size_t edge = previousColumn + 1; edge <= column; ++edge) {
+            double fraction = (edge - previousColumn - 0.5) / (column - previousColumn);
+            double value = values[previous] + fraction * (values[row] - values[previous]);
+            mark(edge - 1, value);
+            mark(edge, value);
+        }
+        previous = row;
+    }
+    double bottom = *min_element(low.begin(), low.end());
+    double top = *max_element(high.begin(), high.end());
+    if (!isfinite(bottom) || !isfinite(top)) {
+        cout << "No finite measurements to plot." << endl;
+        return;
+    }
+    double step = top > bottom ? (top - bottom) / height : 1.0;
+    
+    cout << "\n=== MEASUREMENT PLOT (" << count << " measurements, "
+         << downsampleMethodName(method) << ") ===" << endl;
+    for (size_t line = height; line-- > 0; ) {
+        double lineLow = bottom + line * step;
+        double lineHigh = line + 1 == height ? top : lineLow + step;
+        if (line + 1 == height) cout << setw(8) << fixed << setprecision(2) << top << " |";
+        else if (line == 0) cout << setw(8) << fixed << setprecision(2) << bottom << " |";
+        else cout << string(9, ' ') << "|";
+        
+        string text(columns, ' ');
+        for (size_t column = 0; column < columns; ++column) {
+            bool inLine = high[column] >= lineLow && (low[column] < lineHigh || line + 1 == height);
+            if (inLine) text[column] = low[column] == high[column] ? '*' : '|';
+        }
+        cout << text << '\n';
+    }
+    cout << string(9, ' ') << "+" << string(columns, '-') << '\n';
+    
+    TimeCodec codec(dm.getTimeMode());
+    string first = codec.format(firstNs);
+    string last = codec.format(lastNs);
+    size_t gap = columns + 1 > first.size() + last.size() ? columns + 1 - first.size() - last.size() : 1;
+    cout << string(9, ' ') << first << string(gap, ' ') << last << endl;
+}
+
 // Huvudfunktion
-int main() {
+int main(int argc, char* argv[]) {
+    // Med argument körs kommandoradsläget (se cli.h) utan meny och utan automatisk sparning
+    if (isCommandLineInvocation(argc, argv)) {
+        return runCommandLine(argc, argv);
+    }
+    
     DataManager dataManager;
+    dataManager.setValueIndexEnabled(true);
+    dataManager.setThreadCount(0);  // Använd alla kärnor för stora datamängder
     int choice;
     
     cout << "=== IoT MEASUREMENT ANALYZER ===" << endl;
@@ -156,8 +267,9 @@ int main() {
             
             case 3: {
                 // Visa statistik
+                // Percentiler beräknas på en kopia så att tidsordningen behålls
                 auto stats = dataManager.calculateStatistics();
-                displayStatistics(stats, dataManager);
+                displayStatistics(stats, dataManager.exactQuantiles({ 0.5, 0.95, 0.99 }), dataManager);
                 break;
             }
             
@@ -202,13 +314,15 @@ int main() {
                     cin.ignore(numeric_limits<streamsize>::max(), '\n');
                 }
                 
+                // Bara visningsordningen ändras; lagret förblir i tidsordning
                 if (sortChoice == 1) {
                     dataManager.sortMeasurementsAscending();
-                    cout << "Measurements sorted in ascending order." << endl;
+                    cout << "Measurements will be shown in ascending order." << endl;
                 } else {
                     dataManager.sortMeasurementsDescending();
-                    cout << "Measurements sorted in descending order." << endl;
+                    cout << "Measurements will be shown in descending order." << endl;
                 }
+                cout << "(Stored order is unchanged; time-based analysis still sees the measurements in time order.)" << endl;
                 break;
             }
             
@@ -224,20 +338,26 @@ int main() {
                     cin.ignore(numeric_limits<streamsize>::max(), '\n');
                 }
                 
-                auto above = dataManager.findAboveThreshold(threshold);
-                auto below = dataManager.findBelowThreshold(threshold);
-                auto stats = dataManager.calculateStatistics();
+                // Två binärsökningar i värdeindexet
+                size_t total = dataManager.getMeasurementCount();
+                size_t above = dataManager.countAboveThreshold(threshold);
+                size_t below = dataManager.countBelowThreshold(threshold);
+                
+                if (total == 0) {
+                    cout << "No measurements available for analysis." << endl;
+                    break;
+                }
                 
                 cout << "\nThreshold: " << threshold << endl;
-                cout << "Values above threshold: " << above.size() << " (" 
+                cout << "Values above threshold: " << above << " (" 
                      << fixed << setprecision(1) 
-                     << (static_cast<double>(above.size()) / stats.count * 100) << "%)" << endl;
-                cout << "Values below threshold: " << below.size() << " (" 
+                     << (static_cast<double>(above) / total * 100) << "%)" << endl;
+                cout << "Values below threshold: " << below << " (" 
                      << fixed << setprecision(1) 
-                     << (static_cast<double>(below.size()) / stats.count * 100) << "%)" << endl;
+                     << (static_cast<double>(below) / total * 100) << "%)" << endl;
                 
-                if (!above.empty()) {
-                    cout << "WARNING: " << above.size() << " measurements exceed critical threshold!" << endl;
+                if (above > 0) {
+                    cout << "WARNING: " << above << " measurements exceed critical threshold!" << endl;
                 }
                 break;
             }
@@ -245,22 +365,43 @@ int main() {
             case 7: {
                 // Glidande medelvärde
                 cout << "\n=== MOVING AVERAGE ===" << endl;
-                cout << "Choose window size (3 or 5): ";
+                cout << "Choose window type:" << endl;
+                cout << "1. Last N measurements" << endl;
+                cout << "2. Trailing minutes" << endl;
+                cout << "Choice: ";
+                
+                int windowType;
+                while (!(cin >> windowType) || (windowType != 1 && windowType != 2)) {
+                    cout << "Invalid choice! Choose 1 or 2: ";
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                }
                 
+                cout << (windowType == 1 ? "Enter window size (number of measurements): "
+                                         : "Enter window length in minutes: ");
                 int window;
-                while (!(cin >> window) || (window != 3 && window != 5)) {
-                    cout << "Invalid choice! Choose 3 or 5: ";
+                while (!(cin >> window) || window <= 0) {
+                    cout << "Invalid value! Enter a positive integer: ";
                     cin.clear();
                     cin.ignore(numeric_limits<streamsize>::max(), '\n');
                 }
                 
-                auto movingAvgs = dataManager.calculateMovingAverage(window);
+                vector<double> movingAvgs;
+                if (windowType == 1) {
+                    movingAvgs.resize(dataManager.movingWindowOutputCount(window));
+                    dataManager.calculateMovingWindow(window, WindowAggregate::Mean, movingAvgs.data());
+                } else {
+                    movingAvgs.resize(dataManager.getMeasurementCount());
+                    dataManager.calculateMovingWindow(chrono::minutes(window), WindowAggregate::Mean,
+                                                      movingAvgs.data());
+                }
                 auto stats = dataManager.calculateStatistics();
                 
+                string windowLabel = to_string(window) + (windowType == 1 ? "" : " min");
                 if (movingAvgs.empty()) {
-                    cout << "Not enough measurements for moving average with window " << window << endl;
+                    cout << "Not enough measurements for moving average with window " << windowLabel << endl;
                 } else {
-                    cout << "\nMoving averages (window: " << window << "):" << endl;
+                    cout << "\nMoving averages (window: " << windowLabel << "):" << endl;
                     cout << "Total mean: " << fixed << setprecision(2) << stats.mean << endl;
                     
                     for (size_t i = 0; i < movingAvgs.size(); ++i) {
@@ -284,8 +425,10 @@ int main() {
             }
             
             case 9: {
-                // Visa alla mätvärden
-                auto measurements = dataManager.getAllMeasurements();
+                // Visa alla mätvärden i visningsordningen (tid, eller värde efter
+                // val 5) direkt från kolumnerna; tiden formateras med TimeCodec
+                // och utskriften töms bara en gång på slutet
+                MeasurementSelection measurements = dataManager.measurementsInDisplayOrder();
                 
                 if (measurements.empty()) {
                     cout << "No measurements available." << endl;
@@ -293,11 +436,16 @@ int main() {
                     cout << "\n=== ALL MEASUREMENTS ===" << endl;
                     cout << "Total: " << measurements.size() << " measurements" << endl;
                     
+                    TimeCodec codec(dataManager.getTimeMode());
+                    char timeText[TIME_TEXT_CAPACITY];
+                    cout << fixed << setprecision(2);
                     for (size_t i = 0; i < measurements.size(); ++i) {
-                        cout << "Measurement #" << (i + 1) << ": " 
-                             << fixed << setprecision(2) << measurements[i].value
-                             << " - " << measurements[i].getTimeString() << endl;
+                        char* timeEnd = codec.format(timeText, measurements.timestampNs(i));
+                        cout << "Measurement #" << (measurements.rowIndex(i) + 1) << ": "
+                             << measurements.value(i) << " - ";
+                        cout.write(timeText, timeEnd - timeText) << '\n';
                     }
+                    cout << flush;
                 }
                 break;
             }
@@ -344,24 +492,91 @@ int main() {
                 }
                 
                 if (dataManager.loadFromFile(filename)) {
-                    cout << "Measurements loaded from " << filename << " successfully!" << endl;
+                    cout << "Loaded " << dataManager.getMeasurementCount() << " measurements from "
+                         << filename << " successfully!" << endl;
                 } else {
                     cout << "Failed to load measurements. File may not exist or is empty." << endl;
                 }
                 break;
             }
             
+            case 13: {
+                // Visa mätvärden från instrumenteringen
+                cout << "\n=== METRICS ===" << endl;
+                cout << formatMetricsText(snapshotMetrics());
+                if (!metricsEnabled()) {
+                    break;
+                }
+                
+                cout << "\nExport to file (.json for JSON, otherwise Prometheus text; Enter to skip): ";
+                string filename;
+                cin.ignore();
+                getline(cin, filename);
+                
+                if (!filename.empty() && exportMetrics(filename)) {
+                    cout << "Metrics exported to " << filename << endl;
+                }
+                break;
+            }
+            
+            case 14: {
+                // Rita mätvärdena
+                cout << "\n=== PLOT MEASUREMENTS ===" << endl;
+                cout << "Choose downsampling:" << endl;
+                cout << "1. Min/max per column (keeps every peak)" << endl;
+                cout << "2. LTTB (keeps the shape of the curve)" << endl;
+                cout << "Choice: ";
+                
+                int plotChoice;
+                while (!(cin >> plotChoice) || (plotChoice != 1 && plotChoice != 2)) {
+                    cout << "Invalid choice! Choose 1 or 2: ";
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                }
+                
+                displayPlot(dataManager, plotChoice == 1 ? DownsampleMethod::MinMax : DownsampleMethod::Lttb);
+                break;
+            }
+            
+            case 15: {
+                // Statistik för ett tidsintervall [från, till) via tidsindexet
+                cout << "\n=== TIME RANGE ANALYSIS ===" << endl;
+                TimeCodec codec(dataManager.getTimeMode());
+                const char* prompts[2] = { "From (YYYY-MM-DD HH:MM[:SS]): ", "To (exclusive): " };
+                int64_t bounds[2];
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                for (int i = 0; i < 2; ++i) {
+                    cout << prompts[i];
+                    string text;
+                    while (getline(cin, text) && !codec.parse(text.c_str(), text.c_str() + text.size(), bounds[i])) {
+                        cout << "Invalid time! Enter e.g. 2024-01-01 12:00: ";
+                    }
+                }
+                if (!cin) break;
+                
+                DataManager::TimePoint start{chrono::nanoseconds(bounds[0])};
+                DataManager::TimePoint end{chrono::nanoseconds(bounds[1])};
+                auto stats = dataManager.calculateRangeStatistics(start, end);
+                if (stats.count == 0) {
+                    cout << "No measurements in the selected time range." << endl;
+                    break;
+                }
+                displayStatistics(stats, dataManager.exactQuantiles({ 0.5, 0.95, 0.99 }, start, end), dataManager);
+                break;
+            }
+            
             case 0: {
                 // Automatisk sparfil vid avslut
-                cout << "\nSaving measurements to 'measurements_auto_save.csv'..." << endl;
-                dataManager.saveToFile("measurements_auto_save.csv");
+                // Binär snapshot: sparas och läses in på millisekunder
+                cout << "\nSaving measurements to 'measurements_auto_save.snap'..." << endl;
+                dataManager.saveToFile("measurements_auto_save.snap");
                 
                 cout << "Exiting program. Thank you for using the IoT Analyzer!" << endl;
                 break;
             }
             
             default: {
-                cout << "Invalid choice! Please choose an option between 0-12." << endl;
+                cout << "Invalid choice! Please choose an option between 0-15." << endl;
                 break;
             }
         }
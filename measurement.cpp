@@ -1,27 +1,25 @@
 #include "measurement.h"
-#include <iomanip>
-#include <sstream>
-#include <ctime>
+#include "time_codec.h"
+#include <charconv>
 
 // Implementering av Measurement-structens metoder
+
+// En kodare per tråd: ingen delad tm-buffert som std::localtime och
+// tidszonsinformationen cachas mellan anropen
+static TimeCodec& threadTimeCodec() {
+    thread_local TimeCodec codec(TimeMode::Local);
+    return codec;
+}
+
 std::string Measurement::getTimeString() const {
-    // Konvertera time_point till time_t för att kunna formatera
-    std::time_t time = std::chrono::system_clock::to_time_t(timestamp);
-    std::tm* local_time = std::localtime(&time);
-    
-    // Skapa en formaterad tidssträng
-    std::ostringstream oss;
-    oss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+    return threadTimeCodec().format(toEpochNanoseconds(timestamp));
 }
 
 std::string Measurement::toFileString() const {
     // Formatera för filspar: datum,tid,värde
-    std::time_t time = std::chrono::system_clock::to_time_t(timestamp);
-    std::tm* local_time = std::localtime(&time);
-    
-    std::ostringstream oss;
-    oss << std::put_time(local_time, "%Y-%m-%d %H:%M:%S") << ","
-        << std::fixed << std::setprecision(2) << value;
-    return oss.str();
+    char buffer[TIME_TEXT_CAPACITY + 352];
+    char* out = threadTimeCodec().format(buffer, toEpochNanoseconds(timestamp));
+    *out++ = ',';
+    out = std::to_chars(out, buffer + sizeof(buffer), value, std::chars_format::fixed, 2).ptr;
+    return std::string(buffer, out);
 }
@@ -3,12 +3,14 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
 
 // Struct för att representera ett enskilt mätvärde
 // Jag valde struct eftersom detta är en enkel databehållare
 struct Measurement {
     double value;  // Mätvärdet (t.ex. temperatur)
     std::chrono::system_clock::time_point timestamp;  // När mätningen gjordes
+    std::uint32_t sensorId = 0;  // Sensor eller kanal, se SensorRegistry (0 = "default")
     
     // Funktion för att få en läsbar tidssträng
     std::string getTimeString() const;
@@ -17,4 +19,15 @@ struct Measurement {
     std::string toFileString() const;
 };
 
+// Omvandling mellan time_point och nanosekunder sedan epoch,
+// som är formatet DataManager lagrar tidsstämplar i
+inline std::int64_t toEpochNanoseconds(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+inline std::chrono::system_clock::time_point fromEpochNanoseconds(std::int64_t ns) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
 #endif // MEASUREMENT_H
@@ -0,0 +1,179 @@
+#ifndef MEASUREMENT_VIEW_H
+#define MEASUREMENT_VIEW_H
+
+#include "measurement.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// Icke-ägande vy över en kolumn av värden
+class ValueSpan {
+private:
+    const double* first;
+    size_t count;
+
+public:
+    ValueSpan() : first(nullptr), count(0) {}
+    ValueSpan(const double* first, size_t count) : first(first), count(count) {}
+
+    const double* begin() const { return first; }
+    const double* end() const { return first + count; }
+    const double* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    double operator[](size_t i) const { return first[i]; }
+};
+
+// Icke-ägande vy över kolumnlagrade mätvärden.
+// Värden och tidsstämplar ligger i separata kolumner, men vyn låter
+// anroparen se varje rad som ett vanligt Measurement.
+class MeasurementView {
+private:
+    const double* values;
+    const std::int64_t* timestamps;  // Nanosekunder sedan epoch
+    size_t count;
+    std::uint32_t sensorId;          // Samma för alla rader i vyn
+
+    static Measurement makeMeasurement(double value, std::int64_t timestampNs, std::uint32_t sensorId) {
+        Measurement m;
+        m.value = value;
+        m.timestamp = fromEpochNanoseconds(timestampNs);
+        m.sensorId = sensorId;
+        return m;
+    }
+
+public:
+    class const_iterator {
+    private:
+        const double* values;
+        const std::int64_t* timestamps;
+        size_t index;
+        std::uint32_t sensorId;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef Measurement value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Measurement* pointer;
+        typedef Measurement reference;
+
+        const_iterator(const double* values, const std::int64_t* timestamps, size_t index,
+                       std::uint32_t sensorId)
+            : values(values), timestamps(timestamps), index(index), sensorId(sensorId) {}
+
+        Measurement operator*() const { return makeMeasurement(values[index], timestamps[index], sensorId); }
+        Measurement operator[](difference_type n) const { return *(*this + n); }
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index; return old; }
+        const_iterator& operator--() { --index; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --index; return old; }
+        const_iterator& operator+=(difference_type n) { index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+        const_iterator operator+(difference_type n) const {
+            return const_iterator(values, timestamps, index + n, sensorId);
+        }
+        const_iterator operator-(difference_type n) const {
+            return const_iterator(values, timestamps, index - n, sensorId);
+        }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+        }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+        bool operator<(const const_iterator& other) const { return index < other.index; }
+    };
+
+    MeasurementView() : values(nullptr), timestamps(nullptr), count(0), sensorId(0) {}
+    MeasurementView(const double* values, const std::int64_t* timestamps, size_t count,
+                    std::uint32_t sensorId = 0)
+        : values(values), timestamps(timestamps), count(count), sensorId(sensorId) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Measurement operator[](size_t index) const {
+        return makeMeasurement(values[index], timestamps[index], sensorId);
+    }
+
+    // Direkt åtkomst till kolumnerna
+    const double* valueData() const { return values; }
+    const std::int64_t* timestampData() const { return timestamps; }
+    std::uint32_t sensor() const { return sensorId; }
+
+    const_iterator begin() const { return const_iterator(values, timestamps, 0, sensorId); }
+    const_iterator end() const { return const_iterator(values, timestamps, count, sensorId); }
+};
+
+// Resultat från en filtrering eller ett tidsintervall: radindexen ägs av
+// urvalet och flyttas
+// i stället för att kopieras, medan värden och tidsstämplar läses ur
+// vyn först när en rad efterfrågas. Precis som vyn blir urvalet ogiltigt
+// när datan ändras.
+class MeasurementSelection {
+private:
+    MeasurementView view;
+    std::vector<size_t> rows;
+
+public:
+    class const_iterator {
+    private:
+        const MeasurementSelection* selection;
+        size_t position;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef Measurement value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Measurement* pointer;
+        typedef Measurement reference;
+
+        const_iterator(const MeasurementSelection* selection, size_t position)
+            : selection(selection), position(position) {}
+
+        Measurement operator*() const { return (*selection)[position]; }
+        Measurement operator[](difference_type n) const { return (*selection)[position + n]; }
+        const_iterator& operator++() { ++position; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++position; return old; }
+        const_iterator& operator--() { --position; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --position; return old; }
+        const_iterator& operator+=(difference_type n) { position += n; return *this; }
+        const_iterator& operator-=(difference_type n) { position -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(selection, position + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(selection, position - n); }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(position) - static_cast<difference_type>(other.position);
+        }
+        bool operator==(const const_iterator& other) const { return position == other.position; }
+        bool operator!=(const const_iterator& other) const { return position != other.position; }
+        bool operator<(const const_iterator& other) const { return position < other.position; }
+    };
+
+    MeasurementSelection() {}
+    MeasurementSelection(const MeasurementView& view, std::vector<size_t>&& rows)
+        : view(view), rows(std::move(rows)) {}
+
+    size_t size() const { return rows.size(); }
+    bool empty() const { return rows.empty(); }
+
+    Measurement operator[](size_t i) const { return view[rows[i]]; }
+    // Radnummer i lagret för den i:te träffen
+    size_t rowIndex(size_t i) const { return rows[i]; }
+    double value(size_t i) const { return view.valueData()[rows[i]]; }
+    std::int64_t timestampNs(size_t i) const { return view.timestampData()[rows[i]]; }
+
+    // Radindexen i urvalets ordning (stigande för filter, tidsordning för
+    // tidsintervall); releaseRows() flyttar ut dem och lämnar urvalet tomt
+    const std::vector<size_t>& rowIndices() const { return rows; }
+    std::vector<size_t> releaseRows() {
+        std::vector<size_t> released;
+        released.swap(rows);
+        return released;
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, rows.size()); }
+};
+
+#endif // MEASUREMENT_VIEW_H
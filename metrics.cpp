@@ -0,0 +1,324 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char* const OPERATION_NAMES[OPERATION_COUNT] = {
+    "read_csv", "load_snapshot", "save_csv", "save_snapshot", "append_batch",
+    "statistics", "search", "threshold", "sort", "moving_window",
+    "histogram", "quantile", "ingest_drain", "stream_analysis",
+    "range_query", "downsample", "group_by_sensor", "load_archive", "save_archive"
+};
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "rows_parsed", "parse_errors", "bytes_read", "bytes_written",
+    "measurements_added", "measurements_ingested", "measurements_evicted"
+};
+
+const chrono::steady_clock::time_point processStart = chrono::steady_clock::now();
+
+// Ett block per tråd. Bara ägartråden skriver, så en relaxed load följd av
+// store räcker; läsare ser alltid hela 64-bitarsvärden.
+struct alignas(64) ThreadBlock {
+    atomic<uint64_t> counters[COUNTER_COUNT];
+    atomic<uint64_t> calls[OPERATION_COUNT];
+    atomic<uint64_t> totalNs[OPERATION_COUNT];
+    atomic<uint64_t> maxNs[OPERATION_COUNT];
+    atomic<uint64_t> buckets[OPERATION_COUNT][LATENCY_BUCKETS];
+
+    ThreadBlock() {
+        for (auto& c : counters) c.store(0, memory_order_relaxed);
+        for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+            calls[op].store(0, memory_order_relaxed);
+            totalNs[op].store(0, memory_order_relaxed);
+            maxNs[op].store(0, memory_order_relaxed);
+            for (auto& b : buckets[op]) b.store(0, memory_order_relaxed);
+        }
+    }
+
+    // Lägg blockets värden till en sammanställning
+    void addTo(MetricsSnapshot& snapshot) const {
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            snapshot.counters[c] += counters[c].load(memory_order_relaxed);
+        }
+        for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+            LatencySummary& latency = snapshot.latencies[op];
+            latency.calls += calls[op].load(memory_order_relaxed);
+            latency.totalNs += totalNs[op].load(memory_order_relaxed);
+            latency.maxNs = max(latency.maxNs, maxNs[op].load(memory_order_relaxed));
+            for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+                latency.buckets[b] += buckets[op][b].load(memory_order_relaxed);
+            }
+        }
+    }
+};
+
+inline void bump(atomic<uint64_t>& target, uint64_t amount) {
+    target.store(target.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Alla levande block samt summan från trådar som har avslutats.
+// Låset tas bara vid trådstart, trådslut och sammanställning.
+struct Registry {
+    mutex lock;
+    vector<ThreadBlock*> live;
+    MetricsSnapshot retired;
+};
+
+Registry& registry() {
+    // Avsiktligt aldrig frigjord: trådar kan avslutas efter statiska destruktorer
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+// Registrerar trådens block vid första användningen och flyttar
+// dess värden till "retired" när tråden avslutas
+struct ThreadSlot {
+    unique_ptr<ThreadBlock> block;
+
+    ThreadSlot() : block(new ThreadBlock()) {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        r.live.push_back(block.get());
+    }
+
+    ~ThreadSlot() {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        block->addTo(r.retired);
+        r.live.erase(find(r.live.begin(), r.live.end(), block.get()));
+    }
+};
+
+ThreadBlock& localBlock() {
+    thread_local ThreadSlot slot;
+    return *slot.block;
+}
+
+// Facket är antalet signifikanta bitar i tiden
+size_t bucketFor(uint64_t nanoseconds) {
+    if (nanoseconds == 0) return 0;
+#if defined(__GNUC__)
+    size_t bits = 64 - static_cast<size_t>(__builtin_clzll(nanoseconds));
+#else
+    size_t bits = 0;
+    for (uint64_t n = nanoseconds; n != 0; n >>= 1) ++bits;
+#endif
+    return min(bits, LATENCY_BUCKETS - 1);
+}
+
+// Övre gräns för ett fack i nanosekunder
+double bucketUpperNs(size_t bucket) {
+    return ldexp(1.0, static_cast<int>(bucket));
+}
+
+// Genomströmning för inläsning av CSV (rader per sekund under ReadCsv)
+double rowsPerSecond(const MetricsSnapshot& snapshot) {
+    uint64_t ns = snapshot.latency(Operation::ReadCsv).totalNs;
+    return ns > 0 ? snapshot.counter(Counter::RowsParsed) / (ns * 1e-9) : 0.0;
+}
+
+bool hasSuffix(const string& text, const string& suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+string formatDuration(double nanoseconds) {
+    ostringstream out;
+    out << fixed << setprecision(1);
+    if (nanoseconds >= 1e9) out << nanoseconds / 1e9 << " s";
+    else if (nanoseconds >= 1e6) out << nanoseconds / 1e6 << " ms";
+    else if (nanoseconds >= 1e3) out << nanoseconds / 1e3 << " us";
+    else out << nanoseconds << " ns";
+    return out.str();
+}
+
+} // namespace
+
+const char* operationName(Operation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
+
+const char* counterName(Counter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+LatencySummary::LatencySummary() : calls(0), totalNs(0), maxNs(0) {
+    fill(buckets, buckets + LATENCY_BUCKETS, 0);
+}
+
+double LatencySummary::quantileNs(double q) const {
+    if (calls == 0) return 0.0;
+    uint64_t target = static_cast<uint64_t>(ceil(q * calls));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= target) return min(bucketUpperNs(b), static_cast<double>(maxNs));
+    }
+    return static_cast<double>(maxNs);
+}
+
+MetricsSnapshot::MetricsSnapshot() : uptimeSeconds(0) {
+    fill(counters, counters + COUNTER_COUNT, 0);
+}
+
+void recordLatency(Operation operation, uint64_t nanoseconds) {
+    ThreadBlock& block = localBlock();
+    size_t op = static_cast<size_t>(operation);
+    bump(block.calls[op], 1);
+    bump(block.totalNs[op], nanoseconds);
+    if (nanoseconds > block.maxNs[op].load(memory_order_relaxed)) {
+        block.maxNs[op].store(nanoseconds, memory_order_relaxed);
+    }
+    bump(block.buckets[op][bucketFor(nanoseconds)], 1);
+}
+
+void addToCounter(Counter counter, uint64_t amount) {
+    bump(localBlock().counters[static_cast<size_t>(counter)], amount);
+}
+
+MetricsSnapshot snapshotMetrics() {
+    Registry& r = registry();
+    lock_guard<mutex> guard(r.lock);
+    MetricsSnapshot snapshot = r.retired;
+    for (const ThreadBlock* block : r.live) {
+        block->addTo(snapshot);
+    }
+    snapshot.uptimeSeconds = chrono::duration<double>(chrono::steady_clock::now() - processStart).count();
+    return snapshot;
+}
+
+bool metricsEnabled() {
+#ifdef IOT_NO_METRICS
+    return false;
+#else
+    return true;
+#endif
+}
+
+string formatMetricsPrometheus(const MetricsSnapshot& snapshot) {
+    ostringstream out;
+    out << setprecision(9);
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << "# TYPE iot_" << COUNTER_NAMES[c] << "_total counter\n"
+            << "iot_" << COUNTER_NAMES[c] << "_total " << snapshot.counters[c] << "\n";
+    }
+
+    out << "# TYPE iot_operation_duration_seconds histogram\n";
+    for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+        const LatencySummary& latency = snapshot.latencies[op];
+        string label = string("operation=\"") + OPERATION_NAMES[op] + "\"";
+        // Kumulativa fack upp till det högsta som används
+        size_t last = 0;
+        for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+            if (latency.buckets[b] > 0) last = b;
+        }
+        uint64_t cumulative = 0;
+        for (size_t b = 0; latency.calls > 0 && b <= last; ++b) {
+            cumulative += latency.buckets[b];
+            out << "iot_operation_duration_seconds_bucket{" << label << ",le=\""
+                << bucketUpperNs(b) * 1e-9 << "\"} " << cumulative << "\n";
+        }
+        out << "iot_operation_duration_seconds_bucket{" << label << ",le=\"+Inf\"} " << latency.calls << "\n"
+            << "iot_operation_duration_seconds_sum{" << label << "} " << latency.totalNs * 1e-9 << "\n"
+            << "iot_operation_duration_seconds_count{" << label << "} " << latency.calls << "\n";
+    }
+
+    out << "# TYPE iot_rows_parsed_per_second gauge\n"
+        << "iot_rows_parsed_per_second " << rowsPerSecond(snapshot) << "\n"
+        << "# TYPE iot_uptime_seconds gauge\n"
+        << "iot_uptime_seconds " << snapshot.uptimeSeconds << "\n";
+    return out.str();
+}
+
+string formatMetricsJson(const MetricsSnapshot& snapshot) {
+    ostringstream out;
+    out << setprecision(9);
+    out << "{\n  \"enabled\": " << (metricsEnabled() ? "true" : "false") << ",\n"
+        << "  \"uptime_seconds\": " << snapshot.uptimeSeconds << ",\n"
+        << "  \"rows_parsed_per_second\": " << rowsPerSecond(snapshot) << ",\n"
+        << "  \"counters\": {";
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << (c > 0 ? "," : "") << "\n    \"" << COUNTER_NAMES[c] << "\": " << snapshot.counters[c];
+    }
+    out << "\n  },\n  \"operations\": {";
+    for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+        const LatencySummary& latency = snapshot.latencies[op];
+        out << (op > 0 ? "," : "") << "\n    \"" << OPERATION_NAMES[op] << "\": {"
+            << "\"calls\": " << latency.calls << ", "
+            << "\"total_seconds\": " << latency.totalNs * 1e-9 << ", "
+            << "\"mean_ns\": " << latency.meanNs() << ", "
+            << "\"p50_ns\": " << latency.quantileNs(0.5) << ", "
+            << "\"p99_ns\": " << latency.quantileNs(0.99) << ", "
+            << "\"max_ns\": " << latency.maxNs << "}";
+    }
+    out << "\n  }\n}\n";
+    return out.str();
+}
+
+string formatMetricsText(const MetricsSnapshot& snapshot) {
+    ostringstream out;
+    if (!metricsEnabled()) {
+        out << "Metrics are disabled in this build (IOT_NO_METRICS)." << endl;
+        return out.str();
+    }
+
+    out << "Counters:" << endl;
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << "  " << left << setw(24) << COUNTER_NAMES[c] << right << setw(16) << snapshot.counters[c] << endl;
+    }
+    out << "  " << left << setw(24) << "rows_parsed_per_second" << right << setw(16)
+        << fixed << setprecision(0) << rowsPerSecond(snapshot) << endl;
+
+    out << endl << "Operations:" << endl;
+    out << "  " << left << setw(18) << "operation" << right << setw(10) << "calls"
+        << setw(12) << "total" << setw(12) << "mean" << setw(12) << "p99" << setw(12) << "max" << endl;
+    bool any = false;
+    for (size_t op = 0; op < OPERATION_COUNT; ++op) {
+        const LatencySummary& latency = snapshot.latencies[op];
+        if (latency.calls == 0) continue;
+        any = true;
+        out << "  " << left << setw(18) << OPERATION_NAMES[op] << right << setw(10) << latency.calls
+            << setw(12) << formatDuration(static_cast<double>(latency.totalNs))
+            << setw(12) << formatDuration(latency.meanNs())
+            << setw(12) << formatDuration(latency.quantileNs(0.99))
+            << setw(12) << formatDuration(static_cast<double>(latency.maxNs)) << endl;
+    }
+    if (!any) out << "  (no operations recorded yet)" << endl;
+    return out.str();
+}
+
+bool exportMetrics(const string& filename) {
+    MetricsSnapshot snapshot = snapshotMetrics();
+    string text = hasSuffix(filename, ".json") ? formatMetricsJson(snapshot)
+                                               : formatMetricsPrometheus(snapshot);
+    if (filename == "-") {
+        cout << text;
+        return static_cast<bool>(cout);
+    }
+
+    ofstream out(filename);
+    if (!out) {
+        cerr << "Error: Could not open metrics file for writing: " << filename << endl;
+        return false;
+    }
+    out << text;
+    if (!out) {
+        cerr << "Error: Could not write metrics file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
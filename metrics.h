@@ -0,0 +1,134 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Inbyggd instrumentering av DataManager, filhantering och insamling.
+//
+// Varje tråd skriver till ett eget block med räknare och latenshistogram
+// (relaxed atomics utan delad skrivning, alltså inga lås eller delade
+// cachelinjer på den heta vägen). snapshotMetrics() summerar alla block.
+// Latenser sparas i log2-fack i nanosekunder. En tidtagning kostar två
+// klockavläsningar (~40 ns), så operationer i O(1) som addMeasurement och
+// calculateStatistics räknas men tidmäts inte.
+//
+// Med -DIOT_NO_METRICS (make NO_METRICS=1) blir makrona tomma och
+// instrumenteringen försvinner helt ur koden.
+
+// Tidsmätta operationer
+enum class Operation : unsigned {
+    ReadCsv,
+    LoadSnapshot,
+    SaveCsv,
+    SaveSnapshot,
+    AppendBatch,
+    Statistics,
+    Search,
+    Threshold,
+    Sort,
+    MovingWindow,
+    Histogram,
+    Quantile,
+    IngestDrain,
+    StreamAnalysis,
+    RangeQuery,
+    Downsample,
+    GroupBySensor,
+    LoadArchive,
+    SaveArchive,
+    COUNT
+};
+
+// Räknare
+enum class Counter : unsigned {
+    RowsParsed,
+    ParseErrors,
+    BytesRead,
+    BytesWritten,
+    MeasurementsAdded,
+    MeasurementsIngested,
+    MeasurementsEvicted,
+    COUNT
+};
+
+const size_t OPERATION_COUNT = static_cast<size_t>(Operation::COUNT);
+const size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+const size_t LATENCY_BUCKETS = 64;   // Fack b täcker [2^(b-1), 2^b) ns
+
+const char* operationName(Operation operation);
+const char* counterName(Counter counter);
+
+// Sammanställd latens för en operation
+struct LatencySummary {
+    std::uint64_t calls;
+    std::uint64_t totalNs;
+    std::uint64_t maxNs;
+    std::uint64_t buckets[LATENCY_BUCKETS];
+
+    LatencySummary();
+    double meanNs() const { return calls > 0 ? static_cast<double>(totalNs) / calls : 0.0; }
+    // Uppskattad kvantil utifrån facken (övre gränsen i det fack där kvantilen hamnar)
+    double quantileNs(double q) const;
+};
+
+struct MetricsSnapshot {
+    std::uint64_t counters[COUNTER_COUNT];
+    LatencySummary latencies[OPERATION_COUNT];
+    double uptimeSeconds;
+
+    MetricsSnapshot();
+    std::uint64_t counter(Counter c) const { return counters[static_cast<size_t>(c)]; }
+    const LatencySummary& latency(Operation o) const { return latencies[static_cast<size_t>(o)]; }
+};
+
+// Registrera mätvärden för den anropande tråden
+void recordLatency(Operation operation, std::uint64_t nanoseconds);
+void addToCounter(Counter counter, std::uint64_t amount);
+
+// Summera alla trådars block (även trådar som har avslutats)
+MetricsSnapshot snapshotMetrics();
+
+// Falskt om programmet byggts med IOT_NO_METRICS
+bool metricsEnabled();
+
+// Export i Prometheus textformat respektive JSON
+std::string formatMetricsPrometheus(const MetricsSnapshot& snapshot);
+std::string formatMetricsJson(const MetricsSnapshot& snapshot);
+std::string formatMetricsText(const MetricsSnapshot& snapshot);
+// Skriv till fil; JSON om filnamnet slutar på .json, annars Prometheus-text. "-" = stdout.
+bool exportMetrics(const std::string& filename);
+
+// Mäter tiden från konstruktion till destruktion
+class ScopedTimer {
+private:
+    Operation operation;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(Operation operation)
+        : operation(operation), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        recordLatency(operation, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#define IOT_METRICS_CONCAT_INNER(a, b) a##b
+#define IOT_METRICS_CONCAT(a, b) IOT_METRICS_CONCAT_INNER(a, b)
+
+#ifdef IOT_NO_METRICS
+#define IOT_TIME_OPERATION(operation) ((void)0)
+#define IOT_COUNT(counter, amount) ((void)0)
+#else
+// Tidmät resten av det omgivande blocket
+#define IOT_TIME_OPERATION(operation) \
+    ScopedTimer IOT_METRICS_CONCAT(iotScopedTimer, __LINE__)(Operation::operation)
+#define IOT_COUNT(counter, amount) addToCounter(Counter::counter, (amount))
+#endif
+
+#endif // METRICS_H
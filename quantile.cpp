@@ -0,0 +1,212 @@
+#include "quantile.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+const double NOT_A_NUMBER = numeric_limits<double>::quiet_NaN();
+
+// Kapaciteten krymper med faktorn 2/3 för varje nivå nedåt från toppen
+const double CAPACITY_DECAY = 2.0 / 3.0;
+
+} // namespace
+
+vector<double> exactQuantiles(const double* data, size_t count, const vector<double>& qs) {
+    vector<double> results(qs.size(), NOT_A_NUMBER);
+
+    vector<double> scratch;
+    scratch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!std::isnan(data[i])) scratch.push_back(data[i]);
+    }
+    if (scratch.empty()) return results;
+
+    // Behandla kvantilerna i stigande ordning så att varje nth_element
+    // bara behöver ordna den del som ligger efter föregående position
+    vector<size_t> order(qs.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&qs](size_t a, size_t b) { return qs[a] < qs[b]; });
+
+    size_t searchStart = 0;
+    for (size_t index : order) {
+        double q = qs[index];
+        if (std::isnan(q)) continue;
+        q = min(1.0, max(0.0, q));
+
+        double position = q * (scratch.size() - 1);
+        size_t lower = static_cast<size_t>(position);
+        double fraction = position - lower;
+
+        nth_element(scratch.begin() + searchStart, scratch.begin() + lower, scratch.end());
+        double value = scratch[lower];
+        if (fraction > 0 && lower + 1 < scratch.size()) {
+            double next = *min_element(scratch.begin() + lower + 1, scratch.end());
+            value += fraction * (next - value);
+        }
+        results[index] = value;
+        searchStart = lower;
+    }
+    return results;
+}
+
+double exactQuantile(const double* data, size_t count, double q) {
+    return exactQuantiles(data, count, vector<double>(1, q))[0];
+}
+
+KllSketch::KllSketch(size_t k)
+    : k(max<size_t>(k, 8)), retained(0), retainedLimit(0), count(0),
+      minValue(NOT_A_NUMBER), maxValue(NOT_A_NUMBER), randomState(0x9E3779B97F4A7C15ULL) {
+    addLevel();
+}
+
+size_t KllSketch::levelCapacity(size_t level) const {
+    size_t height = levels.size() - level - 1;
+    double capacity = ceil(k * pow(CAPACITY_DECAY, static_cast<double>(height)));
+    return max<size_t>(2, static_cast<size_t>(capacity) + 1);
+}
+
+void KllSketch::addLevel() {
+    levels.emplace_back();
+    retainedLimit = 0;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        retainedLimit += levelCapacity(level);
+    }
+    levels[0].reserve(levelCapacity(0));
+}
+
+// xorshift64 med fast frö, så att samma indata alltid ger samma skiss
+bool KllSketch::nextRandomBit() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return (randomState >> 32) & 1;
+}
+
+void KllSketch::compress() {
+    for (size_t level = 0; level < levels.size(); ++level) {
+        if (levels[level].size() < levelCapacity(level)) continue;
+        if (level + 1 == levels.size()) addLevel();
+
+        // Sortera nivån och flytta upp varannan post, med slumpad start.
+        // Vid udda antal blir den största kvar på nivån.
+        vector<double>& items = levels[level];
+        vector<double>& above = levels[level + 1];
+        sort(items.begin(), items.end());
+        size_t pairs = items.size() / 2;
+        size_t offset = nextRandomBit() ? 1 : 0;
+        for (size_t i = 0; i < pairs; ++i) {
+            above.push_back(items[2 * i + offset]);
+        }
+        bool odd = items.size() % 2 == 1;
+        double kept = odd ? items.back() : 0.0;
+        items.clear();
+        if (odd) items.push_back(kept);
+
+        retained -= pairs;
+        return;
+    }
+}
+
+void KllSketch::update(double value) {
+    if (std::isnan(value)) return;
+    if (count == 0) {
+        minValue = maxValue = value;
+    } else {
+        minValue = min(minValue, value);
+        maxValue = max(maxValue, value);
+    }
+    ++count;
+    levels[0].push_back(value);
+    if (++retained >= retainedLimit) {
+        compress();
+    }
+}
+
+void KllSketch::updateRange(const double* data, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        update(data[i]);
+    }
+}
+
+void KllSketch::merge(const KllSketch& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    } else {
+        minValue = min(minValue, other.minValue);
+        maxValue = max(maxValue, other.maxValue);
+    }
+    count += other.count;
+
+    while (levels.size() < other.levels.size()) addLevel();
+    for (size_t level = 0; level < other.levels.size(); ++level) {
+        levels[level].insert(levels[level].end(), other.levels[level].begin(), other.levels[level].end());
+    }
+    retained += other.retained;
+    while (retained >= retainedLimit) {
+        size_t before = retained;
+        compress();
+        if (retained == before) break;
+    }
+}
+
+void KllSketch::clear() {
+    *this = KllSketch(k);
+}
+
+vector<double> KllSketch::quantiles(const vector<double>& qs) const {
+    vector<double> results(qs.size(), NOT_A_NUMBER);
+    if (count == 0) return results;
+
+    // Alla sparade värden med vikt 2^nivå, sorterade efter värde
+    vector<pair<double, uint64_t>> weighted;
+    weighted.reserve(retained);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        for (double value : levels[level]) {
+            weighted.emplace_back(value, uint64_t(1) << level);
+        }
+    }
+    sort(weighted.begin(), weighted.end());
+    vector<uint64_t> cumulative(weighted.size());
+    uint64_t total = 0;
+    for (size_t i = 0; i < weighted.size(); ++i) {
+        total += weighted[i].second;
+        cumulative[i] = total;
+    }
+
+    for (size_t i = 0; i < qs.size(); ++i) {
+        double q = qs[i];
+        if (std::isnan(q)) continue;
+        if (q <= 0) { results[i] = minValue; continue; }
+        if (q >= 1) { results[i] = maxValue; continue; }
+        // Första värdet vars kumulativa vikt når q * total
+        double target = q * total;
+        size_t position = lower_bound(cumulative.begin(), cumulative.end(), target,
+            [](uint64_t weight, double wanted) { return weight < wanted; }) - cumulative.begin();
+        results[i] = weighted[min(position, weighted.size() - 1)].first;
+    }
+    return results;
+}
+
+double KllSketch::quantile(double q) const {
+    return quantiles(vector<double>(1, q))[0];
+}
+
+double KllSketch::rank(double value) const {
+    if (count == 0) return NOT_A_NUMBER;
+    uint64_t below = 0, total = 0;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        uint64_t weight = uint64_t(1) << level;
+        for (double item : levels[level]) {
+            if (item <= value) below += weight;
+            total += weight;
+        }
+    }
+    return static_cast<double>(below) / total;
+}
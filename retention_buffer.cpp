@@ -0,0 +1,274 @@
+#include "retention_buffer.h"
+#include "metrics.h"
+#include "stats_kernel.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+
+RetentionBuffer::RetentionBuffer(size_t capacity, chrono::nanoseconds maxAge)
+    : values(max<size_t>(capacity, 1)), timestamps(values.size()), head(0), count(0),
+      maxAgeNs(max<int64_t>(maxAge.count(), 0)), newestNs(numeric_limits<int64_t>::min()), evicted(0),
+      sum(0), mean(0), m2(0), evictionsSinceRefresh(0), nonFiniteCount(0),
+      minQueue(values.size()), maxQueue(values.size()), minFront(0), minCount(0), maxFront(0), maxCount(0),
+      histogramEnabled(false), spillCount(0), archiveFailed(false) {
+}
+
+RetentionBuffer::~RetentionBuffer() {
+    flushArchive();
+}
+
+// Privat hjälpmetod: Ringposition för rad offset räknat från den äldsta
+size_t RetentionBuffer::position(size_t offset) const {
+    size_t pos = head + offset;
+    return pos < values.size() ? pos : pos - values.size();
+}
+
+void RetentionBuffer::addMeasurement(double value, chrono::system_clock::time_point timestamp) {
+    addMeasurement(value, toEpochNanoseconds(timestamp));
+}
+
+void RetentionBuffer::addMeasurement(double value, int64_t timestampNs) {
+    IOT_COUNT(MeasurementsAdded, 1);
+    if (maxAgeNs > 0) {
+        newestNs = max(newestNs, timestampNs);
+        // Gränsen kan inte underskrida det minsta värdet
+        if (newestNs > numeric_limits<int64_t>::min() + maxAgeNs) {
+            int64_t limit = newestNs - maxAgeNs;
+            while (count > 0 && timestamps[head] <= limit) evictOldest();
+        }
+    }
+    if (count == values.size()) evictOldest();
+
+    size_t pos = position(count);
+    values[pos] = value;
+    timestamps[pos] = timestampNs;
+    ++count;
+
+    sum += value;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    if (!isfinite(value)) ++nonFiniteCount;
+
+    // Köerna har plats för hela fönstret, så de kan aldrig bli fulla. NaN
+    // kan aldrig bli min eller max och hoppas över; annars skulle det
+    // stoppa rensningen och lämna inaktuella extremvärden i köerna.
+    size_t capacity = values.size();
+    if (!isnan(value)) {
+        while (minCount > 0) {
+            size_t back = minFront + minCount - 1;
+            if (back >= capacity) back -= capacity;
+            if (values[minQueue[back]] <= value) break;
+            --minCount;
+        }
+        size_t minBack = minFront + minCount;
+        minQueue[minBack < capacity ? minBack : minBack - capacity] = pos;
+        ++minCount;
+        while (maxCount > 0) {
+            size_t back = maxFront + maxCount - 1;
+            if (back >= capacity) back -= capacity;
+            if (values[maxQueue[back]] >= value) break;
+            --maxCount;
+        }
+        size_t maxBack = maxFront + maxCount;
+        maxQueue[maxBack < capacity ? maxBack : maxBack - capacity] = pos;
+        ++maxCount;
+    }
+
+    if (histogramEnabled) histogram.add(value);
+}
+
+void RetentionBuffer::appendBatch(const double* batchValues, const int64_t* batchTimestamps, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        addMeasurement(batchValues[i], batchTimestamps[i]);
+    }
+}
+
+// Privat hjälpmetod: Ta bort den äldsta raden och räkna ned aggregaten
+void RetentionBuffer::evictOldest() {
+    size_t pos = head;
+    double value = values[pos];
+
+    if (archive.isOpen() && !archiveFailed) {
+        spillValues[spillCount] = value;
+        spillTimestamps[spillCount] = timestamps[pos];
+        if (++spillCount == SPILL_BLOCK_ROWS) flushSpill();
+    }
+
+    size_t capacity = values.size();
+    if (minCount > 0 && minQueue[minFront] == pos) {
+        minFront = minFront + 1 == capacity ? 0 : minFront + 1;
+        --minCount;
+    }
+    if (maxCount > 0 && maxQueue[maxFront] == pos) {
+        maxFront = maxFront + 1 == capacity ? 0 : maxFront + 1;
+        --maxCount;
+    }
+    head = head + 1 == capacity ? 0 : head + 1;
+    --count;
+    ++evicted;
+    IOT_COUNT(MeasurementsEvicted, 1);
+
+    // Welford baklänges: medelvärdet utan värdet, sedan dess bidrag till M2
+    if (count == 0) {
+        sum = mean = m2 = 0;
+    } else {
+        sum -= value;
+        double previousMean = mean;
+        mean -= (value - previousMean) / count;
+        m2 -= (value - previousMean) * (value - mean);
+        if (m2 < 0) m2 = 0;
+    }
+    if (histogramEnabled) histogram.remove(value);
+
+    // Ett NaN eller inf lämnar summorna NaN även efter borttagningen, så de
+    // räknas om när det sista har lämnat fönstret
+    bool lastNonFinite = !isfinite(value) && --nonFiniteCount == 0;
+    if (++evictionsSinceRefresh >= capacity || lastNonFinite) refreshAggregates();
+}
+
+// Privat hjälpmetod: Räkna om summa, medelvärde och M2 från bufferten så
+// att avrundningsfel från borttagningarna inte ackumuleras
+void RetentionBuffer::refreshAggregates() {
+    evictionsSinceRefresh = 0;
+    size_t firstPart = min(count, values.size() - head);
+    RunningStats stats = summarizeValues(values.data() + head, firstPart);
+    stats.merge(summarizeValues(values.data(), count - firstPart), firstPart);
+    sum = stats.sum;
+    mean = stats.mean;
+    m2 = stats.m2;
+}
+
+void RetentionBuffer::clear() {
+    head = 0;
+    count = 0;
+    newestNs = numeric_limits<int64_t>::min();
+    sum = mean = m2 = 0;
+    evictionsSinceRefresh = 0;
+    nonFiniteCount = 0;
+    minFront = minCount = maxFront = maxCount = 0;
+    histogram.clear();
+}
+
+bool RetentionBuffer::setArchive(const string& filename) {
+    flushArchive();
+    string error;
+    if (!archive.open(filename, error)) {
+        cerr << "Error: Could not open archive " << filename << ": " << error << endl;
+        return false;
+    }
+    // Allt som behövs för att arkivera allokeras här, inte vid utträngning
+    spillValues.resize(SPILL_BLOCK_ROWS);
+    spillTimestamps.resize(SPILL_BLOCK_ROWS);
+    archive.reserve(SPILL_BLOCK_ROWS);
+    archiveFailed = false;
+    return true;
+}
+
+// Privat hjälpmetod: Skriv den samlade batchen som ett block
+bool RetentionBuffer::flushSpill() {
+    if (spillCount == 0) return true;
+    bool ok = archive.writeBlock(spillValues.data(), spillTimestamps.data(), spillCount);
+    spillCount = 0;
+    if (!ok && !archiveFailed) {
+        cerr << "Error: Could not write to archive; evicted measurements are no longer archived" << endl;
+        archiveFailed = true;
+    }
+    return ok;
+}
+
+bool RetentionBuffer::flushArchive() {
+    if (!archive.isOpen() || archiveFailed) return !archiveFailed;
+    return flushSpill() && archive.flush();
+}
+
+RetentionBuffer::Statistics RetentionBuffer::calculateStatistics() const {
+    RunningStats stats;
+    if (count > 0) {
+        stats.count = count;
+        stats.sum = sum;
+        stats.mean = mean;
+        stats.m2 = m2;
+        if (minCount > 0) {
+            size_t capacity = values.size();
+            size_t minPos = minQueue[minFront];
+            size_t maxPos = maxQueue[maxFront];
+            stats.min = values[minPos];
+            stats.max = values[maxPos];
+            stats.minIndex = minPos >= head ? minPos - head : minPos + capacity - head;
+            stats.maxIndex = maxPos >= head ? maxPos - head : maxPos + capacity - head;
+        } else {
+            // Fönstret innehåller bara NaN
+            stats.min = stats.max = numeric_limits<double>::quiet_NaN();
+        }
+    }
+    return DataManager::toStatistics(stats);
+}
+
+size_t RetentionBuffer::countAboveThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    size_t firstPart = min(count, values.size() - head);
+    const double* first = values.data() + head;
+    const double* second = values.data();
+    auto above = [threshold](double v) { return v > threshold; };
+    return count_if(first, first + firstPart, above) + count_if(second, second + (count - firstPart), above);
+}
+
+size_t RetentionBuffer::countBelowThreshold(double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    size_t firstPart = min(count, values.size() - head);
+    const double* first = values.data() + head;
+    const double* second = values.data();
+    auto below = [threshold](double v) { return v <= threshold; };
+    return count_if(first, first + firstPart, below) + count_if(second, second + (count - firstPart), below);
+}
+
+void RetentionBuffer::enableHistogram(double lowerBound, double binWidth, size_t binCount) {
+    histogram = Histogram(lowerBound, binWidth, binCount);
+    histogramEnabled = true;
+    size_t firstPart = min(count, values.size() - head);
+    histogram.addRange(values.data() + head, firstPart);
+    histogram.addRange(values.data(), count - firstPart);
+}
+
+void RetentionBuffer::disableHistogram() {
+    histogram = Histogram();
+    histogramEnabled = false;
+}
+
+// Rotera ringen så att den äldsta raden hamnar först. Köernas positioner
+// flyttas med; deras ordning är oförändrad.
+MeasurementView RetentionBuffer::measurementsView() {
+    if (head != 0) {
+        size_t capacity = values.size();
+        rotate(values.begin(), values.begin() + head, values.end());
+        rotate(timestamps.begin(), timestamps.begin() + head, timestamps.end());
+        for (size_t i = 0; i < minCount; ++i) {
+            size_t& pos = minQueue[minFront + i < capacity ? minFront + i : minFront + i - capacity];
+            pos = pos >= head ? pos - head : pos + capacity - head;
+        }
+        for (size_t i = 0; i < maxCount; ++i) {
+            size_t& pos = maxQueue[maxFront + i < capacity ? maxFront + i : maxFront + i - capacity];
+            pos = pos >= head ? pos - head : pos + capacity - head;
+        }
+        head = 0;
+    }
+    return MeasurementView(values.data(), timestamps.data(), count);
+}
+
+size_t RetentionBuffer::calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, double* out) {
+    IOT_TIME_OPERATION(MovingWindow);
+    MeasurementView view = measurementsView();
+    return windowEngine.rolling(view.valueData(), view.size(), windowSize, aggregate, out);
+}
+
+size_t RetentionBuffer::calculateMovingWindow(chrono::nanoseconds duration, WindowAggregate aggregate,
+                                              double* out) {
+    IOT_TIME_OPERATION(MovingWindow);
+    MeasurementView view = measurementsView();
+    return windowEngine.rollingByTime(view.valueData(), view.timestampData(), view.size(), duration.count(),
+                                      aggregate, out);
+}
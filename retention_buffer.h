@@ -0,0 +1,135 @@
+#ifndef RETENTION_BUFFER_H
+#define RETENTION_BUFFER_H
+
+#include "archive.h"
+#include "data_manager.h"
+#include "histogram.h"
+#include "measurement_view.h"
+#include "sliding_window.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lagring med fast minne för långvarig drift: bara de senaste capacity
+// mätvärdena, och om maxAge anges bara de som är nyare än maxAge räknat
+// från den senaste tidsstämpeln, behålls. Raderna behålls i ankomstordning;
+// tidsgränsen tränger ut från den äldsta raden och förutsätter därför att
+// mätvärdena kommer ungefär i tidsordning.
+//
+// Värden och tidsstämplar ligger i två ringbuffertar som allokeras en gång
+// i konstruktorn; tillägg och utträngning allokerar aldrig. Statistiken
+// följer fönstret i O(1) per värde: medelvärde och varians räknas upp och
+// ned med Welford, min/max hålls i monotona köer (också förallokerade
+// ringar) och ett aktiverat histogram räknar bort utträngda värden.
+// Avrundningsfelen från borttagningarna nollställs genom att aggregaten
+// räknas om från bufferten en gång per capacity utträngningar, och direkt
+// när det sista NaN- eller inf-värdet har lämnat fönstret. NaN läggs aldrig
+// i min/max-köerna, som i SlidingWindowEngine.
+//
+// Utträngda värden kan sparas i en arkivfil (archive.h). De samlas i en
+// förallokerad batch och skrivs ett block i taget.
+class RetentionBuffer {
+public:
+    typedef DataManager::Statistics Statistics;
+
+    // Antal utträngda rader per arkivblock
+    static const size_t SPILL_BLOCK_ROWS = COMPRESSED_BLOCK_ROWS;
+
+private:
+    std::vector<double> values;           // Ringar med capacity platser
+    std::vector<std::int64_t> timestamps;
+    size_t head;                          // Position för den äldsta raden
+    size_t count;
+    std::int64_t maxAgeNs;                // 0 = ingen tidsgräns
+    std::int64_t newestNs;
+    std::uint64_t evicted;
+
+    // Löpande aggregat över fönstret
+    double sum;
+    double mean;
+    double m2;
+    size_t evictionsSinceRefresh;
+    size_t nonFiniteCount;                // NaN och ±inf i fönstret
+
+    // Monotona köer med ringpositioner; fronten är fönstrets min respektive max
+    std::vector<size_t> minQueue;
+    std::vector<size_t> maxQueue;
+    size_t minFront, minCount;
+    size_t maxFront, maxCount;
+
+    Histogram histogram;
+    bool histogramEnabled;
+
+    ArchiveWriter archive;
+    std::vector<double> spillValues;
+    std::vector<std::int64_t> spillTimestamps;
+    size_t spillCount;
+    bool archiveFailed;
+
+    SlidingWindowEngine windowEngine;
+
+    size_t position(size_t offset) const;
+    void evictOldest();
+    void refreshAggregates();
+    bool flushSpill();
+
+public:
+    explicit RetentionBuffer(size_t capacity,
+                             std::chrono::nanoseconds maxAge = std::chrono::nanoseconds::zero());
+    ~RetentionBuffer();
+    RetentionBuffer(const RetentionBuffer&) = delete;
+    RetentionBuffer& operator=(const RetentionBuffer&) = delete;
+
+    // Lägg till ett värde och tränga ut det som inte längre ska behållas.
+    // Tidsgränsen räknas från den största tidsstämpeln hittills.
+    void addMeasurement(double value, std::chrono::system_clock::time_point timestamp);
+    void addMeasurement(double value, std::int64_t timestampNs);
+    void appendBatch(const double* batchValues, const std::int64_t* batchTimestamps, size_t count);
+    // Töm fönstret utan att arkivera; statistik och histogram nollställs
+    void clear();
+
+    size_t size() const { return count; }
+    size_t capacity() const { return values.size(); }
+    bool empty() const { return count == 0; }
+    std::chrono::nanoseconds maxAge() const { return std::chrono::nanoseconds(maxAgeNs); }
+    // Antal utträngda värden sedan start
+    std::uint64_t evictedCount() const { return evicted; }
+
+    // Rad i fönstret, 0 = äldsta
+    double value(size_t i) const { return values[position(i)]; }
+    std::int64_t timestampNs(size_t i) const { return timestamps[position(i)]; }
+
+    // Spara utträngda värden i arkivfilen (läggs till i slutet om den finns).
+    // Skrivfel rapporteras till cerr en gång och stänger av arkiveringen.
+    bool setArchive(const std::string& filename);
+    bool hasArchive() const { return archive.isOpen(); }
+    // Skriv ut samlade utträngda värden; görs även av destruktorn
+    bool flushArchive();
+    std::uint64_t archivedCount() const { return archive.getRowsWritten() + spillCount; }
+
+    // Statistik över fönstret i O(1); minIndex/maxIndex är positioner i
+    // fönstret räknat från den äldsta raden
+    Statistics calculateStatistics() const;
+    size_t countAboveThreshold(double threshold) const;   // värde >  threshold
+    size_t countBelowThreshold(double threshold) const;   // värde <= threshold
+
+    // Histogram som följer fönstret; fylls med det som redan finns
+    void enableHistogram(double lowerBound, double binWidth, size_t binCount);
+    void disableHistogram();
+    bool isHistogramEnabled() const { return histogramEnabled; }
+    const Histogram& getHistogram() const { return histogram; }
+
+    // Fönstrets rader i ankomstordning utan kopiering. Ringen roteras på plats
+    // (O(n), ingen allokering) så att raderna ligger i följd; vyn blir
+    // ogiltig vid nästa tillägg.
+    MeasurementView measurementsView();
+
+    // Glidande fönster över de behållna raderna, som i DataManager. out måste
+    // rymma SlidingWindowEngine::outputCount(size(), windowSize) respektive
+    // size() värden; tidsfönstret förutsätter att raderna kom i tidsordning.
+    size_t calculateMovingWindow(size_t windowSize, WindowAggregate aggregate, double* out);
+    size_t calculateMovingWindow(std::chrono::nanoseconds duration, WindowAggregate aggregate, double* out);
+};
+
+#endif // RETENTION_BUFFER_H
@@ -0,0 +1,162 @@
+#include "rollup.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const int64_t MINUTE_NS = 60LL * 1000000000LL;
+const int64_t HOUR_NS = 60 * MINUTE_NS;
+const int64_t DAY_NS = 24 * HOUR_NS;
+
+// Avrunda nedåt till en multipel av width, även för tider före 1970
+int64_t floorTo(int64_t timestampNs, int64_t width) {
+    int64_t remainder = timestampNs % width;
+    return remainder < 0 ? timestampNs - remainder - width : timestampNs - remainder;
+}
+
+int64_t ceilTo(int64_t timestampNs, int64_t width) {
+    int64_t start = floorTo(timestampNs, width);
+    return start == timestampNs ? start : start + width;
+}
+
+bool startsBefore(const RollupBucket& bucket, int64_t startNs) {
+    return bucket.startNs < startNs;
+}
+
+} // namespace
+
+int64_t rollupWidthNs(RollupTier tier) {
+    switch (tier) {
+        case RollupTier::Minute: return MINUTE_NS;
+        case RollupTier::Hour: return HOUR_NS;
+        case RollupTier::Day: return DAY_NS;
+    }
+    return MINUTE_NS;
+}
+
+const char* rollupTierName(RollupTier tier) {
+    switch (tier) {
+        case RollupTier::Minute: return "minute";
+        case RollupTier::Hour: return "hour";
+        case RollupTier::Day: return "day";
+    }
+    return "minute";
+}
+
+int64_t rollupBucketStart(RollupTier tier, int64_t timestampNs) {
+    return floorTo(timestampNs, rollupWidthNs(tier));
+}
+
+void Rollups::clear() {
+    for (auto& tier : tiers) {
+        tier.clear();
+    }
+}
+
+// Privat hjälpmetod: Slå ihop en delsammanfattning med facket som börjar
+// på startNs. Nya data hamnar nästan alltid i sista facket.
+void Rollups::mergeInto(RollupTier tier, int64_t startNs, const RunningStats& part, size_t rowOffset) {
+    vector<RollupBucket>& buckets = tiers[static_cast<size_t>(tier)];
+    if (!buckets.empty() && buckets.back().startNs == startNs) {
+        buckets.back().stats.merge(part, rowOffset);
+        return;
+    }
+    
+    auto position = buckets.end();
+    if (!buckets.empty() && buckets.back().startNs > startNs) {
+        position = lower_bound(buckets.begin(), buckets.end(), startNs, startsBefore);
+        if (position->startNs == startNs) {
+            position->stats.merge(part, rowOffset);
+            return;
+        }
+    }
+    RollupBucket bucket;
+    bucket.startNs = startNs;
+    bucket.stats.merge(part, rowOffset);
+    buckets.insert(position, bucket);
+}
+
+void Rollups::add(double value, int64_t timestampNs, size_t row) {
+    // Vanligast är att värdet hamnar i sista facket på alla nivåer; det
+    // avgörs med en subtraktion i stället för en division per nivå
+    RunningStats single;
+    single.addAt(value, row);
+    for (RollupTier tier : ROLLUP_TIERS) {
+        vector<RollupBucket>& buckets = tiers[static_cast<size_t>(tier)];
+        int64_t width = rollupWidthNs(tier);
+        if (!buckets.empty() && timestampNs >= buckets.back().startNs &&
+            timestampNs - buckets.back().startNs < width) {
+            buckets.back().stats.addAt(value, row);
+        } else {
+            mergeInto(tier, floorTo(timestampNs, width), single, 0);
+        }
+    }
+}
+
+// Batchen delas i följder inom samma minut; varje följd sammanfattas med
+// den vektoriserade kärnan och slås sedan ihop på alla tre nivåerna
+void Rollups::addBatch(const double* values, const int64_t* timestamps, size_t count, size_t rowOffset) {
+    size_t begin = 0;
+    while (begin < count) {
+        int64_t minute = floorTo(timestamps[begin], MINUTE_NS);
+        size_t end = begin + 1;
+        while (end < count && timestamps[end] >= minute && timestamps[end] - minute < MINUTE_NS) {
+            ++end;
+        }
+        
+        RunningStats run = summarizeValues(values + begin, end - begin);
+        size_t row = rowOffset + begin;
+        mergeInto(RollupTier::Minute, minute, run, row);
+        mergeInto(RollupTier::Hour, floorTo(minute, HOUR_NS), run, row);
+        mergeInto(RollupTier::Day, floorTo(minute, DAY_NS), run, row);
+        begin = end;
+    }
+}
+
+void Rollups::merge(const Rollups& other, size_t rowOffset) {
+    for (RollupTier tier : ROLLUP_TIERS) {
+        for (const RollupBucket& bucket : other.buckets(tier)) {
+            mergeInto(tier, bucket.startNs, bucket.stats, rowOffset);
+        }
+    }
+}
+
+const vector<RollupBucket>& Rollups::buckets(RollupTier tier) const {
+    return tiers[static_cast<size_t>(tier)];
+}
+
+void Rollups::assign(RollupTier tier, const RollupBucket* buckets, size_t count) {
+    tiers[static_cast<size_t>(tier)].assign(buckets, buckets + count);
+}
+
+RunningStats Rollups::combine(RollupTier tier, int64_t startNs, int64_t endNs) const {
+    const vector<RollupBucket>& buckets = tiers[static_cast<size_t>(tier)];
+    RunningStats total;
+    for (auto it = lower_bound(buckets.begin(), buckets.end(), startNs, startsBefore);
+         it != buckets.end() && it->startNs < endNs; ++it) {
+        total.merge(it->stats);
+    }
+    return total;
+}
+
+// Dela intervallet i minuter fram till första hela timmen, timmar fram
+// till första hela dygnet, hela dygn, och samma sak baklänges mot slutet.
+// Ett år kostar då högst omkring 365 + 2 * (23 + 59) fack.
+RunningStats Rollups::combineRange(int64_t startNs, int64_t endNs) const {
+    RunningStats total;
+    if (startNs >= endNs) {
+        return total;
+    }
+    int64_t hourStart = min(ceilTo(startNs, HOUR_NS), endNs);
+    int64_t hourEnd = max(floorTo(endNs, HOUR_NS), hourStart);
+    int64_t dayStart = min(ceilTo(hourStart, DAY_NS), hourEnd);
+    int64_t dayEnd = max(floorTo(hourEnd, DAY_NS), dayStart);
+    
+    total.merge(combine(RollupTier::Minute, startNs, hourStart));
+    total.merge(combine(RollupTier::Hour, hourStart, dayStart));
+    total.merge(combine(RollupTier::Day, dayStart, dayEnd));
+    total.merge(combine(RollupTier::Hour, dayEnd, hourEnd));
+    total.merge(combine(RollupTier::Minute, hourEnd, endNs));
+    return total;
+}
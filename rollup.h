@@ -0,0 +1,70 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include "stats_kernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Förberäknade aggregat per minut, timme och dygn.
+//
+// Varje nivå är en vektor av fack sorterade efter starttid. Ett fack har
+// samma sammanfattning som hela datan (antal, summa, min/max, M2), så fack
+// kan slås ihop exakt och statistik för ett tidsintervall räknas fram ur
+// ett fåtal fack i stället för alla rådata. Fackgränserna ligger på hela
+// minuter, timmar och dygn i UTC.
+
+enum class RollupTier {
+    Minute,
+    Hour,
+    Day
+};
+
+const size_t ROLLUP_TIER_COUNT = 3;
+const RollupTier ROLLUP_TIERS[ROLLUP_TIER_COUNT] = { RollupTier::Minute, RollupTier::Hour, RollupTier::Day };
+
+// Fackbredd i nanosekunder
+std::int64_t rollupWidthNs(RollupTier tier);
+const char* rollupTierName(RollupTier tier);
+// Början på det fack som innehåller tidpunkten
+std::int64_t rollupBucketStart(RollupTier tier, std::int64_t timestampNs);
+
+// Ett fack; indexen i stats är radnummer i hela lagret.
+// Skrivs som det är i snapshots (version 2).
+struct RollupBucket {
+    std::int64_t startNs;
+    RunningStats stats;
+};
+
+class Rollups {
+private:
+    std::vector<RollupBucket> tiers[ROLLUP_TIER_COUNT];
+
+    void mergeInto(RollupTier tier, std::int64_t startNs, const RunningStats& part, size_t rowOffset);
+
+public:
+    void clear();
+    bool empty() const { return tiers[0].empty(); }
+
+    // Lägg till värden; row/rowOffset är radnumret i lagret. Tidsstämplar i
+    // stigande ordning är snabbast, men alla ordningar ger samma fack.
+    void add(double value, std::int64_t timestampNs, size_t row);
+    void addBatch(const double* values, const std::int64_t* timestamps, size_t count, size_t rowOffset);
+
+    // Slå ihop en annan uppsättning vars rader börjar på rowOffset
+    void merge(const Rollups& other, size_t rowOffset);
+
+    const std::vector<RollupBucket>& buckets(RollupTier tier) const;
+    // Ersätt en nivå, t.ex. med fack inlästa från en snapshot
+    void assign(RollupTier tier, const RollupBucket* buckets, size_t count);
+
+    // Sammanfatta alla fack i nivån som börjar inom [startNs, endNs)
+    RunningStats combine(RollupTier tier, std::int64_t startNs, std::int64_t endNs) const;
+
+    // Sammanfatta [startNs, endNs) med så få fack som möjligt: dygn i
+    // mitten, timmar och minuter mot kanterna. Gränserna måste ligga på
+    // hela minuter; delar av minuter får anroparen räkna ur rådata.
+    RunningStats combineRange(std::int64_t startNs, std::int64_t endNs) const;
+};
+
+#endif // ROLLUP_H
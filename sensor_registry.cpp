@@ -0,0 +1,83 @@
+#include "sensor_registry.h"
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const uint32_t EMPTY_SLOT = UINT32_MAX;
+const size_t INITIAL_SLOTS = 64;
+
+} // namespace
+
+const uint32_t SensorRegistry::DEFAULT_SENSOR;
+const char* const SensorRegistry::DEFAULT_SENSOR_NAME = "default";
+
+SensorRegistry::SensorRegistry() {
+    clear();
+}
+
+// FNV-1a följt av en avslutande blandning så att även de låga bitarna
+// (som väljer plats) beror på hela namnet
+uint64_t SensorRegistry::hash(const char* name, size_t length) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(name[i]);
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Platsen där namnet ligger, eller den lediga plats där det ska in
+size_t SensorRegistry::findSlot(const char* name, size_t length, uint64_t hashValue) const {
+    size_t mask = slots.size() - 1;
+    uint32_t tag = static_cast<uint32_t>(hashValue >> 32);
+    for (size_t i = hashValue & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.id == EMPTY_SLOT) return i;
+        if (slot.tag == tag) {
+            const string& candidate = names[slot.id];
+            if (candidate.size() == length && memcmp(candidate.data(), name, length) == 0) return i;
+        }
+    }
+}
+
+// Dubbla tabellen och lägg in alla namn på nytt
+void SensorRegistry::grow() {
+    vector<Slot> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, Slot{ EMPTY_SLOT, 0 });
+    for (const Slot& slot : old) {
+        if (slot.id == EMPTY_SLOT) continue;
+        const string& existing = names[slot.id];
+        slots[findSlot(existing.data(), existing.size(), hash(existing.data(), existing.size()))] = slot;
+    }
+}
+
+uint32_t SensorRegistry::intern(const char* name, size_t length) {
+    uint64_t hashValue = hash(name, length);
+    size_t index = findSlot(name, length, hashValue);
+    if (slots[index].id != EMPTY_SLOT) return slots[index].id;
+
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.emplace_back(name, length);
+    slots[index] = Slot{ id, static_cast<uint32_t>(hashValue >> 32) };
+    if (names.size() * 2 > slots.size()) grow();
+    return id;
+}
+
+bool SensorRegistry::find(const string& name, uint32_t& id) const {
+    const Slot& slot = slots[findSlot(name.data(), name.size(), hash(name.data(), name.size()))];
+    if (slot.id == EMPTY_SLOT) return false;
+    id = slot.id;
+    return true;
+}
+
+void SensorRegistry::clear() {
+    names.clear();
+    slots.assign(INITIAL_SLOTS, Slot{ EMPTY_SLOT, 0 });
+    intern(DEFAULT_SENSOR_NAME, strlen(DEFAULT_SENSOR_NAME));
+}
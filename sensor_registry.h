@@ -0,0 +1,52 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sensor- eller kanalnamn som täta heltals-id (0, 1, 2, ...), så att
+// lagret kan indexera sina partitioner direkt med id:t.
+//
+// Uppslagningen är en platt hashtabell med öppen adressering och linjär
+// sondering: en enda vektor av platser, inga noder per namn. Varje plats
+// sparar id:t och de övre bitarna av hashen, så att strängar bara
+// jämförs när hashen redan stämmer. Tabellen hålls högst halvfull.
+//
+// Id 0 är alltid sensorn "default", som rader utan sensorkolumn hamnar på.
+// Namn får inte innehålla kommatecken eller radbrytningar (CSV).
+class SensorRegistry {
+private:
+    struct Slot {
+        std::uint32_t id;    // EMPTY_SLOT om platsen är ledig
+        std::uint32_t tag;   // Hashens övre 32 bitar
+    };
+
+    std::vector<std::string> names;   // Index = id
+    std::vector<Slot> slots;          // Storlek 2^k
+
+    static std::uint64_t hash(const char* name, size_t length);
+    size_t findSlot(const char* name, size_t length, std::uint64_t hashValue) const;
+    void grow();
+
+public:
+    static const std::uint32_t DEFAULT_SENSOR = 0;
+    static const char* const DEFAULT_SENSOR_NAME;
+
+    SensorRegistry();
+
+    // Id för namnet; ett nytt id delas ut första gången namnet ses
+    std::uint32_t intern(const char* name, size_t length);
+    std::uint32_t intern(const std::string& name) { return intern(name.data(), name.size()); }
+    // Slå upp utan att lägga till; false om namnet är okänt
+    bool find(const std::string& name, std::uint32_t& id) const;
+
+    const std::string& name(std::uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    // Glöm alla namn utom "default"
+    void clear();
+};
+
+#endif // SENSOR_REGISTRY_H
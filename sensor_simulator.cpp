@@ -0,0 +1,216 @@
+#include "sensor_simulator.h"
+#include "archive.h"
+#include "csv_writer.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const int64_t NS_PER_HOUR = 3600LL * 1000000000LL;
+const int64_t NS_PER_DAY = 24 * NS_PER_HOUR;
+
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Positiv rest, även för tider före epoch
+int64_t positiveModulo(int64_t x, int64_t m) {
+    int64_t r = x % m;
+    return r < 0 ? r + m : r;
+}
+
+// Ungefär normalfördelat brus med medelvärde 0 och standardavvikelse 1:
+// summan av fyra likformiga 16-bitarstal ur en enda dragning (Irwin-Hall).
+// Fördelningen är begränsad till ±3.5 standardavvikelser, vilket räcker för
+// mätbrus; större avvikelser kommer från spikarna. Log och sqrt per värde
+// skulle kosta flera gånger mer än allt annat i generatorn.
+double approximateNormal(Xoshiro256& generator) {
+    uint64_t bits = generator.next();
+    uint64_t sum = (bits & 0xffff) + ((bits >> 16) & 0xffff) + ((bits >> 32) & 0xffff) + (bits >> 48);
+    // Summan har medelvärdet 2 * 65535 och variansen 4 * (65536^2 - 1) / 12
+    return (static_cast<double>(sum) - 131070.0) * (1.7320508075688772 / 65536.0);
+}
+
+// Avbrott: ett avbrott börjar med en sannolikhet som ger den önskade
+// andelen saknade rader och varar i genomsnitt dropoutLength rader
+class DropoutProcess {
+private:
+    Xoshiro256 generator;
+    double startProbability;
+    double extraLength;
+    size_t remaining;
+
+public:
+    DropoutProcess(uint64_t seed, const SimulationProfile& profile)
+        : generator(seed), startProbability(0), extraLength(max(profile.dropoutLength, 1.0) - 1.0), remaining(0) {
+        double rate = min(max(profile.dropoutRate, 0.0), 1.0);
+        double length = extraLength + 1.0;
+        startProbability = rate / (length * (1.0 - rate) + rate);
+    }
+
+    bool dropped() {
+        if (remaining > 0) {
+            --remaining;
+            return true;
+        }
+        if (startProbability <= 0 || generator.nextDouble() >= startProbability) return false;
+        // Exponentiellt fördelad längd, avrundad till hela rader
+        remaining = static_cast<size_t>(-log(1.0 - generator.nextDouble()) * extraLength + 0.5);
+        return true;
+    }
+};
+
+} // namespace
+
+Xoshiro256::Xoshiro256(uint64_t seed) {
+    for (uint64_t& word : state) word = splitmix64(seed);
+}
+
+SimulationProfile::SimulationProfile()
+    : seed(1), startNs(1704067200LL * 1000000000LL), intervalNs(1000000000LL), baseline(22.0), driftPerDay(0.0),
+      diurnalAmplitude(2.0), noise(0.2), spikeRate(0.0005), spikeMagnitude(10.0), dropoutRate(0.001),
+      dropoutLength(30.0), resolution(0.01) {
+}
+
+SensorSimulator::SensorSimulator(const SimulationProfile& profile, size_t count)
+    : profile(profile), slotCount(count) {
+    if (this->profile.intervalNs <= 0) this->profile.intervalNs = 1;
+}
+
+size_t SensorSimulator::blockCount() const {
+    return ThreadPool::chunkCount(slotCount, SIMULATION_BLOCK_ROWS);
+}
+
+size_t SensorSimulator::slotsInBlock(size_t block) const {
+    return min(SIMULATION_BLOCK_ROWS, slotCount - block * SIMULATION_BLOCK_ROWS);
+}
+
+// Ett frö per block och ström (0 = värden, 1 = avbrott)
+uint64_t SensorSimulator::blockSeed(size_t block, uint64_t stream) const {
+    uint64_t x = profile.seed ^ (0xD1B54A32D192ED03ULL * (static_cast<uint64_t>(block) * 2 + stream + 1));
+    return splitmix64(x);
+}
+
+size_t SensorSimulator::blockRows(size_t block) const {
+    size_t slots = slotsInBlock(block);
+    if (profile.dropoutRate <= 0) return slots;
+    DropoutProcess dropouts(blockSeed(block, 1), profile);
+    size_t rows = 0;
+    for (size_t i = 0; i < slots; ++i) rows += !dropouts.dropped();
+    return rows;
+}
+
+size_t SensorSimulator::generateBlock(size_t block, double* values, int64_t* timestamps) const {
+    size_t first = block * SIMULATION_BLOCK_ROWS;
+    size_t slots = slotsInBlock(block);
+    Xoshiro256 generator(blockSeed(block, 0));
+    DropoutProcess dropouts(blockSeed(block, 1), profile);
+
+    // Dygnscykeln roteras fram en fast vinkel per rad i stället för ett
+    // sin()-anrop per rad; topp kl. 15 UTC
+    int64_t firstNs = profile.startNs + static_cast<int64_t>(first) * profile.intervalNs;
+    double angle = 2 * PI * positiveModulo(firstNs - 9 * NS_PER_HOUR, NS_PER_DAY) / NS_PER_DAY;
+    double step = 2 * PI * positiveModulo(profile.intervalNs, NS_PER_DAY) / NS_PER_DAY;
+    double sine = sin(angle), cosine = cos(angle);
+    const double stepSine = sin(step), stepCosine = cos(step);
+    const double driftPerRow = profile.driftPerDay * profile.intervalNs / NS_PER_DAY;
+    const double scale = profile.resolution > 0 ? 1.0 / profile.resolution : 0.0;
+    const bool diurnal = profile.diurnalAmplitude != 0;
+
+    size_t rows = 0;
+    for (size_t i = 0; i < slots; ++i) {
+        if (!dropouts.dropped()) {
+            double value = profile.baseline + driftPerRow * static_cast<double>(first + i);
+            if (diurnal) value += profile.diurnalAmplitude * sine;
+            if (profile.noise > 0) value += profile.noise * approximateNormal(generator);
+            if (profile.spikeRate > 0 && generator.nextDouble() < profile.spikeRate) {
+                value += (generator.next() & 1) ? profile.spikeMagnitude : -profile.spikeMagnitude;
+            }
+            // Division med den inverterade upplösningen ger det närmaste
+            // talet, t.ex. 25.07 och inte 25.070000000000004
+            if (scale > 0) value = round(value * scale) / scale;
+            values[rows] = value;
+            timestamps[rows] = firstNs + static_cast<int64_t>(i) * profile.intervalNs;
+            ++rows;
+        }
+        if (diurnal) {
+            double nextSine = sine * stepCosine + cosine * stepSine;
+            cosine = cosine * stepCosine - sine * stepSine;
+            sine = nextSine;
+        }
+    }
+    return rows;
+}
+
+void SensorSimulator::forEachBatch(ThreadPool* pool, const BatchSink& sink) const {
+    size_t blocks = blockCount();
+    size_t group = pool != nullptr ? min<size_t>(blocks, pool->size() * 2) : 1;
+    vector<vector<double>> values(group, vector<double>(min(slotCount, SIMULATION_BLOCK_ROWS)));
+    vector<vector<int64_t>> timestamps(group, vector<int64_t>(min(slotCount, SIMULATION_BLOCK_ROWS)));
+    vector<size_t> rows(group);
+    for (size_t firstBlock = 0; firstBlock < blocks; firstBlock += group) {
+        size_t count = min(group, blocks - firstBlock);
+        auto generate = [&](size_t k) {
+            rows[k] = generateBlock(firstBlock + k, values[k].data(), timestamps[k].data());
+        };
+        if (pool != nullptr) {
+            pool->run(count, generate);
+        } else {
+            generate(0);
+        }
+        for (size_t k = 0; k < count; ++k) {
+            if (rows[k] > 0) sink(values[k].data(), timestamps[k].data(), rows[k]);
+        }
+    }
+}
+
+bool SensorSimulator::saveToFile(const string& filename, TimeMode timeMode, ThreadPool* pool) const {
+    const string extension = ARCHIVE_EXTENSION;
+    if (filename.size() > extension.size() &&
+        filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0) {
+        IOT_TIME_OPERATION(SaveArchive);
+        ArchiveWriter writer;
+        string error;
+        if (!writer.create(filename, error)) {
+            cerr << "Error: Could not write archive " << filename << ": " << error << endl;
+            return false;
+        }
+        forEachBatch(pool, [&writer](const double* values, const int64_t* timestamps, size_t count) {
+            writer.writeBlock(values, timestamps, count);
+        });
+        if (!writer.close()) {
+            cerr << "Error: Could not write archive " << filename << endl;
+            return false;
+        }
+        return true;
+    }
+
+    IOT_TIME_OPERATION(SaveCsv);
+    CsvWriter writer;
+    writer.setTimeMode(timeMode);
+    if (filename == "-") {
+        writer.attach(stdout);
+    } else if (!writer.open(filename)) {
+        cerr << "Error: Could not open file for writing: " << filename << endl;
+        return false;
+    }
+    writer.writeHeader();
+    forEachBatch(pool, [&writer](const double* values, const int64_t* timestamps, size_t count) {
+        writer.writeRows(values, timestamps, count);
+    });
+    if (!writer.close()) {
+        cerr << "Error: Could not write file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
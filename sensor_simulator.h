@@ -0,0 +1,102 @@
+#ifndef SENSOR_SIMULATOR_H
+#define SENSOR_SIMULATOR_H
+
+#include "time_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class ThreadPool;
+
+// Simulerade mätserier för lasttester.
+//
+// Tidsaxeln är jämnt samplad: rad i har tidsstämpeln startNs + i * intervalNs.
+// Värdet är baslinjen plus linjär drift, en dygnscykel, ungefär normalfördelat brus
+// och sällsynta spikar. Avbrott tar bort sammanhängande rader, så att det
+// blir luckor i tidsaxeln som hos en sensor som tappar kontakten.
+//
+// Raderna delas i block om SIMULATION_BLOCK_ROWS. Varje block har egna
+// slumpgeneratorer som seedas från fröet och blockets nummer, så samma
+// frö ger samma serie oavsett antal trådar och oavsett om serien hålls i
+// minnet (DataManager::simulate) eller skrivs direkt till fil.
+
+const size_t SIMULATION_BLOCK_ROWS = 1 << 16;
+
+// xoshiro256** (Blackman och Vigna). Tillståndet seedas med splitmix64,
+// så närliggande frön ger oberoende strömmar.
+class Xoshiro256 {
+private:
+    std::uint64_t state[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    explicit Xoshiro256(std::uint64_t seed);
+
+    std::uint64_t next() {
+        std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Likformigt i [0, 1) med 53 bitars upplösning
+    double nextDouble() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+struct SimulationProfile {
+    std::uint64_t seed;
+    std::int64_t startNs;          // Första radens tidsstämpel, nanosekunder sedan epoch
+    std::int64_t intervalNs;       // Avstånd mellan raderna (> 0)
+    double baseline;
+    double driftPerDay;            // Linjär förändring per dygn
+    double diurnalAmplitude;       // Dygnscykel med topp kl. 15 och botten kl. 03 UTC
+    double noise;                  // Brusets standardavvikelse
+    double spikeRate;              // Andel rader med en spik
+    double spikeMagnitude;         // Spikens storlek; tecknet slumpas
+    double dropoutRate;            // Ungefärlig andel rader som saknas
+    double dropoutLength;          // Medellängd för ett avbrott, i rader (>= 1)
+    double resolution;             // Värdena avrundas till multiplar av denna; 0 = ingen avrundning
+
+    // En inomhussensor: 22 grader, en sampling per sekund från 2024-01-01 UTC
+    SimulationProfile();
+};
+
+class SensorSimulator {
+public:
+    typedef std::function<void(const double* values, const std::int64_t* timestamps,
+                               size_t count)> BatchSink;
+
+private:
+    SimulationProfile profile;
+    size_t slotCount;    // Rader på tidsaxeln, före avbrott
+
+    size_t slotsInBlock(size_t block) const;
+    std::uint64_t blockSeed(size_t block, std::uint64_t stream) const;
+
+public:
+    SensorSimulator(const SimulationProfile& profile, size_t count);
+
+    size_t blockCount() const;
+    // Antal rader som blir kvar i blocket efter avbrotten
+    size_t blockRows(size_t block) const;
+    // Skriv blockets rader till buffertar som rymmer blockRows(block) rader;
+    // returnerar antalet
+    size_t generateBlock(size_t block, double* values, std::int64_t* timestamps) const;
+
+    // Alla rader i ordning, ett block per anrop. Med pool genereras en
+    // grupp block i taget parallellt, så minnet förblir begränsat.
+    void forEachBatch(ThreadPool* pool, const BatchSink& sink) const;
+
+    // Strömma serien till fil utan att hålla den i minnet: arkiv (.arc)
+    // eller CSV ("-" betyder standard ut)
+    bool saveToFile(const std::string& filename, TimeMode timeMode, ThreadPool* pool) const;
+};
+
+#endif // SENSOR_SIMULATOR_H
@@ -0,0 +1,335 @@
+#include "sensor_store.h"
+#include "archive.h"
+#include "csv_reader.h"
+#include "csv_writer.h"
+#include "metrics.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+// Under denna totala storlek körs frågor över flera sensorer seriellt
+const size_t PARALLEL_CUTOFF = 1 << 20;
+
+// Kortare följder läggs till värde för värde i stället för med statistikkärnan
+const size_t SMALL_RUN = 32;
+
+} // namespace
+
+SensorStore::SensorStore() : measurementCount(0), timeMode(TimeMode::Local) {
+}
+
+// Privat hjälpmetod: Sensorns partition, skapas vid behov
+SensorStore::Partition& SensorStore::partitionFor(uint32_t sensor) {
+    if (sensor >= partitions.size()) {
+        partitions.resize(sensor + 1);
+    }
+    return partitions[sensor];
+}
+
+ThreadPool* SensorStore::parallelPool(size_t count) const {
+    if (!threadPool || threadPool->size() <= 1 || count < PARALLEL_CUTOFF) {
+        return nullptr;
+    }
+    return threadPool.get();
+}
+
+uint32_t SensorStore::sensorId(const string& name) {
+    return sensors.intern(name);
+}
+
+bool SensorStore::findSensor(const string& name, uint32_t& id) const {
+    return sensors.find(name, id);
+}
+
+const string& SensorStore::sensorName(uint32_t id) const {
+    return sensors.name(id);
+}
+
+size_t SensorStore::getSensorCount() const {
+    return sensors.size();
+}
+
+void SensorStore::addMeasurement(uint32_t sensor, double value, chrono::system_clock::time_point timestamp) {
+    IOT_COUNT(MeasurementsAdded, 1);
+    Partition& partition = partitionFor(sensor);
+    partition.stats.addAt(value, partition.values.size());
+    partition.values.push_back(value);
+    partition.timestamps.push_back(toEpochNanoseconds(timestamp));
+    ++measurementCount;
+}
+
+void SensorStore::appendBatch(uint32_t sensor, const double* values, const int64_t* timestamps, size_t count) {
+    if (count == 0) return;
+    IOT_COUNT(MeasurementsAdded, count);
+    Partition& partition = partitionFor(sensor);
+    size_t offset = partition.values.size();
+    if (count < SMALL_RUN) {
+        for (size_t i = 0; i < count; ++i) partition.stats.addAt(values[i], offset + i);
+    } else {
+        partition.stats.merge(summarizeValues(values, count), offset);
+    }
+    partition.values.insert(partition.values.end(), values, values + count);
+    partition.timestamps.insert(partition.timestamps.end(), timestamps, timestamps + count);
+    measurementCount += count;
+}
+
+void SensorStore::appendBatch(const uint32_t* sensorIds, const double* values, const int64_t* timestamps,
+                              size_t count) {
+    if (count == 0) return;
+    IOT_TIME_OPERATION(AppendBatch);
+    size_t begin = 0;
+    while (begin < count) {
+        size_t end = begin + 1;
+        while (end < count && sensorIds[end] == sensorIds[begin]) ++end;
+        appendBatch(sensorIds[begin], values + begin, timestamps + begin, end - begin);
+        begin = end;
+    }
+}
+
+void SensorStore::clearAllMeasurements() {
+    sensors.clear();
+    partitions.clear();
+    measurementCount = 0;
+}
+
+size_t SensorStore::getMeasurementCount() const {
+    return measurementCount;
+}
+
+size_t SensorStore::getMeasurementCount(uint32_t sensor) const {
+    return sensor < partitions.size() ? partitions[sensor].values.size() : 0;
+}
+
+bool SensorStore::loadFromFile(const string& filename) {
+    lastLoadReport = CsvLoadReport();
+
+    // Snapshots och arkiv har ingen sensorkolumn; allt hamnar på "default".
+    // Lagret rensas först när filen har kunnat läsas.
+    if (filename != DataManager::STANDARD_STREAM && (isSnapshotFile(filename) || isArchiveFile(filename))) {
+        DataManager single;
+        bool loaded = single.loadFromFile(filename);
+        if (single.getLastLoadReport().failed) {
+            lastLoadReport.failed = true;
+            return false;
+        }
+        clearAllMeasurements();
+        if (!loaded) return false;
+        MeasurementView view = single.measurementsView();
+        appendBatch(SensorRegistry::DEFAULT_SENSOR, view.valueData(), view.timestampData(), view.size());
+        lastLoadReport.rowsLoaded = view.size();
+        return view.size() > 0;
+    }
+
+    FILE* file = stdin;
+    if (filename != DataManager::STANDARD_STREAM) {
+        file = fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            cerr << "Error: Could not open file for reading: " << filename << endl;
+            lastLoadReport.failed = true;
+            return false;
+        }
+    }
+    clearAllMeasurements();
+
+    CsvReader reader;
+    reader.setTimeMode(timeMode);
+    CsvReader::SensorBatchSink sink =
+        [this](const uint32_t* sensorIds, const double* values, const int64_t* timestamps, size_t count) {
+            appendBatch(sensorIds, values, timestamps, count);
+        };
+    reader.readStream(file, sensors, sink, lastLoadReport);
+    if (file != stdin) fclose(file);
+
+    if (lastLoadReport.parseErrors > 0) {
+        cerr << "Warning: Skipped " << lastLoadReport.parseErrors << " unparseable line(s) in "
+             << filename << " (first at line " << lastLoadReport.firstErrorLine << ": "
+             << lastLoadReport.firstErrorText << ")" << endl;
+    }
+    return lastLoadReport.rowsLoaded > 0;
+}
+
+bool SensorStore::saveToFile(const string& filename) const {
+    auto hasExtension = [&filename](const string& extension) {
+        return filename.size() > extension.size() &&
+               filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+    };
+    if (hasExtension(DataManager::SNAPSHOT_EXTENSION) || hasExtension(ARCHIVE_EXTENSION)) {
+        cerr << "Error: Snapshots and archives have no sensor column; save sensor data as CSV: " << filename
+             << endl;
+        return false;
+    }
+
+    IOT_TIME_OPERATION(SaveCsv);
+    CsvWriter writer;
+    writer.setTimeMode(timeMode);
+    if (filename == DataManager::STANDARD_STREAM) {
+        writer.attach(stdout);
+    } else if (!writer.open(filename)) {
+        cerr << "Error: Could not open file for writing: " << filename << endl;
+        return false;
+    }
+
+    writer.writeSensorHeader();
+    for (uint32_t sensor = 0; sensor < partitions.size(); ++sensor) {
+        const Partition& partition = partitions[sensor];
+        const string& name = sensors.name(sensor);
+        for (size_t i = 0; i < partition.values.size(); ++i) {
+            writer.writeRow(partition.timestamps[i], name, partition.values[i]);
+        }
+    }
+
+    if (!writer.close()) {
+        cerr << "Error: Could not write file: " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+const CsvLoadReport& SensorStore::getLastLoadReport() const {
+    return lastLoadReport;
+}
+
+void SensorStore::setTimeMode(TimeMode mode) {
+    timeMode = mode;
+}
+
+TimeMode SensorStore::getTimeMode() const {
+    return timeMode;
+}
+
+void SensorStore::setThreadCount(unsigned threads) {
+    if (threads == 1) {
+        threadPool.reset();
+    } else if (!threadPool || threads == 0 || threadPool->size() != threads) {
+        threadPool = make_shared<ThreadPool>(threads);
+    }
+}
+
+MeasurementView SensorStore::measurementsView(uint32_t sensor) const {
+    if (sensor >= partitions.size()) return MeasurementView();
+    const Partition& partition = partitions[sensor];
+    return MeasurementView(partition.values.data(), partition.timestamps.data(), partition.values.size(), sensor);
+}
+
+void SensorStore::copySensorTo(uint32_t sensor, DataManager& target) const {
+    MeasurementView view = measurementsView(sensor);
+    target.appendBatch(view.valueData(), view.timestampData(), view.size());
+}
+
+SensorStore::Statistics SensorStore::calculateStatistics(uint32_t sensor) const {
+    if (sensor >= partitions.size()) return Statistics();
+    return DataManager::toStatistics(partitions[sensor].stats);
+}
+
+size_t SensorStore::countAboveThreshold(uint32_t sensor, double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    MeasurementView view = measurementsView(sensor);
+    return count_if(view.valueData(), view.valueData() + view.size(),
+                    [threshold](double v) { return v > threshold; });
+}
+
+size_t SensorStore::countBelowThreshold(uint32_t sensor, double threshold) const {
+    IOT_TIME_OPERATION(Threshold);
+    MeasurementView view = measurementsView(sensor);
+    return count_if(view.valueData(), view.valueData() + view.size(),
+                    [threshold](double v) { return v <= threshold; });
+}
+
+Histogram SensorStore::generateHistogram(uint32_t sensor, double lowerBound, double binWidth,
+                                         size_t binCount) const {
+    IOT_TIME_OPERATION(Histogram);
+    Histogram histogram(lowerBound, binWidth, binCount);
+    MeasurementView view = measurementsView(sensor);
+    histogram.addRange(view.valueData(), view.size());
+    return histogram;
+}
+
+// Aggregaten slås ihop utan att någon rad läses
+SensorStore::Statistics SensorStore::calculateStatistics(const vector<uint32_t>& sensorIds) const {
+    RunningStats merged;
+    for (uint32_t sensor : sensorIds) {
+        if (sensor < partitions.size()) merged.merge(partitions[sensor].stats);
+    }
+    Statistics stats = DataManager::toStatistics(merged);
+    stats.minIndex = stats.maxIndex = Statistics::NO_INDEX;
+    return stats;
+}
+
+size_t SensorStore::countAboveThreshold(const vector<uint32_t>& sensorIds, double threshold) const {
+    size_t total = 0;
+    for (uint32_t sensor : sensorIds) total += countAboveThreshold(sensor, threshold);
+    return total;
+}
+
+size_t SensorStore::countBelowThreshold(const vector<uint32_t>& sensorIds, double threshold) const {
+    size_t total = 0;
+    for (uint32_t sensor : sensorIds) total += countBelowThreshold(sensor, threshold);
+    return total;
+}
+
+// Ett delhistogram per tråd; sensorerna fördelas mellan trådarna
+Histogram SensorStore::generateHistogram(const vector<uint32_t>& sensorIds, double lowerBound, double binWidth,
+                                         size_t binCount) const {
+    IOT_TIME_OPERATION(Histogram);
+    Histogram histogram(lowerBound, binWidth, binCount);
+    size_t rows = 0;
+    for (uint32_t sensor : sensorIds) rows += getMeasurementCount(sensor);
+    ThreadPool* pool = parallelPool(rows);
+    if (pool == nullptr) {
+        for (uint32_t sensor : sensorIds) {
+            MeasurementView view = measurementsView(sensor);
+            histogram.addRange(view.valueData(), view.size());
+        }
+        return histogram;
+    }
+
+    size_t workers = min<size_t>(pool->size(), sensorIds.size());
+    vector<Histogram> parts(workers, histogram);
+    pool->run(workers, [&](size_t worker) {
+        for (size_t i = worker; i < sensorIds.size(); i += workers) {
+            MeasurementView view = measurementsView(sensorIds[i]);
+            parts[worker].addRange(view.valueData(), view.size());
+        }
+    });
+    for (const Histogram& part : parts) {
+        histogram.merge(part);
+    }
+    return histogram;
+}
+
+vector<SensorStore::SensorSummary> SensorStore::summarizeBySensor(const vector<double>& thresholds) const {
+    IOT_TIME_OPERATION(GroupBySensor);
+    vector<SensorSummary> summaries;
+    for (uint32_t sensor = 0; sensor < partitions.size(); ++sensor) {
+        if (partitions[sensor].values.empty()) continue;
+        SensorSummary summary;
+        summary.sensor = sensor;
+        summary.stats = DataManager::toStatistics(partitions[sensor].stats);
+        summary.aboveCounts.assign(thresholds.size(), 0);
+        summaries.push_back(move(summary));
+    }
+    if (thresholds.empty()) return summaries;
+
+    // Varje partition läses en gång för alla trösklar
+    auto countSensor = [&](size_t position) {
+        SensorSummary& summary = summaries[position];
+        const vector<double>& values = partitions[summary.sensor].values;
+        for (double value : values) {
+            for (size_t t = 0; t < thresholds.size(); ++t) {
+                summary.aboveCounts[t] += value > thresholds[t];
+            }
+        }
+    };
+    ThreadPool* pool = parallelPool(measurementCount);
+    if (pool == nullptr) {
+        for (size_t position = 0; position < summaries.size(); ++position) countSensor(position);
+    } else {
+        pool->run(summaries.size(), countSensor);
+    }
+    return summaries;
+}
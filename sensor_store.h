@@ -0,0 +1,117 @@
+#ifndef SENSOR_STORE_H
+#define SENSOR_STORE_H
+
+#include "data_manager.h"
+#include "histogram.h"
+#include "measurement_view.h"
+#include "sensor_registry.h"
+#include "stats_kernel.h"
+#include "thread_pool.h"
+#include "time_codec.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Mätvärden från många sensorer i ett lager, partitionerat per sensor.
+//
+// Sensornamnen slås upp i SensorRegistry (en platt hashtabell) och ger
+// ett tätt id som direkt indexerar en partition. Varje partition är
+// kolumnlagrad som DataManager (värden och tidsstämplar i egna vektorer)
+// och har egna löpande aggregat. Frågor om en eller några sensorer läser
+// därför bara de sensorernas kolumner, och statistik per sensor kostar
+// O(1) utan att läsa någon data alls.
+//
+// För fönster, tidsintervall och övrig analys av en enskild sensor kan
+// partitionen kopieras till en DataManager med copySensorTo().
+class SensorStore {
+public:
+    typedef DataManager::Statistics Statistics;
+
+    // En rad i summarizeBySensor()
+    struct SensorSummary {
+        std::uint32_t sensor;
+        Statistics stats;                  // Index är rader inom sensorn
+        std::vector<size_t> aboveCounts;   // Antal värden > varje tröskel
+    };
+
+private:
+    struct Partition {
+        std::vector<double> values;
+        std::vector<std::int64_t> timestamps;   // Nanosekunder sedan epoch
+        RunningStats stats;
+    };
+
+    SensorRegistry sensors;
+    std::vector<Partition> partitions;   // Index = sensor-id
+    size_t measurementCount;
+
+    std::shared_ptr<ThreadPool> threadPool;
+    CsvLoadReport lastLoadReport;
+    TimeMode timeMode;
+
+    Partition& partitionFor(std::uint32_t sensor);
+    ThreadPool* parallelPool(size_t count) const;
+
+public:
+    SensorStore();
+
+    // Sensorer. sensorId() lägger till namnet om det är nytt.
+    std::uint32_t sensorId(const std::string& name);
+    bool findSensor(const std::string& name, std::uint32_t& id) const;
+    const std::string& sensorName(std::uint32_t id) const;
+    // Antal kända sensorer, inklusive "default" (id 0)
+    size_t getSensorCount() const;
+
+    // Tillägg. Raderna läggs sist i sensorns partition.
+    void addMeasurement(std::uint32_t sensor, double value, std::chrono::system_clock::time_point timestamp);
+    void appendBatch(std::uint32_t sensor, const double* values, const std::int64_t* timestamps, size_t count);
+    // Blandade sensorer, t.ex. en batch direkt från CsvReader. Följder av
+    // rader från samma sensor läggs till i ett svep.
+    void appendBatch(const std::uint32_t* sensorIds, const double* values, const std::int64_t* timestamps,
+                     size_t count);
+    void clearAllMeasurements();
+
+    size_t getMeasurementCount() const;
+    size_t getMeasurementCount(std::uint32_t sensor) const;
+
+    // CSV med kolumnerna "timestamp,sensor,value" (STANDARD_STREAM = stdin/stdout).
+    // Filer utan sensorkolumn, snapshots och arkiv läses in som sensorn "default".
+    // saveToFile skriver sensor för sensor och bara som CSV.
+    bool loadFromFile(const std::string& filename);
+    bool saveToFile(const std::string& filename) const;
+    const CsvLoadReport& getLastLoadReport() const;
+    void setTimeMode(TimeMode mode);
+    TimeMode getTimeMode() const;
+
+    // Trådar för summarizeBySensor och frågor över flera sensorer; 0 = alla kärnor
+    void setThreadCount(unsigned threads);
+
+    // Sensorns rader i ankomstordning, utan kopiering; ogiltig efter ändringar
+    MeasurementView measurementsView(std::uint32_t sensor) const;
+    // Lägg till sensorns rader i en DataManager
+    void copySensorTo(std::uint32_t sensor, DataManager& target) const;
+
+    // En sensor; läser bara sensorns partition
+    Statistics calculateStatistics(std::uint32_t sensor) const;
+    size_t countAboveThreshold(std::uint32_t sensor, double threshold) const;   // värde >  threshold
+    size_t countBelowThreshold(std::uint32_t sensor, double threshold) const;   // värde <= threshold
+    Histogram generateHistogram(std::uint32_t sensor, double lowerBound, double binWidth, size_t binCount) const;
+
+    // Flera sensorer tillsammans; övriga sensorer läses inte. Statistiken
+    // slås ihop exakt ur sensorernas aggregat, och minIndex/maxIndex är NO_INDEX
+    // eftersom radnummer bara gäller inom en sensor.
+    Statistics calculateStatistics(const std::vector<std::uint32_t>& sensorIds) const;
+    size_t countAboveThreshold(const std::vector<std::uint32_t>& sensorIds, double threshold) const;
+    size_t countBelowThreshold(const std::vector<std::uint32_t>& sensorIds, double threshold) const;
+    Histogram generateHistogram(const std::vector<std::uint32_t>& sensorIds, double lowerBound, double binWidth,
+                                size_t binCount) const;
+
+    // Gruppering per sensor i ett svep: en rad per sensor med mätvärden, i
+    // id-ordning. Statistiken läses ur aggregaten; för trösklarna läses
+    // varje partition en gång (parallellt över sensorer när datan är stor).
+    std::vector<SensorSummary> summarizeBySensor(const std::vector<double>& thresholds = {}) const;
+};
+
+#endif // SENSOR_STORE_H
@@ -0,0 +1,294 @@
+#include "sliding_window.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+// Hur ofta (i steg) löpande summor räknas om från grunden för att
+// hindra att avrundningsfel ackumuleras. Kostar högst ett extra värde
+// per steg i genomsnitt eftersom intervallet aldrig är kortare än fönstret.
+const size_t RESYNC_INTERVAL = 4096;
+
+// NaN och ±inf i fönstret. De hålls utanför de löpande summorna, som annars
+// skulle förbli NaN efter att värdet lämnat fönstret, och räknas i stället
+// per sort så att fönstret får samma resultat som en summering från grunden.
+struct NonFiniteCount {
+    size_t nan;
+    size_t positive;
+    size_t negative;
+    size_t total;
+
+    NonFiniteCount() : nan(0), positive(0), negative(0), total(0) {}
+
+    // Sant om x är ändligt och ska in i de löpande summorna
+    bool add(double x) {
+        if (isfinite(x)) return true;
+        if (isnan(x)) ++nan; else if (x > 0) ++positive; else ++negative;
+        ++total;
+        return false;
+    }
+
+    bool remove(double x) {
+        if (isfinite(x)) return true;
+        if (isnan(x)) --nan; else if (x > 0) --positive; else --negative;
+        --total;
+        return false;
+    }
+
+    // Summan av fönstret när det innehåller icke-ändliga värden
+    double sum() const {
+        if (nan > 0 || (positive > 0 && negative > 0)) return numeric_limits<double>::quiet_NaN();
+        return positive > 0 ? numeric_limits<double>::infinity() : -numeric_limits<double>::infinity();
+    }
+};
+
+// Medelvärde och M2 med Welfords uppdatering, även för borttagning
+struct WindowMoments {
+    size_t n;
+    double mean;
+    double m2;
+
+    WindowMoments() : n(0), mean(0), m2(0) {}
+
+    void add(double x) {
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    void remove(double x) {
+        if (n <= 1) {
+            *this = WindowMoments();
+            return;
+        }
+        --n;
+        double delta = x - mean;
+        mean -= delta / n;
+        m2 -= delta * (x - mean);
+        if (m2 < 0) m2 = 0;
+    }
+
+    bool finite() const { return isfinite(mean) && isfinite(m2); }
+
+    double result(WindowAggregate aggregate) const {
+        double variance = n > 1 ? m2 / n : 0.0;
+        switch (aggregate) {
+            case WindowAggregate::Variance: return variance;
+            case WindowAggregate::StandardDeviation: return sqrt(variance);
+            default: return mean;
+        }
+    }
+};
+
+// Medelvärde med löpande summa. När summan inte längre är ändlig har ett
+// NaN eller inf kommit in i fönstret; då räknas fönstret om med de
+// icke-ändliga värdena för sig, och så fortsätter det tills de har lämnat
+// fönstret.
+template <typename WindowStart>
+size_t slideMean(const double* data, size_t count, size_t firstOutput,
+                 WindowStart windowStart, double* out) {
+    double sum = 0;
+    size_t left = 0;
+    size_t sinceResync = 0;
+    size_t written = 0;
+    size_t i = 0;
+
+    while (i < count) {
+        for (; i < count; ++i) {
+            sum += data[i];
+            size_t start = windowStart(i);
+            while (left < start) {
+                sum -= data[left++];
+            }
+
+            if (++sinceResync >= max(i - left + 1, RESYNC_INTERVAL)) {
+                sum = 0;
+                for (size_t j = left; j <= i; ++j) sum += data[j];
+                sinceResync = 0;
+            }
+            if (!isfinite(sum)) break;
+
+            if (i >= firstOutput) {
+                out[written++] = sum / (i - left + 1);
+            }
+        }
+
+        NonFiniteCount nonFinite;
+        for (bool rebuild = true; i < count; rebuild = ++sinceResync >= max(i - left + 1, RESYNC_INTERVAL)) {
+            if (rebuild) {
+                nonFinite = NonFiniteCount();
+                sum = 0;
+                for (size_t j = left; j <= i; ++j) {
+                    if (nonFinite.add(data[j])) sum += data[j];
+                }
+                sinceResync = 0;
+            }
+            if (i >= firstOutput) {
+                out[written++] = nonFinite.total > 0 ? nonFinite.sum() : sum / (i - left + 1);
+            }
+            if (++i == count || (nonFinite.total == 0 && isfinite(sum))) break;
+
+            if (nonFinite.add(data[i])) sum += data[i];
+            size_t start = windowStart(i);
+            while (left < start) {
+                double x = data[left++];
+                if (nonFinite.remove(x)) sum -= x;
+            }
+        }
+    }
+    return written;
+}
+
+// Varians och standardavvikelse, med samma hantering av icke-ändliga värden
+// som slideMean. Avvikelsen från ett oändligt medelvärde är odefinierad, så
+// varje fönster med NaN eller inf ger NaN som vid en beräkning från grunden.
+template <typename WindowStart>
+size_t slideMoments(const double* data, size_t count, size_t firstOutput,
+                    WindowStart windowStart, WindowAggregate aggregate, double* out) {
+    WindowMoments moments;
+    size_t left = 0;
+    size_t sinceResync = 0;
+    size_t written = 0;
+    size_t i = 0;
+
+    while (i < count) {
+        for (; i < count; ++i) {
+            moments.add(data[i]);
+            size_t start = windowStart(i);
+            while (left < start) {
+                moments.remove(data[left++]);
+            }
+
+            if (++sinceResync >= max(i - left + 1, RESYNC_INTERVAL)) {
+                moments = WindowMoments();
+                for (size_t j = left; j <= i; ++j) moments.add(data[j]);
+                sinceResync = 0;
+            }
+            if (!moments.finite()) break;
+
+            if (i >= firstOutput) {
+                out[written++] = moments.result(aggregate);
+            }
+        }
+
+        NonFiniteCount nonFinite;
+        for (bool rebuild = true; i < count; rebuild = ++sinceResync >= max(i - left + 1, RESYNC_INTERVAL)) {
+            if (rebuild) {
+                nonFinite = NonFiniteCount();
+                moments = WindowMoments();
+                for (size_t j = left; j <= i; ++j) {
+                    if (nonFinite.add(data[j])) moments.add(data[j]);
+                }
+                sinceResync = 0;
+            }
+            if (i >= firstOutput) {
+                out[written++] = nonFinite.total > 0 ? numeric_limits<double>::quiet_NaN()
+                                                     : moments.result(aggregate);
+            }
+            if (++i == count || (nonFinite.total == 0 && moments.finite())) break;
+
+            if (nonFinite.add(data[i])) moments.add(data[i]);
+            size_t start = windowStart(i);
+            while (left < start) {
+                double x = data[left++];
+                if (nonFinite.remove(x)) moments.remove(x);
+            }
+        }
+    }
+    return written;
+}
+
+// Min eller max med en monoton kö av index (ringbuffert). NaN hoppas över
+// som när extremvärdet söks med < och >; ett fönster med bara NaN ger NaN.
+template <typename WindowStart>
+size_t slideExtreme(const double* data, size_t count, size_t firstOutput, WindowStart windowStart,
+                    bool findMax, vector<size_t>& queue, size_t capacity, double* out) {
+    // Kapaciteten avrundas upp till en tvåpotens så att index kan maskas
+    size_t mask = 1;
+    while (mask < capacity) mask <<= 1;
+    if (queue.size() < mask) queue.resize(mask);
+    --mask;
+    size_t* ring = queue.data();
+    size_t head = 0;   // Position för äldsta index
+    size_t length = 0;
+    size_t written = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        double x = data[i];
+
+        // Ta bort värden från slutet som aldrig kan bli fönstrets extremvärde
+        if (!isnan(x)) {
+            while (length > 0) {
+                size_t back = ring[(head + length - 1) & mask];
+                if (findMax ? data[back] > x : data[back] < x) break;
+                --length;
+            }
+            ring[(head + length) & mask] = i;
+            ++length;
+        }
+
+        // Ta bort index som har glidit ut ur fönstret
+        size_t start = windowStart(i);
+        while (length > 0 && ring[head] < start) {
+            head = (head + 1) & mask;
+            --length;
+        }
+
+        if (i >= firstOutput) {
+            out[written++] = length > 0 ? data[ring[head]] : numeric_limits<double>::quiet_NaN();
+        }
+    }
+    return written;
+}
+
+template <typename WindowStart>
+size_t slide(const double* data, size_t count, size_t firstOutput, WindowStart windowStart,
+             WindowAggregate aggregate, vector<size_t>& queue, size_t queueCapacity, double* out) {
+    switch (aggregate) {
+        case WindowAggregate::Min:
+            return slideExtreme(data, count, firstOutput, windowStart, false, queue, queueCapacity, out);
+        case WindowAggregate::Max:
+            return slideExtreme(data, count, firstOutput, windowStart, true, queue, queueCapacity, out);
+        case WindowAggregate::Mean:
+            return slideMean(data, count, firstOutput, windowStart, out);
+        default:
+            return slideMoments(data, count, firstOutput, windowStart, aggregate, out);
+    }
+}
+
+} // namespace
+
+size_t SlidingWindowEngine::outputCount(size_t count, size_t windowSize) {
+    if (windowSize == 0 || count < windowSize) return 0;
+    return count - windowSize + 1;
+}
+
+size_t SlidingWindowEngine::rolling(const double* data, size_t count, size_t windowSize,
+                                    WindowAggregate aggregate, double* out) {
+    if (outputCount(count, windowSize) == 0) return 0;
+
+    auto windowStart = [windowSize](size_t i) {
+        return i + 1 >= windowSize ? i + 1 - windowSize : 0;
+    };
+    return slide(data, count, windowSize - 1, windowStart, aggregate,
+                 queue, min(count, windowSize + 1), out);
+}
+
+size_t SlidingWindowEngine::rollingByTime(const double* data, const int64_t* timestamps, size_t count,
+                                          int64_t durationNs, WindowAggregate aggregate, double* out,
+                                          size_t firstOutput) {
+    if (count <= firstOutput || durationNs <= 0) return 0;
+
+    size_t start = 0;
+    auto windowStart = [timestamps, durationNs, &start](size_t i) {
+        while (start < i && timestamps[start] <= timestamps[i] - durationNs) {
+            ++start;
+        }
+        return start;
+    };
+    return slide(data, count, firstOutput, windowStart, aggregate, queue, count, out);
+}
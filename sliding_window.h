@@ -0,0 +1,44 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Aggregat som kan beräknas över ett glidande fönster
+enum class WindowAggregate {
+    Mean,
+    Min,
+    Max,
+    Variance,           // Populationsvarians, som i DataManager::Statistics
+    StandardDeviation
+};
+
+// Motor för glidande fönster i O(n) oavsett fönsterstorlek.
+// Medelvärde och varians uppdateras löpande när värden går in och ut ur
+// fönstret, min/max hålls i en monoton kö. Resultaten skrivs till en
+// buffert som anroparen äger; motorns egen arbetsyta återanvänds mellan anrop.
+// NaN och ±inf påverkar bara de fönster som innehåller dem: medelvärde och
+// varians blir då som vid en beräkning från grunden, min/max hoppar över NaN.
+class SlidingWindowEngine {
+private:
+    std::vector<size_t> queue;  // Ringbuffert med index för monoton kö
+
+public:
+    // Antal utvärden för ett fönster med windowSize värden över count värden
+    static size_t outputCount(size_t count, size_t windowSize);
+
+    // Fönster över de senaste windowSize värdena. Skriver
+    // outputCount(count, windowSize) värden till out och returnerar antalet.
+    size_t rolling(const double* data, size_t count, size_t windowSize,
+                   WindowAggregate aggregate, double* out);
+
+    // Tidsbaserat fönster (t - duration, t] för varje värde. Tidsstämplarna
+    // måste vara i kronologisk ordning. Skriver count - firstOutput värden
+    // till out; värdena före firstOutput används bara som fönsterhistorik.
+    size_t rollingByTime(const double* data, const std::int64_t* timestamps, size_t count,
+                         std::int64_t durationNs, WindowAggregate aggregate, double* out,
+                         size_t firstOutput = 0);
+};
+
+#endif // SLIDING_WINDOW_H
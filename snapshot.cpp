@@ -0,0 +1,299 @@
+#include "snapshot.h"
+#include "metrics.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'I', 'O', 'T', 'S', 'N', 'A', 'P', '\0' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint64_t COLUMN_ALIGNMENT = 64;
+const uint32_t FIRST_READABLE_VERSION = 1;
+
+// Facken skrivs och mappas som råa minnesbilder
+static_assert(is_trivially_copyable<RollupBucket>::value, "RollupBucket must be trivially copyable");
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+}
+
+// Fyll ut filen med nollor fram till offset
+bool padTo(FILE* file, uint64_t& position, uint64_t offset) {
+    static const char zeros[COLUMN_ALIGNMENT] = {};
+    size_t padding = static_cast<size_t>(offset - position);
+    position = offset;
+    return padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+}
+
+// Kontrollera en inläst header mot filens storlek
+bool validateHeader(const SnapshotHeader& header, uint64_t fileSize, string& error) {
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        error = "not a snapshot file";
+        return false;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        error = "snapshot was written on a platform with different byte order";
+        return false;
+    }
+    if (header.version < FIRST_READABLE_VERSION || header.version > SNAPSHOT_VERSION) {
+        error = "unsupported snapshot version " + to_string(header.version);
+        return false;
+    }
+    // Jämför antalet med utrymmet efter kolumnens början i stället för att
+    // räkna ut kolumnens slut, som kan slå runt för ett skadat antal
+    if (header.valuesOffset % sizeof(double) != 0 || header.timestampsOffset % sizeof(int64_t) != 0 ||
+        header.valuesOffset > fileSize || header.count > (fileSize - header.valuesOffset) / sizeof(double) ||
+        header.timestampsOffset > fileSize ||
+        header.count > (fileSize - header.timestampsOffset) / sizeof(int64_t)) {
+        error = "snapshot is truncated or corrupt";
+        return false;
+    }
+    if (header.version >= 2 && header.rollupOffset != 0) {
+        uint64_t rollupEnd = min(header.rollupOffset, fileSize + 1);
+        for (uint64_t buckets : header.rollupCounts) {
+            if (rollupEnd > fileSize || buckets > fileSize / sizeof(RollupBucket)) {
+                rollupEnd = fileSize + 1;
+                break;
+            }
+            rollupEnd += buckets * sizeof(RollupBucket);
+        }
+        if (header.rollupOffset % alignof(RollupBucket) != 0 || rollupEnd > fileSize) {
+            error = "snapshot rollups are truncated or corrupt";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool writeSnapshot(const string& filename, const double* values, const int64_t* timestamps,
+                   size_t count, const RunningStats& summary, const Rollups* rollups) {
+    // Skriv till en temporär fil och döp om den när allt är skrivet
+    string temporaryName = filename + ".tmp";
+    FILE* file = fopen(temporaryName.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.count = count;
+    header.valuesOffset = alignUp(sizeof(SnapshotHeader));
+    header.timestampsOffset = alignUp(header.valuesOffset + count * sizeof(double));
+    header.sum = summary.sum;
+    header.mean = summary.mean;
+    header.m2 = summary.m2;
+    header.min = summary.min;
+    header.max = summary.max;
+    header.minIndex = summary.minIndex;
+    header.maxIndex = summary.maxIndex;
+    uint64_t fileSize = header.timestampsOffset + count * sizeof(int64_t);
+    if (rollups != nullptr) {
+        header.rollupOffset = alignUp(fileSize);
+        fileSize = header.rollupOffset;
+        for (size_t tier = 0; tier < ROLLUP_TIER_COUNT; ++tier) {
+            header.rollupCounts[tier] = rollups->buckets(ROLLUP_TIERS[tier]).size();
+            fileSize += header.rollupCounts[tier] * sizeof(RollupBucket);
+        }
+    }
+
+    // Varje kolumn skrivs med ett enda anrop
+    uint64_t position = sizeof(header);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && padTo(file, position, header.valuesOffset);
+    ok = ok && (count == 0 || fwrite(values, sizeof(double), count, file) == count);
+    position += count * sizeof(double);
+    ok = ok && padTo(file, position, header.timestampsOffset);
+    ok = ok && (count == 0 || fwrite(timestamps, sizeof(int64_t), count, file) == count);
+    position += count * sizeof(int64_t);
+    if (rollups != nullptr) {
+        ok = ok && padTo(file, position, header.rollupOffset);
+        for (RollupTier tier : ROLLUP_TIERS) {
+            const vector<RollupBucket>& buckets = rollups->buckets(tier);
+            ok = ok && (buckets.empty() ||
+                        fwrite(buckets.data(), sizeof(RollupBucket), buckets.size(), file) == buckets.size());
+        }
+    }
+
+    ok = ok && fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = (fclose(file) == 0) && ok;
+
+#ifdef _WIN32
+    if (ok) remove(filename.c_str());
+#endif
+    if (!ok || rename(temporaryName.c_str(), filename.c_str()) != 0) {
+        remove(temporaryName.c_str());
+        return false;
+    }
+    IOT_COUNT(BytesWritten, fileSize);
+    return true;
+}
+
+bool isSnapshotFile(const string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                 memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
+
+MappedSnapshot::MappedSnapshot()
+    : mapping(nullptr), mappingSize(0), valueColumn(nullptr), timestampColumn(nullptr), count(0),
+      rollupColumns(), rollupCounts(), rollupsPresent(false) {}
+
+MappedSnapshot::~MappedSnapshot() {
+    if (mapping == nullptr) return;
+#ifndef _WIN32
+    munmap(mapping, mappingSize);
+#else
+    free(mapping);
+#endif
+}
+
+shared_ptr<const MappedSnapshot> MappedSnapshot::open(const string& filename, string& error) {
+    shared_ptr<MappedSnapshot> snapshot(new MappedSnapshot());
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open file";
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        error = "file is too small to be a snapshot";
+        return nullptr;
+    }
+    snapshot->mappingSize = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, snapshot->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "mmap failed";
+        return nullptr;
+    }
+    snapshot->mapping = mapped;
+#else
+    // Utan mmap läses filen in i ett block
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "could not open file";
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    snapshot->mappingSize = static_cast<size_t>(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    snapshot->mapping = malloc(snapshot->mappingSize);
+    bool readOk = snapshot->mapping != nullptr &&
+                  fread(snapshot->mapping, 1, snapshot->mappingSize, file) == snapshot->mappingSize;
+    fclose(file);
+    if (!readOk || snapshot->mappingSize < sizeof(SnapshotHeader)) {
+        error = "could not read file";
+        return nullptr;
+    }
+#endif
+
+    SnapshotHeader header;
+    memcpy(&header, snapshot->mapping, sizeof(header));
+    if (!validateHeader(header, snapshot->mappingSize, error)) {
+        return nullptr;
+    }
+
+    const char* base = static_cast<const char*>(snapshot->mapping);
+    snapshot->count = static_cast<size_t>(header.count);
+    snapshot->valueColumn = reinterpret_cast<const double*>(base + header.valuesOffset);
+    snapshot->timestampColumn = reinterpret_cast<const int64_t*>(base + header.timestampsOffset);
+    snapshot->stats.count = snapshot->count;
+    snapshot->stats.sum = header.sum;
+    snapshot->stats.mean = header.mean;
+    snapshot->stats.m2 = header.m2;
+    snapshot->stats.min = header.min;
+    snapshot->stats.max = header.max;
+    snapshot->stats.minIndex = static_cast<size_t>(header.minIndex);
+    snapshot->stats.maxIndex = static_cast<size_t>(header.maxIndex);
+    if (header.version >= 2 && header.rollupOffset != 0) {
+        const RollupBucket* buckets = reinterpret_cast<const RollupBucket*>(base + header.rollupOffset);
+        for (size_t tier = 0; tier < ROLLUP_TIER_COUNT; ++tier) {
+            snapshot->rollupColumns[tier] = buckets;
+            snapshot->rollupCounts[tier] = static_cast<size_t>(header.rollupCounts[tier]);
+            buckets += snapshot->rollupCounts[tier];
+        }
+        snapshot->rollupsPresent = true;
+    }
+
+#ifndef _WIN32
+    // Analyser läser kolumnerna sekventiellt
+    madvise(snapshot->mapping, snapshot->mappingSize, MADV_SEQUENTIAL);
+#endif
+    return snapshot;
+}
+
+bool readSnapshotBatches(const string& filename, size_t batchSize, const SnapshotBatchSink& sink,
+                         string& error) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "could not open file";
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    uint64_t fileSize = static_cast<uint64_t>(ftell(file));
+    fseek(file, 0, SEEK_SET);
+
+    SnapshotHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        error = "file is too small to be a snapshot";
+        return false;
+    }
+    if (!validateHeader(header, fileSize, error)) {
+        fclose(file);
+        return false;
+    }
+
+    // Kolumnerna ligger efter varandra, så varje batch läses med två sökningar
+    batchSize = batchSize > 0 ? batchSize : 1;
+    vector<double> values(batchSize);
+    vector<int64_t> timestamps(batchSize);
+    for (uint64_t done = 0; done < header.count; ) {
+        size_t n = static_cast<size_t>(min<uint64_t>(batchSize, header.count - done));
+        bool readOk =
+            fseek(file, static_cast<long>(header.valuesOffset + done * sizeof(double)), SEEK_SET) == 0 &&
+            fread(values.data(), sizeof(double), n, file) == n &&
+            fseek(file, static_cast<long>(header.timestampsOffset + done * sizeof(int64_t)), SEEK_SET) == 0 &&
+            fread(timestamps.data(), sizeof(int64_t), n, file) == n;
+        if (!readOk) {
+            fclose(file);
+            error = "read failed";
+            return false;
+        }
+        IOT_COUNT(BytesRead, n * (sizeof(double) + sizeof(int64_t)));
+        sink(values.data(), timestamps.data(), n);
+        done += n;
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "rollup.h"
+#include "stats_kernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Binärt ögonblicksformat för snabb sparning och start.
+//
+// Layout (plattformens byte-ordning, kontrolleras vid öppning):
+//   SnapshotHeader                      (fast storlek, se nedan)
+//   double  values[count]               (börjar på valuesOffset, 64-byte-justerat)
+//   int64_t timestamps[count]           (nanosekunder sedan epoch, 64-byte-justerat)
+//   RollupBucket rollups[...]           (version 2: minut-, tim- och dygnsfack i
+//                                        följd från rollupOffset, 64-byte-justerat)
+//
+// Headern innehåller även de löpande aggregaten så att statistik finns
+// tillgänglig direkt efter öppning utan att kolumnerna läses.
+struct SnapshotHeader {
+    char magic[8];              // "IOTSNAP\0"
+    std::uint32_t version;      // SNAPSHOT_VERSION
+    std::uint32_t byteOrder;    // 0x01020304 skrivet i plattformens ordning
+    std::uint64_t count;
+    std::uint64_t valuesOffset;
+    std::uint64_t timestampsOffset;
+    // Sammanfattning av värdekolumnen
+    double sum;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    std::uint64_t minIndex;
+    std::uint64_t maxIndex;
+    // Version 2: antal fack per nivå i ROLLUP_TIERS-ordning. I version 1
+    // är fälten nollor (de föll inom utfyllnaden före värdekolumnen).
+    std::uint64_t rollupOffset;
+    std::uint64_t rollupCounts[ROLLUP_TIER_COUNT];
+};
+
+// Version 1 (utan rollups) läses fortfarande; nya filer skrivs som version 2
+const std::uint32_t SNAPSHOT_VERSION = 2;
+
+// Skriv en snapshot med stora sekventiella skrivningar. Utan rollups får
+// läsaren bygga dem själv från kolumnerna.
+bool writeSnapshot(const std::string& filename, const double* values, const std::int64_t* timestamps,
+                   size_t count, const RunningStats& summary, const Rollups* rollups = nullptr);
+
+// Snabb kontroll av filens magiska bytes
+bool isSnapshotFile(const std::string& filename);
+
+// Läs en snapshot batch för batch med vanliga läsningar, utan att mappa
+// eller ladda hela filen; minnesbehovet är två batchar oavsett filstorlek
+typedef std::function<void(const double* values, const std::int64_t* timestamps,
+                           size_t count)> SnapshotBatchSink;
+bool readSnapshotBatches(const std::string& filename, size_t batchSize, const SnapshotBatchSink& sink,
+                         std::string& error);
+
+// En snapshot mappad skrivskyddat i minnet. Kolumnerna pekar direkt in i
+// de mappade sidorna; inget kopieras vid öppning.
+class MappedSnapshot {
+private:
+    void* mapping;
+    size_t mappingSize;
+    const double* valueColumn;
+    const std::int64_t* timestampColumn;
+    size_t count;
+    RunningStats stats;
+    const RollupBucket* rollupColumns[ROLLUP_TIER_COUNT];
+    size_t rollupCounts[ROLLUP_TIER_COUNT];
+    bool rollupsPresent;
+
+    MappedSnapshot();
+
+public:
+    ~MappedSnapshot();
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    // Öppna och validera en fil; returnerar nullptr och fyller i error vid fel
+    static std::shared_ptr<const MappedSnapshot> open(const std::string& filename, std::string& error);
+
+    const double* values() const { return valueColumn; }
+    const std::int64_t* timestamps() const { return timestampColumn; }
+    size_t size() const { return count; }
+    const RunningStats& summary() const { return stats; }
+    // Sparade rollups; saknas i version 1 och i filer skrivna utan dem
+    bool hasRollups() const { return rollupsPresent; }
+    const RollupBucket* rollupBuckets(RollupTier tier) const { return rollupColumns[static_cast<size_t>(tier)]; }
+    size_t rollupBucketCount(RollupTier tier) const { return rollupCounts[static_cast<size_t>(tier)]; }
+};
+
+#endif // SNAPSHOT_H
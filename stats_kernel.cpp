@@ -0,0 +1,298 @@
+#include "stats_kernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STATS_KERNEL_X86 1
+#endif
+
+using namespace std;
+
+namespace {
+
+// 1024 double = 8 KiB, ryms gott i L1 under båda passen
+const size_t BLOCK_SIZE = 1024;
+
+// Resultat från första passet över ett block
+struct BlockMoments {
+    double sum;
+    double min;
+    double max;
+};
+
+// En uppsättning kärnor för en instruktionsuppsättning
+struct KernelSet {
+    const char* name;
+    BlockMoments (*moments)(const double* data, size_t count);
+    double (*squaredDeviation)(const double* data, size_t count, double mean);
+};
+
+// Skalär reserv med fyra oberoende ackumulatorer.
+//
+// Min och max hoppar över NaN i alla kärnor: ackumulatorn börjar på ±inf
+// och står först i min(acc, x), som behåller acc när jämförelsen med ett
+// NaN är falsk. Med bara NaN i blocket blir min > max.
+BlockMoments momentsScalar(const double* data, size_t count) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    double lo = numeric_limits<double>::infinity(), hi = -lo;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        s0 += data[i];
+        s1 += data[i + 1];
+        s2 += data[i + 2];
+        s3 += data[i + 3];
+        lo = min(min(min(min(lo, data[i]), data[i + 1]), data[i + 2]), data[i + 3]);
+        hi = max(max(max(max(hi, data[i]), data[i + 1]), data[i + 2]), data[i + 3]);
+    }
+    for (; i < count; ++i) {
+        s0 += data[i];
+        lo = min(lo, data[i]);
+        hi = max(hi, data[i]);
+    }
+    BlockMoments result = { (s0 + s1) + (s2 + s3), lo, hi };
+    return result;
+}
+
+double squaredDeviationScalar(const double* data, size_t count, double mean) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        double d0 = data[i] - mean, d1 = data[i + 1] - mean;
+        double d2 = data[i + 2] - mean, d3 = data[i + 3] - mean;
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    for (; i < count; ++i) {
+        double d = data[i] - mean;
+        s0 += d * d;
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef STATS_KERNEL_X86
+
+// SSE2 finns på alla x86-64-processorer
+BlockMoments momentsSse2(const double* data, size_t count) {
+    if (count < 4) return momentsScalar(data, count);
+    // minpd/maxpd ger den andra operanden när någon är NaN, så datat står
+    // först och ackumulatorerna (som aldrig blir NaN) sist
+    __m128d sumA = _mm_setzero_pd(), sumB = _mm_setzero_pd();
+    __m128d loA = _mm_set1_pd(numeric_limits<double>::infinity()), loB = loA;
+    __m128d hiA = _mm_set1_pd(-numeric_limits<double>::infinity()), hiB = hiA;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d a = _mm_loadu_pd(data + i);
+        __m128d b = _mm_loadu_pd(data + i + 2);
+        sumA = _mm_add_pd(sumA, a);
+        sumB = _mm_add_pd(sumB, b);
+        loA = _mm_min_pd(a, loA);
+        loB = _mm_min_pd(b, loB);
+        hiA = _mm_max_pd(a, hiA);
+        hiB = _mm_max_pd(b, hiB);
+    }
+    double sums[2], los[2], his[2];
+    _mm_storeu_pd(sums, _mm_add_pd(sumA, sumB));
+    _mm_storeu_pd(los, _mm_min_pd(loA, loB));
+    _mm_storeu_pd(his, _mm_max_pd(hiA, hiB));
+    BlockMoments result = { sums[0] + sums[1], min(los[0], los[1]), max(his[0], his[1]) };
+    for (; i < count; ++i) {
+        result.sum += data[i];
+        result.min = min(result.min, data[i]);
+        result.max = max(result.max, data[i]);
+    }
+    return result;
+}
+
+double squaredDeviationSse2(const double* data, size_t count, double mean) {
+    __m128d m = _mm_set1_pd(mean);
+    __m128d accA = _mm_setzero_pd(), accB = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d a = _mm_sub_pd(_mm_loadu_pd(data + i), m);
+        __m128d b = _mm_sub_pd(_mm_loadu_pd(data + i + 2), m);
+        accA = _mm_add_pd(accA, _mm_mul_pd(a, a));
+        accB = _mm_add_pd(accB, _mm_mul_pd(b, b));
+    }
+    double sums[2];
+    _mm_storeu_pd(sums, _mm_add_pd(accA, accB));
+    double result = sums[0] + sums[1];
+    for (; i < count; ++i) {
+        double d = data[i] - mean;
+        result += d * d;
+    }
+    return result;
+}
+
+__attribute__((target("avx2")))
+BlockMoments momentsAvx2(const double* data, size_t count) {
+    if (count < 8) return momentsScalar(data, count);
+    __m256d sumA = _mm256_setzero_pd(), sumB = _mm256_setzero_pd();
+    __m256d loA = _mm256_set1_pd(numeric_limits<double>::infinity()), loB = loA;
+    __m256d hiA = _mm256_set1_pd(-numeric_limits<double>::infinity()), hiB = hiA;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d a = _mm256_loadu_pd(data + i);
+        __m256d b = _mm256_loadu_pd(data + i + 4);
+        sumA = _mm256_add_pd(sumA, a);
+        sumB = _mm256_add_pd(sumB, b);
+        loA = _mm256_min_pd(a, loA);
+        loB = _mm256_min_pd(b, loB);
+        hiA = _mm256_max_pd(a, hiA);
+        hiB = _mm256_max_pd(b, hiB);
+    }
+    double sums[4], los[4], his[4];
+    _mm256_storeu_pd(sums, _mm256_add_pd(sumA, sumB));
+    _mm256_storeu_pd(los, _mm256_min_pd(loA, loB));
+    _mm256_storeu_pd(his, _mm256_max_pd(hiA, hiB));
+    BlockMoments result = {
+        (sums[0] + sums[1]) + (sums[2] + sums[3]),
+        min(min(los[0], los[1]), min(los[2], los[3])),
+        max(max(his[0], his[1]), max(his[2], his[3]))
+    };
+    for (; i < count; ++i) {
+        result.sum += data[i];
+        result.min = min(result.min, data[i]);
+        result.max = max(result.max, data[i]);
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+double squaredDeviationAvx2(const double* data, size_t count, double mean) {
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d accA = _mm256_setzero_pd(), accB = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d a = _mm256_sub_pd(_mm256_loadu_pd(data + i), m);
+        __m256d b = _mm256_sub_pd(_mm256_loadu_pd(data + i + 4), m);
+        accA = _mm256_fmadd_pd(a, a, accA);
+        accB = _mm256_fmadd_pd(b, b, accB);
+    }
+    double sums[4];
+    _mm256_storeu_pd(sums, _mm256_add_pd(accA, accB));
+    double result = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    for (; i < count; ++i) {
+        double d = data[i] - mean;
+        result += d * d;
+    }
+    return result;
+}
+
+#endif // STATS_KERNEL_X86
+
+// Välj kärna en gång utifrån processorns förmåga.
+// Miljövariabeln IOT_STATS_KERNEL kan tvinga fram en enklare kärna.
+const KernelSet& selectKernels() {
+    static const KernelSet scalar = { "scalar", momentsScalar, squaredDeviationScalar };
+    const char* forced = getenv("IOT_STATS_KERNEL");
+    string requested = forced != nullptr ? forced : "";
+    if (requested == "scalar") {
+        return scalar;
+    }
+#ifdef STATS_KERNEL_X86
+    static const KernelSet avx2 = { "avx2", momentsAvx2, squaredDeviationAvx2 };
+    static const KernelSet sse2 = { "sse2", momentsSse2, squaredDeviationSse2 };
+    __builtin_cpu_init();
+    if (requested != "sse2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return avx2;
+    }
+    return sse2;
+#else
+    return scalar;
+#endif
+}
+
+const KernelSet& kernels() {
+    static const KernelSet& selected = selectKernels();
+    return selected;
+}
+
+// Första position i blocket med exakt detta värde; NaN är inte lika med
+// sig självt och söks därför för sig
+size_t firstIndexOf(const double* data, size_t count, double value) {
+    if (isnan(value)) {
+        return static_cast<size_t>(find_if(data, data + count, [](double x) { return isnan(x); }) - data);
+    }
+    return static_cast<size_t>(find(data, data + count, value) - data);
+}
+
+// Sant om candidate är ett nytt minsta (eller största) värde; NaN förlorar
+// mot alla andra värden
+bool beats(double candidate, double current, bool findMax) {
+    if (isnan(current)) return !isnan(candidate);
+    return findMax ? candidate > current : candidate < current;
+}
+
+} // namespace
+
+void RunningStats::merge(const RunningStats& other, size_t indexOffset) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        minIndex += indexOffset;
+        maxIndex += indexOffset;
+        return;
+    }
+
+    // Chans formel för att kombinera två delsummor av kvadratavvikelser
+    size_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+    sum += other.sum;
+
+    // Vid lika värden behålls den tidigaste positionen
+    if (beats(other.min, min, false)) {
+        min = other.min;
+        minIndex = other.minIndex + indexOffset;
+    }
+    if (beats(other.max, max, true)) {
+        max = other.max;
+        maxIndex = other.maxIndex + indexOffset;
+    }
+    count = total;
+}
+
+RunningStats summarizeValues(const double* data, size_t count) {
+    const KernelSet& k = kernels();
+    RunningStats total;
+
+    for (size_t offset = 0; offset < count; offset += BLOCK_SIZE) {
+        const double* block = data + offset;
+        size_t n = min(BLOCK_SIZE, count - offset);
+
+        BlockMoments moments = k.moments(block, n);
+        RunningStats part;
+        part.count = n;
+        part.sum = moments.sum;
+        part.mean = moments.sum / n;
+        part.m2 = k.squaredDeviation(block, n, part.mean);
+        part.min = moments.min;
+        part.max = moments.max;
+        if (part.min > part.max) {
+            // Blocket innehåller bara NaN
+            part.min = part.max = numeric_limits<double>::quiet_NaN();
+        }
+
+        // Index behövs bara när blocket slår det hittills bästa värdet
+        if (total.count == 0 || beats(part.min, total.min, false)) {
+            part.minIndex = firstIndexOf(block, n, part.min);
+        }
+        if (total.count == 0 || beats(part.max, total.max, true)) {
+            part.maxIndex = firstIndexOf(block, n, part.max);
+        }
+        total.merge(part, offset);
+    }
+
+    return total;
+}
+
+const char* statsKernelName() {
+    return kernels().name;
+}
@@ -0,0 +1,63 @@
+#ifndef STATS_KERNEL_H
+#define STATS_KERNEL_H
+
+#include <cmath>
+#include <cstddef>
+
+// Sammanfattning av en serie värden: antal, summa, min/max med index
+// samt medelvärde och M2 (summan av kvadrerade avvikelser) enligt Welford.
+// Två sammanfattningar kan slås ihop exakt (Chan et al.), vilket gör att
+// block, trådar eller shards kan räknas var för sig. NaN hoppas över vid
+// min/max; bara en serie med enbart NaN får NaN som min och max.
+struct RunningStats {
+    size_t count;
+    double sum;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    size_t minIndex;  // Första positionen med minsta värdet
+    size_t maxIndex;  // Första positionen med största värdet
+
+    RunningStats() : count(0), sum(0), mean(0), m2(0), min(0), max(0), minIndex(0), maxIndex(0) {}
+
+    // Lägg till nästa värde i O(1); dess index blir det nuvarande antalet
+    void add(double value) { addAt(value, count); }
+
+    // Lägg till ett värde med ett eget index, t.ex. radnumret i ett större
+    // lager; indexen förutsätts komma i stigande ordning
+    void addAt(double value, size_t index) {
+        if (count == 0 || (std::isnan(min) && !std::isnan(value))) {
+            min = max = value;
+            minIndex = maxIndex = index;
+        } else if (value < min) {
+            min = value;
+            minIndex = index;
+        } else if (value > max) {
+            max = value;
+            maxIndex = index;
+        }
+        ++count;
+        sum += value;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    // Slå ihop en sammanfattning vars index börjar på indexOffset
+    void merge(const RunningStats& other, size_t indexOffset = 0);
+
+    // Populationsvarians (dividerat med n), 0 för färre än två värden
+    double variance() const { return count > 1 ? m2 / count : 0.0; }
+};
+
+// Beräkna hela sammanfattningen i ett enda svep över minnet.
+// Datat delas i L1-stora block; varje block läses från RAM en gång och
+// den andra (stabila) variansberäkningen sker medan blocket ligger i cache.
+// Vektoriserad med AVX2/SSE2 beroende på processorn (väljs vid körning).
+RunningStats summarizeValues(const double* data, size_t count);
+
+// Namnet på den kärna som valts vid körning ("avx2", "sse2" eller "scalar")
+const char* statsKernelName();
+
+#endif // STATS_KERNEL_H
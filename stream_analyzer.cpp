@@ -0,0 +1,138 @@
+#include "stream_analyzer.h"
+#include "archive.h"
+#include "metrics.h"
+#include "snapshot.h"
+#include <algorithm>
+
+using namespace std;
+
+StreamAnalyzer::StreamAnalyzer(const StreamAnalysisOptions& options)
+    : options(options), result(nullptr), writingMoving(false) {
+}
+
+bool StreamAnalyzer::begin(StreamAnalysisResult& target, string& error) {
+    result = &target;
+    target = StreamAnalysisResult();
+    target.aboveCounts.assign(options.thresholds.size(), 0);
+    target.histogram = Histogram(options.histogramLow, options.histogramWidth, options.histogramBins);
+
+    windowValues.clear();
+    windowTimestamps.clear();
+    writingMoving = false;
+
+    if (!options.movingAverageFile.empty() && options.movingWindow > 0) {
+        movingWriter.setTimeMode(options.timeMode);
+        if (!movingWriter.open(options.movingAverageFile)) {
+            error = "could not open " + options.movingAverageFile;
+            return false;
+        }
+        movingWriter.writeHeader();
+        writingMoving = true;
+    }
+    return true;
+}
+
+void StreamAnalyzer::consume(const double* values, const int64_t* timestamps, size_t count) {
+    if (count == 0) return;
+    StreamAnalysisResult& r = *result;
+
+    if (r.stats.count == 0) r.firstTimestampNs = timestamps[0];
+    r.lastTimestampNs = timestamps[count - 1];
+
+    r.stats.merge(summarizeValues(values, count), r.stats.count);
+    r.histogram.addRange(values, count);
+    r.sketch.updateRange(values, count);
+    for (size_t t = 0; t < options.thresholds.size(); ++t) {
+        double threshold = options.thresholds[t];
+        uint64_t above = 0;
+        for (size_t i = 0; i < count; ++i) {
+            above += values[i] > threshold;
+        }
+        r.aboveCounts[t] += above;
+    }
+    if (options.movingWindow > 0) {
+        consumeMoving(values, timestamps, count);
+    }
+}
+
+void StreamAnalyzer::consumeMoving(const double* values, const int64_t* timestamps, size_t count) {
+    size_t window = options.movingWindow;
+    windowValues.insert(windowValues.end(), values, values + count);
+    windowTimestamps.insert(windowTimestamps.end(), timestamps, timestamps + count);
+
+    size_t outputs = SlidingWindowEngine::outputCount(windowValues.size(), window);
+    if (outputs > 0) {
+        windowOutput.resize(outputs);
+        windowEngine.rolling(windowValues.data(), windowValues.size(), window,
+                             WindowAggregate::Mean, windowOutput.data());
+        result->movingAverageCount += outputs;
+        result->lastMovingAverage = windowOutput[outputs - 1];
+        if (writingMoving) {
+            // Utvärde i hör till fönstret som slutar på position i + window - 1
+            movingWriter.writeRows(windowOutput.data(), windowTimestamps.data() + window - 1, outputs);
+        }
+    }
+
+    // Behåll bara historiken som nästa batch behöver
+    size_t keep = min(windowValues.size(), window - 1);
+    windowValues.erase(windowValues.begin(), windowValues.end() - keep);
+    windowTimestamps.erase(windowTimestamps.begin(), windowTimestamps.end() - keep);
+}
+
+bool StreamAnalyzer::finish(string& error) {
+    StreamAnalysisResult& r = *result;
+    r.quantileValues = r.sketch.quantiles(options.quantiles);
+    result = nullptr;
+
+    if (writingMoving && !movingWriter.close()) {
+        error = "could not write " + options.movingAverageFile;
+        return false;
+    }
+    return true;
+}
+
+bool StreamAnalyzer::analyzeFile(const string& filename, StreamAnalysisResult& target, string& error) {
+    if (isSnapshotFile(filename)) {
+        IOT_TIME_OPERATION(StreamAnalysis);
+        if (!begin(target, error)) return false;
+        target.fromSnapshot = true;
+        bool ok = readSnapshotBatches(filename, options.batchSize,
+            [this](const double* values, const int64_t* timestamps, size_t count) {
+                consume(values, timestamps, count);
+            }, error);
+        return finish(error) && ok;
+    }
+    if (isArchiveFile(filename)) {
+        // Ett block i taget, så minnet beror på blockstorleken och inte på arkivet
+        IOT_TIME_OPERATION(StreamAnalysis);
+        if (!begin(target, error)) return false;
+        target.fromArchive = true;
+        bool ok = readArchive(filename,
+            [this](const double* values, const int64_t* timestamps, size_t count) {
+                consume(values, timestamps, count);
+            }, error, target.skippedBytes);
+        return finish(error) && ok;
+    }
+
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "could not open " + filename;
+        return false;
+    }
+    bool ok = analyzeStream(file, target, error);
+    fclose(file);
+    return ok;
+}
+
+bool StreamAnalyzer::analyzeStream(FILE* stream, StreamAnalysisResult& target, string& error) {
+    IOT_TIME_OPERATION(StreamAnalysis);
+    if (!begin(target, error)) return false;
+
+    CsvReader reader(1 << 20, options.batchSize);
+    reader.setTimeMode(options.timeMode);
+    reader.readStream(stream,
+        [this](const double* values, const int64_t* timestamps, size_t count) {
+            consume(values, timestamps, count);
+        }, target.csvReport);
+    return finish(error);
+}
@@ -0,0 +1,87 @@
+#ifndef STREAM_ANALYZER_H
+#define STREAM_ANALYZER_H
+
+#include "csv_reader.h"
+#include "csv_writer.h"
+#include "histogram.h"
+#include "quantile.h"
+#include "sliding_window.h"
+#include "stats_kernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Inställningar för en analys i ett svep
+struct StreamAnalysisOptions {
+    std::vector<double> thresholds;      // Räkna värden över varje tröskel
+    double histogramLow;                 // Histogrammets intervall måste vara känt i förväg
+    double histogramWidth;
+    size_t histogramBins;
+    size_t movingWindow;                 // 0 = inget glidande medelvärde
+    std::string movingAverageFile;       // Tom = serien skrivs inte ut
+    std::vector<double> quantiles;       // Uppskattas med KLL-skissen
+    size_t batchSize;
+    TimeMode timeMode;                   // Tidsformat i CSV in och ut
+
+    StreamAnalysisOptions()
+        : histogramLow(-50.0), histogramWidth(1.0), histogramBins(200), movingWindow(0),
+          quantiles({ 0.5, 0.95, 0.99 }), batchSize(1 << 16), timeMode(TimeMode::Local) {}
+};
+
+// Resultat av en analys
+struct StreamAnalysisResult {
+    RunningStats stats;
+    std::vector<std::uint64_t> aboveCounts;   // Antal värden > thresholds[i]
+    Histogram histogram;
+    KllSketch sketch;
+    std::vector<double> quantileValues;       // Samma ordning som options.quantiles
+    std::uint64_t movingAverageCount;
+    double lastMovingAverage;
+    std::int64_t firstTimestampNs;
+    std::int64_t lastTimestampNs;
+    CsvLoadReport csvReport;                  // Parsningsfel vid CSV-indata
+    bool fromSnapshot;
+    bool fromArchive;
+    std::uint64_t skippedBytes;               // Avbrutet eller skadat slut på ett arkiv
+
+    StreamAnalysisResult()
+        : movingAverageCount(0), lastMovingAverage(0), firstTimestampNs(0), lastTimestampNs(0),
+          fromSnapshot(false), fromArchive(false), skippedBytes(0) {}
+};
+
+// Analys av en CSV-fil, snapshot eller ett arkiv som är större än minnet. Filen läses
+// i batchar och varje batch går genom alla aggregat innan nästa läses, så
+// minnesbehovet beror på batchstorlek, fönsterstorlek och antal fack men
+// inte på filens storlek. Inga mätvärden sparas.
+class StreamAnalyzer {
+private:
+    StreamAnalysisOptions options;
+    StreamAnalysisResult* result;
+
+    // Glidande medelvärde över batchgränser: de senaste movingWindow - 1
+    // värdena sparas och läggs före nästa batch
+    SlidingWindowEngine windowEngine;
+    std::vector<double> windowValues;
+    std::vector<std::int64_t> windowTimestamps;
+    std::vector<double> windowOutput;
+    CsvWriter movingWriter;
+    bool writingMoving;
+
+    bool begin(StreamAnalysisResult& target, std::string& error);
+    void consume(const double* values, const std::int64_t* timestamps, size_t count);
+    void consumeMoving(const double* values, const std::int64_t* timestamps, size_t count);
+    bool finish(std::string& error);
+
+public:
+    explicit StreamAnalyzer(const StreamAnalysisOptions& options);
+
+    // Analysera en fil; snapshots och arkiv känns igen på sin header. false och ett
+    // felmeddelande om filen inte kunde läsas.
+    bool analyzeFile(const std::string& filename, StreamAnalysisResult& result, std::string& error);
+
+    // Analysera CSV från en redan öppnad ström (t.ex. stdin)
+    bool analyzeStream(std::FILE* stream, StreamAnalysisResult& result, std::string& error);
+};
+
+#endif // STREAM_ANALYZER_H
@@ -0,0 +1,87 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : job(nullptr), jobCount(0), nextTask(0), busyWorkers(0), generation(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::runTasks() {
+    size_t task;
+    while ((task = nextTask.fetch_add(1, memory_order_relaxed)) < jobCount) {
+        (*job)(task);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(size_t taskCount, const function<void(size_t)>& task) {
+    if (taskCount == 0) return;
+
+    // Utan arbetstrådar, eller med en enda uppgift, körs allt direkt
+    if (workers.empty() || taskCount == 1) {
+        for (size_t i = 0; i < taskCount; ++i) task(i);
+        return;
+    }
+
+    lock_guard<std::mutex> runLock(runMutex);
+    {
+        lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobCount = taskCount;
+        nextTask.store(0, memory_order_relaxed);
+        busyWorkers = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    runTasks();
+
+    unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::forEachChunk(size_t count, size_t chunkSize,
+                              const function<void(size_t, size_t, size_t)>& body) {
+    size_t chunks = chunkCount(count, chunkSize);
+    run(chunks, [&](size_t chunk) {
+        size_t begin = chunk * chunkSize;
+        body(chunk, begin, min(count, begin + chunkSize));
+    });
+}
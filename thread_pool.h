@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Enkel trådpool för dataparallella svep.
+// Ett jobb består av N deluppgifter som trådarna plockar dynamiskt
+// (den anropande tråden hjälper till), vilket jämnar ut lasten mellan
+// kärnor. run() blockerar tills alla deluppgifter är klara.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex runMutex;                 // Ett jobb i taget
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job;
+    size_t jobCount;
+    std::atomic<size_t> nextTask;
+    size_t busyWorkers;
+    std::uint64_t generation;
+    bool stopping;
+
+    void workerLoop();
+    void runTasks();
+
+public:
+    // threadCount inkluderar den anropande tråden; 0 betyder alla kärnor
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size() + 1); }
+
+    // Kör task(i) för i = 0..taskCount-1
+    void run(size_t taskCount, const std::function<void(size_t)>& task);
+
+    // Dela [0, count) i block om chunkSize element och kör
+    // body(chunk, begin, end) för varje block. Blockgränserna beror bara på
+    // count och chunkSize, så resultat som slås ihop i blockordning blir
+    // desamma oavsett antal trådar.
+    void forEachChunk(size_t count, size_t chunkSize,
+                      const std::function<void(size_t chunk, size_t begin, size_t end)>& body);
+
+    static size_t chunkCount(size_t count, size_t chunkSize) {
+        return (count + chunkSize - 1) / chunkSize;
+    }
+};
+
+#endif // THREAD_POOL_H
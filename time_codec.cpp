@@ -0,0 +1,321 @@
+#include "time_codec.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+const int64_t SECONDS_PER_DAY = 86400;
+const int64_t NANOS_PER_SECOND = 1000000000LL;
+
+// Längsta steg när giltighetsintervallet för en förskjutning letas fram,
+// och hur långt åt varje håll det som mest sträcker sig
+const int64_t MAX_PROBE_STEP = 7 * SECONDS_PER_DAY;
+const int64_t MAX_OFFSET_SPAN = 366 * SECONDS_PER_DAY;
+
+// Nära en övergång kan en lokal tid vara tvetydig; där avgör mktime
+const int64_t TRANSITION_MARGIN = 3 * 3600;
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+inline void writeTwoDigits(char* out, int value) {
+    memcpy(out, DIGIT_PAIRS + 2 * value, 2);
+}
+
+// Läs exakt n siffror; returnerar -1 vid ogiltigt tecken
+int parseDigits(const char* p, int n) {
+    int result = 0;
+    for (int i = 0; i < n; ++i) {
+        unsigned digit = static_cast<unsigned>(p[i] - '0');
+        if (digit > 9) return -1;
+        result = result * 10 + static_cast<int>(digit);
+    }
+    return result;
+}
+
+// Dagar sedan 1970-01-01 i den proleptiska gregorianska kalendern
+// (Howard Hinnants days_from_civil)
+int64_t daysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromDays(int64_t days, int64_t& year, int& month, int& day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+int64_t floorDivide(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor < 0) ? quotient - 1 : quotient;
+}
+
+// Förskjutning i sekunder mellan lokal tid och UTC vid en tidpunkt
+bool offsetAt(int64_t utcSeconds, int64_t& offset) {
+    time_t t = static_cast<time_t>(utcSeconds);
+    tm local;
+#ifndef _WIN32
+    if (localtime_r(&t, &local) == nullptr) return false;
+#else
+    if (localtime_s(&local, &t) != 0) return false;
+#endif
+    int64_t localSeconds = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * SECONDS_PER_DAY +
+                           local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    offset = localSeconds - utcSeconds;
+    return true;
+}
+
+// Första sekunden i (same, different] där förskjutningen skiljer sig
+// från den vid same (binärsökning)
+int64_t findTransition(int64_t same, int64_t different, int64_t offset) {
+    while (different - same > 1) {
+        int64_t middle = same + (different - same) / 2;
+        int64_t probe;
+        if (offsetAt(middle, probe) && probe == offset) same = middle;
+        else different = middle;
+    }
+    return different;
+}
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+const char* timeModeName(TimeMode mode) {
+    switch (mode) {
+        case TimeMode::Utc: return "utc";
+        case TimeMode::Epoch: return "epoch";
+        default: return "local";
+    }
+}
+
+bool parseTimeMode(const string& name, TimeMode& mode) {
+    if (name == "local") mode = TimeMode::Local;
+    else if (name == "utc") mode = TimeMode::Utc;
+    else if (name == "epoch") mode = TimeMode::Epoch;
+    else return false;
+    return true;
+}
+
+TimeCodec::TimeCodec(TimeMode mode)
+    : mode(mode), rangeCount(0), currentRange(0), nextSlot(0) {
+}
+
+// Slå upp förskjutningen vid utcSeconds och hur långt den gäller åt båda
+// hållen. Stegen växer till en vecka, så en övergång hoppas inte över så
+// länge två övergångar inte ligger tätare än så.
+TimeCodec::OffsetRange TimeCodec::lookupRange(int64_t utcSeconds) {
+    int64_t offset;
+    if (!offsetAt(utcSeconds, offset)) {
+        return OffsetRange{ utcSeconds, utcSeconds + 1, 0 };
+    }
+
+    int64_t end = utcSeconds;
+    for (int64_t step = 3600; end - utcSeconds < MAX_OFFSET_SPAN; step = min(step * 2, MAX_PROBE_STEP)) {
+        int64_t probe;
+        if (!offsetAt(end + step, probe) || probe != offset) {
+            end = findTransition(end, end + step, offset) - 1;
+            break;
+        }
+        end += step;
+    }
+
+    int64_t start = utcSeconds;
+    for (int64_t step = 3600; utcSeconds - start < MAX_OFFSET_SPAN; step = min(step * 2, MAX_PROBE_STEP)) {
+        int64_t probe;
+        if (!offsetAt(start - step, probe) || probe != offset) {
+            // Sök från den ändrade sidan: första sekunden med samma förskjutning
+            int64_t low = start - step;
+            int64_t high = start;
+            while (high - low > 1) {
+                int64_t middle = low + (high - low) / 2;
+                if (offsetAt(middle, probe) && probe == offset) high = middle;
+                else low = middle;
+            }
+            start = high;
+            break;
+        }
+        start -= step;
+    }
+
+    return OffsetRange{ start, end + 1, offset };
+}
+
+const TimeCodec::OffsetRange& TimeCodec::rangeFor(int64_t utcSeconds) {
+    const OffsetRange& current = ranges[currentRange];
+    if (currentRange < rangeCount && utcSeconds >= current.start && utcSeconds < current.end) {
+        return current;
+    }
+    for (size_t i = 0; i < rangeCount; ++i) {
+        if (utcSeconds >= ranges[i].start && utcSeconds < ranges[i].end) {
+            currentRange = i;
+            return ranges[i];
+        }
+    }
+
+    // Ersätt intervallen i tur och ordning när cachen är full
+    currentRange = nextSlot;
+    nextSlot = (nextSlot + 1) % OFFSET_CACHE_SIZE;
+    rangeCount = max(rangeCount, currentRange + 1);
+    ranges[currentRange] = lookupRange(utcSeconds);
+    return ranges[currentRange];
+}
+
+// Lokal tid till UTC. Tider nära en sommartidsövergång (som kanske inte
+// finns eller finns två gånger) lämnas till mktime, som tidigare.
+bool TimeCodec::localToUtc(int year, int month, int day, int hour, int minute, int second,
+                           int64_t& utcSeconds) {
+    int64_t localSeconds = daysFromCivil(year, month, day) * SECONDS_PER_DAY +
+                           hour * 3600 + minute * 60 + second;
+    // Gissa med den senast använda förskjutningen och kontrollera att
+    // gissningen ligger i ett intervall med just den förskjutningen
+    int64_t offset = currentRange < rangeCount ? ranges[currentRange].offset : 0;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int64_t guess = localSeconds - offset;
+        const OffsetRange& range = rangeFor(guess);
+        if (range.offset == offset) {
+            if (guess >= range.start + TRANSITION_MARGIN && guess < range.end - TRANSITION_MARGIN) {
+                utcSeconds = guess;
+                return true;
+            }
+            break;
+        }
+        offset = range.offset;
+    }
+
+    tm local = {};
+    local.tm_year = year - 1900;
+    local.tm_mon = month - 1;
+    local.tm_mday = day;
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = second;
+    local.tm_isdst = -1;
+    time_t result = mktime(&local);
+    if (result == static_cast<time_t>(-1)) return false;
+    utcSeconds = static_cast<int64_t>(result);
+    return true;
+}
+
+char* TimeCodec::format(char* out, int64_t timestampNs) {
+    int64_t seconds = floorDivide(timestampNs, NANOS_PER_SECOND);
+    if (mode == TimeMode::Epoch) {
+        return to_chars(out, out + TIME_TEXT_CAPACITY, seconds).ptr;
+    }
+
+    if (mode == TimeMode::Local) {
+        seconds += rangeFor(seconds).offset;
+    }
+    int64_t days = floorDivide(seconds, SECONDS_PER_DAY);
+    int secondOfDay = static_cast<int>(seconds - days * SECONDS_PER_DAY);
+    int64_t year;
+    int month;
+    int day;
+    civilFromDays(days, year, month, day);
+
+    if (year < 0 || year > 9999) {
+        // Utanför fyrsiffriga år: långsam men korrekt väg
+        char* p = to_chars(out, out + 12, year).ptr;
+        *p++ = '-';
+        writeTwoDigits(p, month);
+        p[2] = '-';
+        writeTwoDigits(p + 3, day);
+        p += 5;
+        *p++ = ' ';
+        writeTwoDigits(p, secondOfDay / 3600);
+        p[2] = ':';
+        writeTwoDigits(p + 3, secondOfDay / 60 % 60);
+        p[5] = ':';
+        writeTwoDigits(p + 6, secondOfDay % 60);
+        return p + 8;
+    }
+
+    int y = static_cast<int>(year);
+    writeTwoDigits(out, y / 100);
+    writeTwoDigits(out + 2, y % 100);
+    out[4] = '-';
+    writeTwoDigits(out + 5, month);
+    out[7] = '-';
+    writeTwoDigits(out + 8, day);
+    out[10] = ' ';
+    writeTwoDigits(out + 11, secondOfDay / 3600);
+    out[13] = ':';
+    writeTwoDigits(out + 14, secondOfDay / 60 % 60);
+    out[16] = ':';
+    writeTwoDigits(out + 17, secondOfDay % 60);
+    return out + 19;
+}
+
+string TimeCodec::format(int64_t timestampNs) {
+    char buffer[TIME_TEXT_CAPACITY];
+    char* end = format(buffer, timestampNs);
+    return string(buffer, end);
+}
+
+bool TimeCodec::parse(const char* begin, const char* end, int64_t& timestampNs) {
+    while (begin < end && isBlank(*begin)) ++begin;
+    while (end > begin && isBlank(end[-1])) --end;
+    size_t length = end - begin;
+
+    // Sekunder sedan epoch: bara siffror, eventuellt med minustecken
+    if (length < 5 || begin[4] != '-') {
+        int64_t seconds;
+        from_chars_result parsed = from_chars(begin, end, seconds);
+        if (parsed.ec != errc() || parsed.ptr != end) return false;
+        if (seconds > numeric_limits<int64_t>::max() / NANOS_PER_SECOND ||
+            seconds < numeric_limits<int64_t>::min() / NANOS_PER_SECOND) {
+            return false;
+        }
+        timestampNs = seconds * NANOS_PER_SECOND;
+        return true;
+    }
+
+    // Fast format: "YYYY-MM-DD HH:MM:SS" eller "YYYY-MM-DD HH:MM"
+    if (length != 19 && length != 16) return false;
+    if (begin[4] != '-' || begin[7] != '-' || begin[10] != ' ' || begin[13] != ':') return false;
+
+    int year = parseDigits(begin, 4);
+    int month = parseDigits(begin + 5, 2);
+    int day = parseDigits(begin + 8, 2);
+    int hour = parseDigits(begin + 11, 2);
+    int minute = parseDigits(begin + 14, 2);
+    int second = 0;
+    if (length == 19) {
+        if (begin[16] != ':') return false;
+        second = parseDigits(begin + 17, 2);
+    }
+
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60) {
+        return false;
+    }
+
+    int64_t seconds;
+    if (mode == TimeMode::Local) {
+        if (!localToUtc(year, month, day, hour, minute, second, seconds)) return false;
+    } else {
+        seconds = daysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+    }
+    timestampNs = seconds * NANOS_PER_SECOND;
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef TIME_CODEC_H
+#define TIME_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hur tidsstämplar skrivs och tolkas som text
+enum class TimeMode {
+    Local,   // "YYYY-MM-DD HH:MM:SS" i lokal tid (standard)
+    Utc,     // "YYYY-MM-DD HH:MM:SS" i UTC
+    Epoch    // Hela sekunder sedan 1970-01-01 00:00:00 UTC
+};
+
+const char* timeModeName(TimeMode mode);
+bool parseTimeMode(const std::string& name, TimeMode& mode);
+
+// Buffertstorlek som räcker för alla format
+const size_t TIME_TEXT_CAPACITY = 32;
+
+// Formatering och tolkning av tidsstämplar utan localtime/mktime per rad.
+//
+// Datum räknas fram med heltalsaritmetik och siffror skrivs från en
+// tabell med tvåsiffriga par. För lokal tid cachas UTC-förskjutningen
+// tillsammans med det intervall där den gäller, dvs. fram till nästa
+// sommartidsövergång; localtime_r anropas bara när en tidsstämpel hamnar
+// utanför intervallet. Varje instans har sin egen cache och kan användas
+// utan lås i en tråd (ingen delad tm-buffert som std::localtime).
+class TimeCodec {
+private:
+    // Intervall [start, end) i UTC-sekunder med samma lokala förskjutning
+    struct OffsetRange {
+        std::int64_t start;
+        std::int64_t end;
+        std::int64_t offset;
+    };
+    static const size_t OFFSET_CACHE_SIZE = 16;
+
+    TimeMode mode;
+    // De senast använda intervallen, så att även osorterade tidsstämplar
+    // över några år sällan behöver slå upp tidszonen
+    OffsetRange ranges[OFFSET_CACHE_SIZE];
+    size_t rangeCount;
+    size_t currentRange;
+    size_t nextSlot;
+
+    const OffsetRange& rangeFor(std::int64_t utcSeconds);
+    static OffsetRange lookupRange(std::int64_t utcSeconds);
+    bool localToUtc(int year, int month, int day, int hour, int minute, int second,
+                    std::int64_t& utcSeconds);
+
+public:
+    explicit TimeCodec(TimeMode mode = TimeMode::Local);
+
+    TimeMode getMode() const { return mode; }
+    void setMode(TimeMode newMode) { mode = newMode; }
+
+    // Skriv tidsstämpeln till out (minst TIME_TEXT_CAPACITY tecken);
+    // returnerar pekaren efter sista tecknet. Sekunddelar avrundas nedåt.
+    char* format(char* out, std::int64_t timestampNs);
+    std::string format(std::int64_t timestampNs);
+
+    // Tolka "YYYY-MM-DD HH:MM[:SS]" eller ett heltal sekunder sedan epoch.
+    // Båda formerna accepteras i alla lägen; datum tolkas som lokal tid i
+    // Local och som UTC i Utc och Epoch.
+    bool parse(const char* begin, const char* end, std::int64_t& timestampNs);
+};
+
+#endif // TIME_CODEC_H
@@ -0,0 +1,85 @@
+#include "time_index.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+// Ordning efter tid och därefter radnummer
+struct TimeOrder {
+    const int64_t* timestamps;
+
+    bool operator()(size_t a, size_t b) const {
+        return timestamps[a] < timestamps[b] || (timestamps[a] == timestamps[b] && a < b);
+    }
+};
+
+} // namespace
+
+TimeIndex::TimeIndex() : indexedRows(0), ordered(true) {}
+
+void TimeIndex::clear() {
+    sorted.clear();
+    pending.clear();
+    indexedRows = 0;
+    ordered = true;
+}
+
+void TimeIndex::sync(const int64_t* timestamps, size_t count) {
+    if (count < indexedRows) {
+        clear();  // Datan har krympt; börja om
+    }
+    
+    // Tidsordnat lager: kontrollera bara de nya raderna
+    size_t row = indexedRows;
+    if (ordered) {
+        if (row == 0 && count > 0) ++row;
+        while (row < count && timestamps[row] >= timestamps[row - 1]) ++row;
+        if (row == count) {
+            indexedRows = count;
+            return;
+        }
+        // Första raden i fel ordning: allt före den är redan sorterat
+        ordered = false;
+        sorted.resize(row);
+        iota(sorted.begin(), sorted.end(), size_t(0));
+    }
+    
+    for (; row < count; ++row) {
+        if (pending.empty() && (sorted.empty() || timestamps[row] >= timestamps[sorted.back()])) {
+            sorted.push_back(row);
+        } else {
+            pending.push_back(row);
+        }
+    }
+    indexedRows = count;
+}
+
+void TimeIndex::mergePending(const int64_t* timestamps) {
+    if (pending.empty()) return;
+
+    TimeOrder order = { timestamps };
+    sort(pending.begin(), pending.end(), order);
+    size_t middle = sorted.size();
+    sorted.insert(sorted.end(), pending.begin(), pending.end());
+    inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end(), order);
+    pending.clear();
+}
+
+TimeRange TimeIndex::find(const int64_t* timestamps, int64_t startNs, int64_t endNs) const {
+    if (!(startNs < endNs)) return TimeRange();
+    if (ordered) {
+        size_t first = lower_bound(timestamps, timestamps + indexedRows, startNs) - timestamps;
+        size_t last = lower_bound(timestamps + first, timestamps + indexedRows, endNs) - timestamps;
+        return TimeRange(first, last, nullptr);
+    }
+    auto before = [timestamps](size_t row, int64_t bound) { return timestamps[row] < bound; };
+    size_t first = lower_bound(sorted.begin(), sorted.end(), startNs, before) - sorted.begin();
+    size_t last = lower_bound(sorted.begin() + first, sorted.end(), endNs, before) - sorted.begin();
+    return TimeRange(first, last, sorted.data());
+}
+
+TimeRange TimeIndex::all() const {
+    return ordered ? TimeRange(0, indexedRows, nullptr) : TimeRange(0, sorted.size(), sorted.data());
+}
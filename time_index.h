@@ -0,0 +1,65 @@
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Raderna med tidsstämpel i ett intervall, i tidsordning. Antingen ett
+// sammanhängande intervall av rader (när lagret är tidsordnat) eller en
+// del av en permutation sorterad efter tid.
+class TimeRange {
+private:
+    size_t first;
+    size_t last;
+    const size_t* order;   // nullptr: raderna first..last-1
+
+public:
+    TimeRange() : first(0), last(0), order(nullptr) {}
+    TimeRange(size_t first, size_t last, const size_t* order) : first(first), last(last), order(order) {}
+
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+    bool isContiguous() const { return order == nullptr; }
+    // Radnummer för den i:te raden i tidsordning
+    size_t row(size_t i) const { return order != nullptr ? order[first + i] : first + i; }
+    // Första raden; bara meningsfull för ett sammanhängande intervall
+    size_t firstRow() const { return first; }
+};
+
+// Tidsindex över tidsstämpelkolumnen.
+//
+// Så länge raderna kommer i stigande tidsordning, vilket är det vanliga,
+// är kolumnen själv indexet: inget extra minne används och ett intervall
+// hittas med två binärsökningar. Först när en rad kommer i fel ordning
+// byggs en permutation sorterad efter tid (och radnummer vid lika). Den
+// hålls sedan uppdaterad som ValueIndex: rader i ordning läggs till i
+// slutet, övriga samlas i en svans som sorteras in före nästa fråga.
+class TimeIndex {
+private:
+    std::vector<size_t> sorted;    // Tom så länge raderna är tidsordnade
+    std::vector<size_t> pending;   // Rader i fel ordning som ännu inte sorterats in
+    size_t indexedRows;
+    bool ordered;
+
+public:
+    TimeIndex();
+
+    void clear();
+    size_t indexedCount() const { return indexedRows; }
+    // Sant om tidsstämplarna i lagret är icke-avtagande
+    bool isOrdered() const { return ordered; }
+
+    // Ta med rader som lagts till sedan senaste anropet
+    void sync(const std::int64_t* timestamps, size_t count);
+    // Sortera in svansen; krävs före find() när lagret inte är tidsordnat
+    void mergePending(const std::int64_t* timestamps);
+
+    // Rader med tidsstämpel i [startNs, endNs) i O(log n). Intervallet
+    // gäller tills nästa sync().
+    TimeRange find(const std::int64_t* timestamps, std::int64_t startNs, std::int64_t endNs) const;
+    // Alla indexerade rader i tidsordning
+    TimeRange all() const;
+};
+
+#endif // TIME_INDEX_H
@@ -0,0 +1,108 @@
+#include "value_index.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Ordning efter värde och därefter index; NaN placeras sist
+struct ValueOrder {
+    const double* values;
+
+    bool operator()(size_t a, size_t b) const {
+        double x = values[a], y = values[b];
+        if (x < y) return true;
+        if (y < x) return false;
+        bool xNan = std::isnan(x), yNan = std::isnan(y);
+        if (xNan != yNan) return yNan;
+        return a < b;
+    }
+};
+
+} // namespace
+
+void ValueIndex::clear() {
+    sorted.clear();
+    pending.clear();
+}
+
+// Svansen får växa till ungefär roten ur n innan den sorteras in; det
+// balanserar kostnaden för sammanslagning mot linjär sökning i svansen.
+size_t ValueIndex::pendingLimit() const {
+    size_t root = static_cast<size_t>(sqrt(static_cast<double>(sorted.size())));
+    return max<size_t>(4096, root);
+}
+
+void ValueIndex::sync(const double* values, size_t count) {
+    if (count < indexedCount()) {
+        clear();  // Datan har krympt; börja om
+    }
+    for (size_t i = indexedCount(); i < count; ++i) {
+        pending.push_back(i);
+    }
+    if (pending.size() > pendingLimit()) {
+        mergePending(values);
+    }
+}
+
+void ValueIndex::mergePending(const double* values) {
+    if (pending.empty()) return;
+
+    ValueOrder order = { values };
+    sort(pending.begin(), pending.end(), order);
+    size_t middle = sorted.size();
+    sorted.insert(sorted.end(), pending.begin(), pending.end());
+    inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end(), order);
+    pending.clear();
+}
+
+size_t ValueIndex::lowerBound(const double* values, double value) const {
+    return partition_point(sorted.begin(), sorted.end(),
+        [values, value](size_t i) { return values[i] < value; }) - sorted.begin();
+}
+
+size_t ValueIndex::upperBound(const double* values, double value) const {
+    // NaN hamnar sist och räknas aldrig som större än ett tröskelvärde
+    return partition_point(sorted.begin(), sorted.end(),
+        [values, value](size_t i) { return values[i] <= value; }) - sorted.begin();
+}
+
+size_t ValueIndex::countAtMost(const double* values, double threshold) const {
+    size_t count = upperBound(values, threshold);
+    for (size_t i : pending) {
+        if (values[i] <= threshold) ++count;
+    }
+    return count;
+}
+
+size_t ValueIndex::countAbove(const double* values, double threshold) const {
+    return above(values, threshold).size() +
+        count_if(pending.begin(), pending.end(), [values, threshold](size_t i) { return values[i] > threshold; });
+}
+
+size_t ValueIndex::countInRange(const double* values, double low, double high) const {
+    return inRange(values, low, high).size() +
+        count_if(pending.begin(), pending.end(), [values, low, high](size_t i) {
+            return values[i] >= low && values[i] <= high;
+        });
+}
+
+IndexSpan ValueIndex::atMost(const double* values, double threshold) const {
+    return IndexSpan(sorted.data(), sorted.data() + upperBound(values, threshold));
+}
+
+IndexSpan ValueIndex::above(const double* values, double threshold) const {
+    // Slutet av de värden som inte är NaN
+    size_t finiteEnd = partition_point(sorted.begin(), sorted.end(),
+        [values](size_t i) { return !std::isnan(values[i]); }) - sorted.begin();
+    size_t first = min(upperBound(values, threshold), finiteEnd);
+    return IndexSpan(sorted.data() + first, sorted.data() + finiteEnd);
+}
+
+IndexSpan ValueIndex::inRange(const double* values, double low, double high) const {
+    if (!(low <= high)) return IndexSpan();
+    size_t first = lowerBound(values, low);
+    size_t last = upperBound(values, high);
+    return IndexSpan(sorted.data() + first, sorted.data() + max(first, last));
+}
@@ -0,0 +1,59 @@
+#ifndef VALUE_INDEX_H
+#define VALUE_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+// Icke-ägande vy över en följd av radindex
+class IndexSpan {
+private:
+    const size_t* first;
+    const size_t* last;
+
+public:
+    IndexSpan() : first(nullptr), last(nullptr) {}
+    IndexSpan(const size_t* first, const size_t* last) : first(first), last(last) {}
+
+    const size_t* begin() const { return first; }
+    const size_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    size_t operator[](size_t i) const { return first[i]; }
+};
+
+// Sorterad permutation av radindex, ordnad efter värde (och index vid lika).
+// Nya rader samlas i en liten osorterad svans som slås ihop med den sorterade
+// delen när den växer, så att indexet förblir giltigt när data läggs till.
+// Räknefrågor besvaras med binärsökning i O(log n) plus svansens längd.
+class ValueIndex {
+private:
+    std::vector<size_t> sorted;
+    std::vector<size_t> pending;   // Tillagda rader som ännu inte sorterats in
+
+    size_t pendingLimit() const;
+    size_t lowerBound(const double* values, double value) const;  // Första med värde >= value
+    size_t upperBound(const double* values, double value) const;  // Första med värde > value
+
+public:
+    void clear();
+    size_t indexedCount() const { return sorted.size() + pending.size(); }
+
+    // Ta med rader som lagts till sedan senaste anropet
+    void sync(const double* values, size_t count);
+
+    // Sortera in svansen så att hela indexet är sorterat
+    void mergePending(const double* values);
+
+    // Antal värden i intervallen (-inf, t], (t, inf) och [low, high]
+    size_t countAtMost(const double* values, double threshold) const;
+    size_t countAbove(const double* values, double threshold) const;
+    size_t countInRange(const double* values, double low, double high) const;
+
+    // Radindex ordnade efter värde; kräver att mergePending() har körts
+    IndexSpan all() const { return IndexSpan(sorted.data(), sorted.data() + sorted.size()); }
+    IndexSpan atMost(const double* values, double threshold) const;
+    IndexSpan above(const double* values, double threshold) const;
+    IndexSpan inRange(const double* values, double low, double high) const;
+};
+
+#endif // VALUE_INDEX_H